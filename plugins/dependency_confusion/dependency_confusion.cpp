@@ -1,108 +1,128 @@
 #include "spectre/plugin.h"
 #include "spectre/proof_queue.h"
-#include "spectre/tor_proxy.h"
-#include <cpr/cpr.h>
-#include <iostream>
+#include "spectre/log.h"
+#include "spectre/package_index.h"
+#include "spectre/path_probe.h"
 #include <nlohmann/json.hpp>
-#include <regex>
+#include <cctype>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <vector>
 
 namespace {
 
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("dependency_confusion");
+const spectre::TaskType task_type = spectre::intern_task_type("dependency_confusion");
+
 class DependencyConfusionPlugin : public spectre::Plugin {
 public:
+    DependencyConfusionPlugin()
+        : probe_id_(spectre::PathProbe::get_instance().register_paths(
+              name(), {{"/package.json", {"\"dependencies\"", "\"devDependencies\"", "\"peerDependencies\""},
+                        spectre::ProbePath::kWholeBody},
+                       {"/requirements.txt", {}, spectre::ProbePath::kWholeBody}})) {}
+
+    ~DependencyConfusionPlugin() override {
+        spectre::PathProbe::get_instance().unregister(probe_id_);
+    }
+
     std::string name() const override {
         return "dependency_confusion";
     }
 
     void handle_task(const spectre::Task& task) override {
-        if (task.data.value("type", "") != name()) {
+        if (task.type != task_type) {
             return;
         }
 
-        std::string url = task.data.value("target", "");
+        std::string url = task.target;
         if (url.empty()) {
             return;
         }
 
-        std::cout << "[" << name() << "] scanning " << url << std::endl;
-
-        check_package_json(url);
-        check_requirements_txt(url);
-    }
+        logger.info("scanning", {{"target", url}});
 
-private:
-    void check_package_json(const std::string& base_url) {
-        std::string pkg_url = base_url + "/package.json";
-        cpr::Response r = get_request(pkg_url);
-
-        if (r.status_code == 200) {
-            try {
-                nlohmann::json pkg = nlohmann::json::parse(r.text);
-                const std::vector<std::string> keys = {"dependencies", "devDependencies", "peerDependencies"};
-                for (const auto& key : keys) {
-                    if (pkg.contains(key)) {
-                        for (auto& [dep_name, version] : pkg[key].items()) {
-                            check_npm_registry(base_url, dep_name);
-                        }
-                    }
-                }
-            } catch (const nlohmann::json::parse_error&) {
+        if (url.back() == '/') {
+            url.pop_back();
+        }
+        for (const auto& hit : spectre::PathProbe::get_instance().hits(url, name())) {
+            if (hit.path == "/package.json") {
+                check_package_json(url, hit.body);
+            } else {
+                check_requirements_txt(url, hit.body);
             }
         }
     }
 
-    void check_requirements_txt(const std::string& base_url) {
-        std::string req_url = base_url + "/requirements.txt";
-        cpr::Response r = get_request(req_url);
-
-        if (r.status_code == 200) {
-            std::istringstream stream(r.text);
-            std::string line;
-            while (std::getline(stream, line)) {
-                std::regex dep_regex("^[a-zA-Z0-9_-]+");
-                std::smatch match;
-                if (std::regex_search(line, match, dep_regex)) {
-                    check_pypi_registry(base_url, match.str(0));
+private:
+    void check_package_json(const std::string& base_url, const std::string& body) {
+        std::vector<std::string> deps;
+        try {
+            nlohmann::json pkg = nlohmann::json::parse(body);
+            const std::vector<std::string> keys = {"dependencies", "devDependencies", "peerDependencies"};
+            for (const auto& key : keys) {
+                if (pkg.contains(key) && pkg[key].is_object()) {
+                    for (auto& [dep_name, version] : pkg[key].items()) {
+                        deps.push_back(dep_name);
+                    }
                 }
             }
+        } catch (const nlohmann::json::parse_error&) {
         }
+        check_registry(base_url, spectre::Ecosystem::npm, deps);
     }
 
-    void check_npm_registry(const std::string& target, const std::string& dep_name) {
-        std::string registry_url = "https://registry.npmjs.org/" + dep_name;
-        cpr::Response r = get_request(registry_url);
-
-        if (r.status_code == 200 || r.status_code == 404) {
-            submit_proof(target, dep_name, "npm", registry_url);
+    void check_requirements_txt(const std::string& base_url, const std::string& body) {
+        std::vector<std::string> deps;
+        std::istringstream stream(body);
+        std::string line;
+        while (std::getline(stream, line)) {
+            std::string dep = requirement_name(line);
+            if (!dep.empty()) deps.push_back(std::move(dep));
         }
+        check_registry(base_url, spectre::Ecosystem::pypi, deps);
     }
-    
-    void check_pypi_registry(const std::string& target, const std::string& dep_name) {
-        std::string registry_url = "https://pypi.org/pypi/" + dep_name + "/json";
-        cpr::Response r = get_request(registry_url);
 
-        if (r.status_code == 200) {
-            submit_proof(target, dep_name, "pypi", registry_url);
-        }
+    // The project name a requirements.txt line starts with: a letter or
+    // digit, then letters, digits, '-', '_' and '.'. Empty for comments,
+    // options (-r, --index-url) and blank lines.
+    static std::string requirement_name(const std::string& line) {
+        auto is_name_char = [](unsigned char c) { return std::isalnum(c) || c == '-' || c == '_' || c == '.'; };
+        if (line.empty() || !std::isalnum(static_cast<unsigned char>(line[0]))) return "";
+        std::size_t end = 1;
+        while (end < line.size() && is_name_char(static_cast<unsigned char>(line[end]))) ++end;
+        return line.substr(0, end);
     }
 
-    cpr::Response get_request(const std::string& url) {
-        cpr::Session session;
-        session.SetUrl(cpr::Url{url});
-        session.SetTimeout(cpr::Timeout{10000});
-        if (spectre::TorProxy::get_instance().is_available()) {
-            session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
-                                {"https", "socks5://127.0.0.1:9050"}});
+    void check_registry(const std::string& target, spectre::Ecosystem ecosystem, const std::vector<std::string>& deps) {
+        if (deps.empty()) return;
+        auto& registry = spectre::RegistryLookup::get_instance();
+        auto presence = registry.exists(ecosystem, deps);
+        for (std::size_t i = 0; i < deps.size(); ++i) {
+            bool present = presence[i] == spectre::RegistryLookup::Presence::present;
+            // An npm name nobody has published is the claimable case: an
+            // attacker can register it and win the resolution outright.
+            bool claimable = ecosystem == spectre::Ecosystem::npm && presence[i] == spectre::RegistryLookup::Presence::absent;
+            if (present || claimable) {
+                submit_proof(target, deps[i], spectre::ecosystem_name(ecosystem), registry.registry_url(ecosystem, deps[i]),
+                             claimable);
+            }
         }
-        return session.Get();
     }
 
-    void submit_proof(const std::string& target, const std::string& dep_name, const std::string& ecosystem, const std::string& registry_url) {
-        std::cout << "[" << name() << "] VULNERABILITY FOUND: " << dep_name << " exists in the public " << ecosystem << " registry." << std::endl;
+    void submit_proof(const std::string& target, const std::string& dep_name, const std::string& ecosystem, const std::string& registry_url,
+                      bool claimable) {
+        logger.warn(claimable ? "vulnerability found: dependency is unclaimed in public registry"
+                              : "vulnerability found: dependency exists in public registry",
+                    {{"dependency", dep_name}, {"ecosystem", ecosystem}});
         
         nlohmann::json evidence;
-        evidence["description"] = "A package with a name matching a project dependency was found in a public repository. This could allow an attacker to execute a dependency confusion attack by creating a malicious package with a higher version number.";
+        evidence["description"] = claimable
+            ? "A project dependency is not published in the public repository. An attacker can register the name and have a malicious package installed wherever the public registry is consulted."
+            : "A package with a name matching a project dependency was found in a public repository. This could allow an attacker to execute a dependency confusion attack by creating a malicious package with a higher version number.";
         evidence["dependency_name"] = dep_name;
+        evidence["claimable"] = claimable;
         evidence["ecosystem"] = ecosystem;
         evidence["public_registry_url"] = registry_url;
 
@@ -114,8 +134,10 @@ private:
             ""
         };
         spectre::enqueue_proof(proof);
-        std::cout << "[" << name() << "] proof queued" << std::endl;
+        logger.debug("proof queued");
     }
+
+    int probe_id_;
 };
 } // namespace
 
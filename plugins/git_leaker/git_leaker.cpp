@@ -1,67 +1,78 @@
 #include "spectre/plugin.h"
 #include "spectre/proof_queue.h"
-#include "spectre/tor_proxy.h"
-#include <iostream>
+#include "spectre/path_probe.h"
+#include "spectre/log.h"
+#include <ctime>
 #include <string>
-#include <cpr/cpr.h>
 #include <nlohmann/json.hpp>
 
 namespace {
+
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("git_leaker");
+const spectre::TaskType task_type = spectre::intern_task_type("git_leak");
+
 class GitLeakerPlugin : public spectre::Plugin {
 public:
+    GitLeakerPlugin()
+        : probe_id_(spectre::PathProbe::get_instance().register_paths(
+              name(), {{"/.git/config", {"[remote \"origin\"]", "repositoryformatversion"}, 4096},
+                       {"/.git/HEAD", {"ref: refs/"}, 256}})) {}
+
+    ~GitLeakerPlugin() override {
+        spectre::PathProbe::get_instance().unregister(probe_id_);
+    }
+
     std::string name() const override {
         return "git_leak";
     }
 
     void handle_task(const spectre::Task& task) override {
-        if (task.data.value("type", "") != name()) {
+        if (task.type != task_type) {
             return;
         }
 
-        std::string target_url = task.data.value("target", "");
+        std::string target_url = task.target;
         if (target_url.empty()) {
             return;
         }
 
-        std::cout << "[" << name() << "] scanning " << target_url << std::endl;
+        logger.info("scanning", {{"target", target_url}});
 
         if (target_url.back() == '/') {
             target_url.pop_back();
         }
-        std::string git_config_url = target_url + "/.git/config";
 
-        cpr::Session session;
-        session.SetUrl(cpr::Url{git_config_url});
-        session.SetTimeout(cpr::Timeout{10000});
-
-        if (spectre::TorProxy::get_instance().is_available()) {
-            session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
-                                {"https", "socks5://127.0.0.1:9050"}});
+        auto hits = spectre::PathProbe::get_instance().hits(target_url, name());
+        if (hits.empty()) {
+            logger.info("no git exposure detected", {{"target", target_url}});
+            return;
         }
 
-        cpr::Response r = session.Get();
-
-        if (r.status_code == 200 && r.text.find("[remote \"origin\"]") != std::string::npos) {
-            std::cout << "[" << name() << "] VULNERABILITY CONFIRMED: Exposed and valid .git/config at " << git_config_url << std::endl;
-            
-            nlohmann::json evidence;
-            evidence["description"] = "The web server is exposing a valid .git/config file. This confirms the entire source code repository is publicly accessible, posing a critical security risk.";
-            evidence["exposed_file_url"] = git_config_url;
-            evidence["http_status"] = r.status_code;
-            evidence["validation"] = "Response body contains '[remote \"origin\"]', confirming it is a valid git config file.";
+        const auto& first = hits.front();
+        logger.warn("vulnerability confirmed: exposed git repository", {{"url", first.url}});
 
-            spectre::VulnProof proof = {
-                target_url,
-                "EXPOSED_GIT_REPOSITORY",
-                evidence,
-                std::to_string(std::time(nullptr)),
-                ""
-            };
-            spectre::enqueue_proof(proof);
-        } else {
-            std::cout << "[" << name() << "] no git exposure detected on " << target_url << " (status: " << r.status_code << ")" << std::endl;
+        nlohmann::json evidence;
+        evidence["description"] = "The web server is exposing the .git directory. This confirms the entire source code repository is publicly accessible, posing a critical security risk.";
+        evidence["exposed_file_url"] = first.url;
+        evidence["http_status"] = first.status;
+        evidence["validation"] = "Response body contains '" + first.signature + "', confirming it is a git metadata file.";
+        evidence["exposed_files"] = nlohmann::json::array();
+        for (const auto& hit : hits) {
+            evidence["exposed_files"].push_back(hit.url);
         }
+
+        spectre::VulnProof proof = {
+            target_url,
+            "EXPOSED_GIT_REPOSITORY",
+            evidence,
+            std::to_string(std::time(nullptr)),
+            ""
+        };
+        spectre::enqueue_proof(proof);
     }
+
+private:
+    int probe_id_;
 };
 } // namespace
 
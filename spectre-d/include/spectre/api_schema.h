@@ -0,0 +1,96 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace spectre {
+
+// A value in a request that can be mutated: a path, query or header
+// parameter by name, or a node of the JSON body by JSON pointer.
+struct ApiField {
+    enum class Location { path, query, header, body };
+    enum class Type { string, integer, number, boolean, array, object };
+
+    Location location = Location::body;
+    std::string name;
+    Type type = Type::string;
+    std::string format;
+    bool required = false;
+    std::vector<nlohmann::json> enum_values;
+    std::optional<double> minimum;
+    std::optional<double> maximum;
+    std::optional<std::size_t> max_length;
+};
+
+// One operation, compiled to a valid baseline request and its fields.
+struct ApiOperation {
+    std::string method;  // GET, POST, PUT or PATCH
+    std::string path;    // "/users/{id}"; empty for a bare JSON schema
+    std::map<std::string, std::string> path_params;
+    std::map<std::string, std::string> query;
+    std::map<std::string, std::string> headers;
+    std::optional<nlohmann::json> body;
+    std::vector<ApiField> fields;
+};
+
+struct ApiRequest {
+    std::size_t operation = 0;
+    std::string method;
+    std::string url;
+    std::map<std::string, std::string> headers;
+    // Empty when the operation takes no body.
+    std::string body;
+    // Field name or pointer, empty for the baseline request.
+    std::string field;
+    std::string mutation;
+};
+
+// Request templates compiled from an OpenAPI 3, Swagger 2 or plain JSON
+// schema document. A plain schema describes the body of a POST to the target
+// itself. DELETE operations are left out. Mutations are not stored: Cursor
+// builds each request when it is asked for the next one.
+class ApiCorpus {
+public:
+    // Compiled once per file and reused until the file changes. nullptr if
+    // it cannot be read or parsed.
+    static std::shared_ptr<const ApiCorpus> load(const std::string& path);
+    static std::shared_ptr<const ApiCorpus> compile(const nlohmann::json& document);
+
+    const std::vector<ApiOperation>& operations() const { return operations_; }
+    // Requests a full run sends: one baseline per operation plus every
+    // mutation that applies to each field.
+    std::size_t size() const { return size_; }
+
+    // Walks the requests in rounds: every operation's baseline first, then one
+    // mutation per operation in turn, so a capped run still covers every
+    // endpoint.
+    class Cursor {
+    public:
+        Cursor(const ApiCorpus& corpus, std::string base_url);
+        bool next(ApiRequest& out);
+
+    private:
+        struct Position {
+            bool baseline_sent = false;
+            std::size_t field = 0;
+            std::size_t mutation = 0;
+            bool done = false;
+        };
+        const ApiCorpus& corpus_;
+        std::string base_url_;
+        std::vector<Position> positions_;
+        std::size_t turn_ = 0;
+        std::size_t remaining_;
+    };
+
+private:
+    ApiCorpus() = default;
+    std::vector<ApiOperation> operations_;
+    std::size_t size_ = 0;
+};
+
+} // namespace spectre
@@ -13,6 +13,16 @@ struct VulnProof {
     std::string id;
 };
 
+inline void to_json(json& j, const VulnProof& proof) {
+    j = json{
+        {"target", proof.target},
+        {"vuln_type", proof.vuln_type},
+        {"evidence", proof.evidence},
+        {"timestamp", proof.timestamp},
+        {"id", proof.id}
+    };
+}
+
 class ArweaveClient {
 public:
     ArweaveClient();
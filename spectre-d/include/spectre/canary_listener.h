@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace spectre {
+
+struct CanaryListenerOptions {
+    // Interface to listen on; the listener is off while this is empty.
+    std::string address;
+    // 0 turns the endpoint off. DNS is off unless a port is given: callbacks
+    // need the zone delegated to port 53, and any other fixed default could
+    // collide with a local resolver or mDNS on 5353.
+    unsigned short http_port = 8880;
+    unsigned short dns_port = 0;
+    // Zone the DNS responder is authoritative for. Canary URLs become
+    // http://<token>.<domain>/ so resolving one is already a hit. Without a
+    // domain the token goes in the URL path.
+    std::string domain;
+    // Address targets reach the listener at (behind NAT, say), used in canary
+    // URLs and DNS answers. Defaults to address.
+    std::string public_address;
+    // Open HTTP callbacks at once, each allowed 10 s to send its request and
+    // read the answer; 0 for no limit.
+    std::size_t max_connections = 256;
+
+    // SPECTRE_CANARY_LISTEN, _HTTP_PORT, _DNS_PORT, _DOMAIN, _PUBLIC_IP,
+    // _MAX_CONNECTIONS.
+    static CanaryListenerOptions from_env();
+    bool enabled() const { return !address.empty(); }
+    // Canary URL with "{token}" where the token goes.
+    std::string url_format() const;
+};
+
+// Built-in callback endpoint for canaries: a plain HTTP server and a minimal
+// authoritative DNS responder on one Asio thread. Every request line plus
+// Host header, and every queried name, is handed to on_seen.
+class CanaryListener {
+public:
+    using SeenHandler = std::function<void(const std::string&)>;
+
+    static CanaryListener& get_instance();
+
+    bool start(const CanaryListenerOptions& options, SeenHandler on_seen);
+    void stop();
+
+    // Ports actually bound; 0 when that endpoint is not running.
+    unsigned short http_port() const;
+    unsigned short dns_port() const;
+
+private:
+    CanaryListener();
+    ~CanaryListener();
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace spectre
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+#include <future>
 #include <string>
 #include <vector>
 #include <functional>
@@ -7,15 +9,41 @@
 
 namespace spectre {
 
+struct Canary {
+    // Token to look the canary up by; empty when the monitor is not running.
+    std::string id;
+    // What to plant in a payload: the callback endpoint with the token in it.
+    std::string url;
+};
+
 class CanaryMonitor {
 public:
     static CanaryMonitor& get_instance();
     void start(const std::string& webhook_url);
     void stop();
-
+    bool is_running();
+
+    // Canaries are forgotten SPECTRE_CANARY_TTL_S (default 600) seconds after
+    // they are issued unless someone is still waiting on them.
+    Canary issue_canary();
+    // Canary URLs are this with "{token}" replaced; by default the webhook
+    // URL followed by "/{token}".
+    void set_url_format(const std::string& format);
     std::string get_canary_url();
 
     bool has_canary_chirped(const std::string& canary_id);
+    // Becomes true as soon as a hit on the canary is recorded, or false at
+    // deadline. Ready at once if it has already chirped.
+    std::future<bool> wait_for_chirp(const std::string& canary_id, std::chrono::steady_clock::time_point deadline);
+    // Feeds a callback seen by any listener: every canary token in `seen`
+    // (a URL, a host name) counts as a hit.
+    void record_hit(const std::string& seen);
+    // record_hit() for the daemon's own listener, which also passes `seen`
+    // on to the observers (isolated plugin workers, which issue canaries of
+    // their own).
+    void report_callback(const std::string& seen);
+    int add_callback_observer(std::function<void(const std::string&)> observer);
+    void remove_callback_observer(int id);
 
 private:
     CanaryMonitor() = default;
@@ -23,7 +51,10 @@ private:
     std::unique_ptr<pimpl> pimpl_;
 };
 
-void start_canary_monitor();
+// Starts the monitor with CANARY_WEBHOOK_API_URL and, when configured, the
+// built-in listener (see CanaryListenerOptions). Plugin workers pass
+// listen = false: they use the daemon's listener, which forwards callbacks.
+void start_canary_monitor(bool listen = true);
 void stop_canary_monitor();
 
-} // namespace spectre 
\ No newline at end of file
+} // namespace spectre
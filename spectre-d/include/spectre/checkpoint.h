@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "task.h"
+
+namespace spectre {
+using json = nlohmann::json;
+
+// Thrown out of checkpoint() once the daemon is shutting down and the
+// plugin's state is on disk. The dispatcher then keeps the checkpoint for the
+// next start instead of finishing the scan.
+class ScanInterrupted : public std::runtime_error {
+public:
+    static constexpr const char* kMessage = "interrupted by shutdown";
+    ScanInterrupted() : std::runtime_error(kMessage) {}
+};
+
+// Progress of unfinished tasks, one JSON file per scan in
+// SPECTRE_CHECKPOINT_DIR (default "spectre-checkpoints", empty turns it off)
+// holding the task and the last state its plugin saved. Files are replaced
+// atomically and removed when the task finishes, so whatever is left at
+// startup belongs to tasks the previous run did not complete. Worker
+// processes read and write the same directory.
+class CheckpointStore {
+public:
+    static CheckpointStore& get_instance();
+
+    bool enabled() const { return !dir_.empty(); }
+    // SPECTRE_CHECKPOINT_INTERVAL_S, default 10.
+    std::chrono::seconds interval() const { return interval_; }
+
+    void save(const std::string& id, const std::string& task_raw, const json& state);
+    // The saved state, nullopt when there is none.
+    std::optional<json> load(const std::string& id);
+    void remove(const std::string& id);
+    // Tasks the previous run left unfinished, with their scan ids. Each call
+    // counts a resume attempt in the file; a scan that has not finished or
+    // been cleanly interrupted after SPECTRE_CHECKPOINT_MAX_ATTEMPTS (default
+    // 3) of them is dropped instead.
+    std::vector<Task> pending();
+
+    // Called once when the daemon starts shutting down: plugins stop at their
+    // next checkpoint. Isolated plugins observe it to tell their workers.
+    void interrupt();
+    bool interrupted() const { return interrupted_.load(std::memory_order_relaxed); }
+    int add_interrupt_observer(std::function<void()> observer);
+    void remove_interrupt_observer(int id);
+
+private:
+    CheckpointStore();
+    std::string path_of(const std::string& id) const;
+    bool write(const std::string& path, const json& saved);
+
+    std::string dir_;
+    std::chrono::seconds interval_{10};
+    int max_attempts_ = 3;
+    std::atomic<bool> interrupted_{false};
+    std::mutex observers_mutex_;
+    std::map<int, std::function<void()>> observers_;
+    int next_observer_ = 0;
+};
+
+// Binds the task being run to the calling thread for checkpoint().
+class CheckpointScope {
+public:
+    explicit CheckpointScope(const Task& task);
+    ~CheckpointScope();
+    CheckpointScope(const CheckpointScope&) = delete;
+    CheckpointScope& operator=(const CheckpointScope&) = delete;
+};
+
+// For plugins, resolved from the task bound to the calling thread.
+// State an earlier run of this scan saved.
+std::optional<json> checkpoint_resume();
+// True once the interval has passed since the task's last checkpoint, or
+// as soon as the daemon is shutting down. Cheap enough to ask per request.
+bool checkpoint_due();
+// Saves state for the task; throws ScanInterrupted afterwards when the
+// daemon is shutting down.
+void checkpoint(const json& state);
+
+} // namespace spectre
@@ -0,0 +1,38 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include <curl/curl.h>
+
+namespace spectre {
+
+// One curl multi handle, driven by its own thread, that every outbound probe
+// runs on. Transfers share its connection cache: HTTPS targets are offered h2
+// via ALPN and concurrent requests to one host wait to multiplex as streams
+// on an existing connection rather than opening another.
+//
+// SPECTRE_HTTP_MAX_STREAMS (default 32) caps the streams on one connection.
+// SPECTRE_HTTP_MAX_HOST_CONNECTIONS caps connections per host and is off by
+// default: HTTP/1.1 targets need a connection per concurrent request, and
+// work beyond the cap queues inside curl with its timeout running.
+// SPECTRE_HTTP2=0 keeps everything on HTTP/1.1.
+class CurlMultiplexer {
+public:
+    using Done = std::function<void(CURLcode)>;
+
+    static CurlMultiplexer& get_instance();
+
+    // The multiplexer owns `handle` until `done` runs on its thread; the
+    // handle is already detached from the multi handle by then.
+    void submit(CURL* handle, Done done);
+    // Runs the handles concurrently and blocks until all have finished.
+    std::vector<CURLcode> perform(const std::vector<CURL*>& handles);
+
+private:
+    CurlMultiplexer();
+    ~CurlMultiplexer();
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace spectre
@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "plugin.h"
+#include "metrics.h"
+
+namespace spectre {
+
+// Runs incoming tasks through every plugin on a fixed pool of worker threads,
+// tracking each task as a scan in the ScanRegistry. The plugin list is an
+// immutable snapshot taken per task, so plugins can be swapped while tasks
+// are running; a replaced plugin is released once its last task finishes.
+class Dispatcher {
+public:
+    Dispatcher(std::vector<std::shared_ptr<Plugin>> plugins, std::size_t workers);
+    ~Dispatcher();
+
+    void start();
+    void stop();
+    // Called on the worker thread once every plugin is done with the task.
+    using TaskDone = std::function<void(const Task& task, bool ok)>;
+
+    // Assigns a scan id when the task has none and queues it.
+    void submit(Task task, TaskDone on_done = nullptr);
+
+    std::size_t workers() const { return worker_count_; }
+    std::size_t queued();
+    std::size_t running() const { return running_.load(std::memory_order_relaxed); }
+
+    // Adds the plugin, or replaces the one with the same name.
+    void upsert_plugin(std::shared_ptr<Plugin> plugin);
+    void remove_plugin(const std::string& name);
+    std::vector<std::string> plugin_names();
+
+private:
+    void worker_loop();
+    bool run(const Task& task);
+
+    struct LoadedPlugin {
+        std::shared_ptr<Plugin> plugin;
+        std::string name;
+        TaskType type;
+        Histogram* task_latency;
+    };
+    using PluginSet = std::vector<LoadedPlugin>;
+    static LoadedPlugin describe(std::shared_ptr<Plugin> plugin);
+    static void warm_up(const LoadedPlugin& loaded);
+    std::shared_ptr<const PluginSet> plugins();
+
+    std::mutex plugins_mutex_;
+    std::shared_ptr<const PluginSet> plugins_;
+    std::size_t worker_count_;
+    std::vector<std::thread> threads_;
+    std::vector<std::thread> warmers_;
+    struct Queued {
+        Task task;
+        std::uint64_t enqueued_ns;
+        TaskDone on_done;
+    };
+    std::deque<Queued> queue_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_ = false;
+    std::atomic<std::size_t> running_{0};
+};
+
+} // namespace spectre
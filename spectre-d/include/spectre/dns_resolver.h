@@ -0,0 +1,47 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace spectre {
+
+// Process-wide asynchronous resolver (c-ares on one event thread). Answers
+// are cached for their record TTL, names that do not exist for a short
+// negative TTL, and concurrent lookups of one name share a single query.
+class DnsResolver {
+public:
+    struct Result {
+        // ARES_SUCCESS or an ARES_E* code.
+        int status = 0;
+        std::vector<std::string> addresses;
+        std::chrono::seconds ttl{0};
+
+        bool ok() const { return status == 0 && !addresses.empty(); }
+        // The name has no addresses, as opposed to the lookup failing.
+        bool not_found() const;
+        std::string error() const;
+    };
+    using Callback = std::function<void(const Result&)>;
+
+    static DnsResolver& get_instance();
+
+    // callback runs on the resolver thread, or inline for a cache hit or an
+    // address literal. It must not block.
+    void resolve_async(const std::string& host, Callback callback);
+    Result resolve(const std::string& host, std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+    // Comma-separated "addr[:port]" list; replaces the servers from
+    // SPECTRE_DNS_SERVERS or resolv.conf.
+    bool set_servers(const std::string& servers);
+    void clear_cache();
+
+private:
+    DnsResolver();
+    ~DnsResolver();
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace spectre
@@ -6,18 +6,23 @@
 #include <functional>
 #include <iostream>
 #include "spectre/network_manager.h"
+#include "spectre/dispatcher.h"
+#include "spectre/workflow.h"
 
 namespace spectre {
 
 class http_server {
 public:
-    http_server(boost::asio::io_context& io_context, unsigned short port, NetworkManager& network_manager);
+    http_server(boost::asio::io_context& io_context, unsigned short port, NetworkManager& network_manager,
+                Dispatcher& dispatcher, WorkflowScheduler& workflows);
 
 private:
     void do_accept();
 
     boost::asio::ip::tcp::acceptor acceptor_;
     NetworkManager& network_manager_;
+    Dispatcher& dispatcher_;
+    WorkflowScheduler& workflows_;
 };
 
 } // namespace spectre
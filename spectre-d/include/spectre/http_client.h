@@ -0,0 +1,47 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <cpr/cpr.h>
+
+namespace spectre {
+
+// Every outbound probe goes through here so traffic is accounted in one place.
+// Requests run on the shared CurlMultiplexer, so concurrent probes to one
+// host reuse its connections and, over HTTPS, multiplex as h2 streams.
+class HttpClient {
+public:
+    enum class Method { get, post, put, patch, head };
+
+    static HttpClient& get_instance();
+
+    cpr::Response get(cpr::Session& session);
+    cpr::Response post(cpr::Session& session);
+    cpr::Response head(cpr::Session& session);
+    // GETs all sessions concurrently; responses come back in the same order.
+    std::vector<cpr::Response> get_all(const std::vector<cpr::Session*>& sessions);
+    // Like get_all, sending sessions[i] with methods[i] (or all with
+    // methods[0] when only one is given).
+    std::vector<cpr::Response> send_all(const std::vector<cpr::Session*>& sessions,
+                                        const std::vector<Method>& methods);
+
+    // SetUrl plus resolution through the shared DnsResolver: the answer is
+    // pinned on the session for its next request so curl skips its own lookup,
+    // and a name cached as nonexistent fails the request without sending it. Not done while Tor is
+    // in use, where names must not be resolved locally.
+    void set_url(cpr::Session& session, const std::string& url);
+
+    static std::string host_of(const std::string& url);
+    // How long the server took to answer the session's last request: from the
+    // request being sent to the first response byte. Unlike wall time it
+    // leaves out queueing, DNS, connect and TLS.
+    static std::chrono::microseconds server_time(cpr::Session& session);
+
+private:
+    HttpClient() = default;
+    void observe(const cpr::Response& response);
+    void trace(cpr::Session& session, const cpr::Response& response, const char* method, std::uint64_t start_ns);
+};
+
+} // namespace spectre
@@ -0,0 +1,34 @@
+#pragma once
+#include <memory>
+#include <string>
+#include "network_manager.h"
+
+namespace spectre {
+
+// Task ingest over a Unix domain stream socket for local tooling.
+//
+// Each frame is a big-endian u32 payload length followed by the payload:
+//   u32 task_count, then task_count x (u32 length, JSON task bytes)
+// Frames are read into pooled buffers on the I/O thread and decoded on a
+// separate parser thread; a slow consumer backs up into the socket rather
+// than dropping tasks.
+class LocalIngest {
+public:
+    using TaskHandler = NetworkManager::TaskHandler;
+
+    explicit LocalIngest(std::string socket_path);
+    ~LocalIngest();
+
+    // spectre-d.sock in $XDG_RUNTIME_DIR, else in a 0700 spectre-d-<uid>
+    // directory under the temp directory. Empty if neither is usable.
+    static std::string default_path();
+
+    void start(TaskHandler handler);
+    void stop();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace spectre
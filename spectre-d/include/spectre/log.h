@@ -0,0 +1,114 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <nlohmann/json.hpp>
+
+namespace spectre {
+
+enum class LogLevel : std::uint8_t { trace, debug, info, warn, error, off };
+
+const char* to_string(LogLevel level);
+bool parse_log_level(std::string_view text, LogLevel& level);
+
+// One key=value pair on a log record. Values are copied when the record is
+// queued, so they may point at temporaries.
+struct LogField {
+    LogField(std::string_view k, std::string_view v) : key(k), text(v) {}
+    LogField(std::string_view k, const std::string& v) : key(k), text(v) {}
+    LogField(std::string_view k, const char* v) : key(k), text(v ? v : "") {}
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    LogField(std::string_view k, T v) : key(k), is_number(true) {
+        if constexpr (std::is_floating_point_v<T>) {
+            real = static_cast<double>(v);
+            is_real = true;
+        } else {
+            number = static_cast<long long>(v);
+        }
+    }
+
+    std::string_view key;
+    std::string_view text;
+    bool is_number = false;
+    bool is_real = false;
+    long long number = 0;
+    double real = 0;
+};
+
+// A named log source (a plugin or core component). Sources are owned by the
+// Logger and live for the whole process, so plugins can keep references to
+// them across reloads. The level check is a single relaxed load.
+class LogSource {
+public:
+    explicit LogSource(std::string name, LogLevel level) : name_(std::move(name)), level_(level) {}
+
+    const std::string& name() const { return name_; }
+    LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+    bool enabled(LogLevel level) const { return level >= this->level(); }
+
+    void log(LogLevel level, std::string_view msg, std::initializer_list<LogField> fields = {}) const {
+        if (enabled(level)) write(level, msg, fields);
+    }
+    void trace(std::string_view msg, std::initializer_list<LogField> fields = {}) const { log(LogLevel::trace, msg, fields); }
+    void debug(std::string_view msg, std::initializer_list<LogField> fields = {}) const { log(LogLevel::debug, msg, fields); }
+    void info(std::string_view msg, std::initializer_list<LogField> fields = {}) const { log(LogLevel::info, msg, fields); }
+    void warn(std::string_view msg, std::initializer_list<LogField> fields = {}) const { log(LogLevel::warn, msg, fields); }
+    void error(std::string_view msg, std::initializer_list<LogField> fields = {}) const { log(LogLevel::error, msg, fields); }
+
+private:
+    friend class Logger;
+    void write(LogLevel level, std::string_view msg, std::initializer_list<LogField> fields) const;
+
+    std::string name_;
+    std::atomic<LogLevel> level_;
+    bool overridden_ = false;
+};
+
+// Asynchronous logfmt logger. Each thread appends records to its own
+// fixed-size ring without locking; a background thread drains the rings and
+// writes batches. A full ring drops the record and counts it rather than
+// blocking the caller. Before start() and after stop() records are written
+// synchronously.
+class Logger {
+public:
+    static Logger& get_instance();
+
+    LogSource& source(const std::string& name);
+
+    void set_level(LogLevel level);
+    void set_level(const std::string& source, LogLevel level);
+    // "info" or "warn,xss_hunter=debug,websocket=trace".
+    bool configure(std::string_view spec);
+    nlohmann::json levels();
+
+    void start(std::FILE* out);
+    void stop();
+
+private:
+    Logger();
+    ~Logger();
+    friend class LogSource;
+
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+// Tags records logged on this thread with a scan id and target host.
+class LogScope {
+public:
+    LogScope(std::string scan_id, std::string host);
+    ~LogScope();
+    LogScope(const LogScope&) = delete;
+    LogScope& operator=(const LogScope&) = delete;
+
+private:
+    std::string prev_scan_;
+    std::string prev_host_;
+};
+
+} // namespace spectre
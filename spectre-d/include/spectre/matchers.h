@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace spectre {
+
+// Database error messages that leak into responses when injected SQL breaks
+// the query. The signatures are compiled once and shared by all threads.
+class SqlErrorMatcher {
+public:
+    static const SqlErrorMatcher& get_instance();
+
+    bool matches(const std::string& body) const;
+
+private:
+    SqlErrorMatcher();
+    std::vector<std::regex> signatures_;
+};
+
+// Aho-Corasick automaton over a fixed set of literal patterns: one pass over
+// a text finds every pattern in it, however many there are.
+class MultiPatternMatcher {
+public:
+    explicit MultiPatternMatcher(const std::vector<std::string>& patterns, bool ignore_case = false);
+
+    // Indexes of the patterns that occur in text, each once, in the order
+    // their first occurrence ends.
+    std::vector<std::size_t> find_all(std::string_view text) const;
+    bool empty() const { return pattern_count_ == 0; }
+
+private:
+    static constexpr std::uint32_t kNone = UINT32_MAX;
+    std::uint32_t step(std::uint32_t state, unsigned char c) const { return next_[state * 256 + c]; }
+
+    // next_[state * 256 + byte]: complete transition table, failures folded in.
+    std::vector<std::uint32_t> next_;
+    // Pattern ending at each state, and the nearest proper suffix state that
+    // ends one, for reporting overlapping matches.
+    std::vector<std::uint32_t> output_;
+    std::vector<std::uint32_t> output_link_;
+    std::size_t pattern_count_ = 0;
+    bool ignore_case_;
+};
+
+} // namespace spectre
@@ -0,0 +1,100 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace spectre {
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+namespace metrics_detail {
+constexpr std::size_t kShards = 16;
+std::size_t shard_index();
+} // namespace metrics_detail
+
+// Monotonic counter striped across cache-line aligned cells so concurrent
+// writers on different threads never contend on the same line.
+class Counter {
+public:
+    void inc(std::uint64_t n = 1) {
+        cells_[metrics_detail::shard_index()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+    std::uint64_t value() const;
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<std::uint64_t> value{0};
+    };
+    std::array<Cell, metrics_detail::kShards> cells_;
+};
+
+class Gauge {
+public:
+    void set(std::int64_t v) { value_.store(v, std::memory_order_relaxed); }
+    void add(std::int64_t v) { value_.fetch_add(v, std::memory_order_relaxed); }
+    std::int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int64_t> value_{0};
+};
+
+// Log-linear (HDR style) histogram of microsecond values: exact below 8us,
+// then 8 sub-buckets per power of two, i.e. ~12.5% worst-case error.
+class Histogram {
+public:
+    static constexpr unsigned kSubBits = 3;
+    static constexpr std::size_t kSubBuckets = 1u << kSubBits;
+    static constexpr std::size_t kBuckets = 40 * kSubBuckets;
+
+    void observe(std::uint64_t micros);
+
+    struct Snapshot {
+        std::array<std::uint64_t, kBuckets> buckets{};
+        std::uint64_t count = 0;
+        std::uint64_t sum = 0;
+        std::uint64_t quantile(double q) const;
+    };
+    Snapshot snapshot() const;
+
+    static std::size_t bucket_index(std::uint64_t micros);
+    static std::uint64_t bucket_upper(std::size_t index);
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<std::uint64_t>, kBuckets> buckets{};
+        std::atomic<std::uint64_t> count{0};
+        std::atomic<std::uint64_t> sum{0};
+    };
+    std::array<Shard, metrics_detail::kShards> shards_;
+};
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& get_instance();
+
+    // Lookups take a lock; callers on hot paths should keep the returned
+    // reference, which stays valid for the lifetime of the process.
+    Counter& counter(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Gauge& gauge(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+    Histogram& histogram(const std::string& name, const std::string& help, const MetricLabels& labels = {});
+
+    std::string render_prometheus();
+
+private:
+    MetricsRegistry() = default;
+    void update_process_metrics();
+    enum class Kind { counter, gauge, histogram };
+    struct Family;
+    Family& family(const std::string& name, const std::string& help, Kind kind);
+
+    std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<Family>> families_;
+};
+
+} // namespace spectre
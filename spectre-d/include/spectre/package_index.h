@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace spectre {
+
+enum class Ecosystem { npm, pypi };
+const char* ecosystem_name(Ecosystem ecosystem);
+// The form registries compare names in: lowercase, and for PyPI runs of
+// '-', '_' and '.' folded to one '-' (PEP 503).
+std::string normalize_package_name(Ecosystem ecosystem, std::string_view name);
+
+// Read-only, memory-mapped snapshot of one registry's package names: a bloom
+// filter in front of a sorted name table. Misses are usually settled by the
+// filter alone; hits cost a binary search over the mapping.
+class PackageIndex {
+public:
+    ~PackageIndex();
+    PackageIndex(const PackageIndex&) = delete;
+    PackageIndex& operator=(const PackageIndex&) = delete;
+
+    // nullptr if the file is missing or not an index.
+    static std::unique_ptr<PackageIndex> open(const std::string& path);
+    // Writes an index of `names` (normalized already, any order, duplicates
+    // allowed) to path. Returns false with errno set on I/O failure.
+    static bool build(std::vector<std::string> names, const std::string& path);
+
+    bool contains(std::string_view normalized) const;
+    std::size_t size() const { return count_; }
+
+private:
+    PackageIndex() = default;
+    bool maybe_contains(std::string_view name) const;
+    std::string_view name_at(std::size_t i) const;
+
+    void* map_ = nullptr;
+    std::size_t map_size_ = 0;
+    std::uint64_t count_ = 0;
+    std::uint64_t bloom_bits_ = 0;
+    std::uint32_t bloom_hashes_ = 0;
+    const std::uint64_t* bloom_ = nullptr;
+    const std::uint64_t* offsets_ = nullptr;
+    const char* names_ = nullptr;
+    std::uint64_t names_size_ = 0;
+};
+
+// Whether packages exist on the public npm and PyPI registries. Answers come
+// from the snapshots in SPECTRE_PACKAGE_INDEX_DIR (npm.idx, pypi.idx; default
+// "package-index") when present, and otherwise from the registries over HTTP,
+// remembered for the SPECTRE_PACKAGE_CACHE_SIZE (default 65536) names per
+// registry used most recently.
+class RegistryLookup {
+public:
+    enum class Presence { present, absent, unknown };
+
+    static RegistryLookup& get_instance();
+
+    Presence exists(Ecosystem ecosystem, std::string_view name);
+    // One answer per name, in order. Names the snapshot cannot answer are
+    // looked up online concurrently.
+    std::vector<Presence> exists(Ecosystem ecosystem, const std::vector<std::string>& names);
+    std::string registry_url(Ecosystem ecosystem, std::string_view name) const;
+
+private:
+    // Online answers by normalized name, most recently used first.
+    struct AnswerCache {
+        std::list<std::pair<std::string, bool>> order;
+        std::unordered_map<std::string, std::list<std::pair<std::string, bool>>::iterator> entries;
+    };
+
+    RegistryLookup();
+    const PackageIndex* index(Ecosystem ecosystem);
+    // Both with cache_mutex_ held.
+    const bool* cached(AnswerCache& cache, const std::string& key);
+    void remember(AnswerCache& cache, std::string key, bool found);
+
+    std::once_flag loaded_;
+    std::unique_ptr<PackageIndex> indexes_[2];
+    std::mutex cache_mutex_;
+    std::size_t cache_capacity_ = 65536;
+    AnswerCache cache_[2];
+};
+
+} // namespace spectre
@@ -0,0 +1,83 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace spectre {
+
+// A well-known file worth fetching from a target, e.g. "/.git/config".
+struct ProbePath {
+    static constexpr std::size_t kWholeBody = SIZE_MAX;
+
+    std::string path;
+    // Any one of these in the fetched bytes confirms the file; with none, a
+    // 2xx status alone does.
+    std::vector<std::string> signatures;
+    // Leading bytes to fetch with a range GET, kWholeBody for all of it, or
+    // 0 to send HEAD.
+    std::size_t fetch = 4096;
+};
+
+struct ProbeHit {
+    std::string url;
+    std::string path;
+    long status = 0;
+    // What was fetched; may be cut short by the range.
+    std::string body;
+    // The signature that matched, empty for paths without any.
+    std::string signature;
+};
+
+// One stage for every plugin that looks for exposed files. Plugins register
+// the paths they own; the first request for a target fetches all of them in
+// one batch over the pooled client, checks every body against all signatures
+// in a single pass, and keeps the hits for SPECTRE_PATH_PROBE_TTL_S (default
+// 60) so the other owners get theirs without another request.
+class PathProbe {
+public:
+    static PathProbe& get_instance();
+
+    // Plugins register from their constructor and unregister with the id
+    // from their destructor. While a reloaded plugin overlaps its old
+    // instance, the newest registration for an owner is the one probed.
+    int register_paths(const std::string& owner, std::vector<ProbePath> paths);
+    void unregister(int id);
+
+    // Hits on owner's paths under base (a URL without trailing slash).
+    std::vector<ProbeHit> hits(const std::string& base, const std::string& owner);
+
+private:
+    PathProbe() = default;
+    struct Compiled;
+    struct Result {
+        std::uint64_t generation = 0;
+        std::chrono::steady_clock::time_point expires;
+        // Owner -> hits.
+        std::map<std::string, std::vector<ProbeHit>> hits;
+    };
+    using ResultPtr = std::shared_ptr<const Result>;
+
+    std::shared_ptr<const Compiled> compiled();
+    ResultPtr probe(const std::string& base, const Compiled& compiled);
+
+    std::mutex mutex_;
+    struct Registration {
+        std::string owner;
+        std::vector<ProbePath> paths;
+    };
+    std::map<int, Registration> registrations_;
+    int next_id_ = 0;
+    std::uint64_t generation_ = 0;
+    std::shared_ptr<const Compiled> compiled_;
+    std::unordered_map<std::string, ResultPtr> results_;
+    std::unordered_map<std::string, std::shared_future<ResultPtr>> inflight_;
+};
+
+} // namespace spectre
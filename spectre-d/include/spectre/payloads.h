@@ -0,0 +1,11 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace spectre {
+
+// Non-empty lines of a payload list. Returns an empty list if the file
+// cannot be opened.
+std::vector<std::string> load_payload_file(const std::string& path);
+
+} // namespace spectre
@@ -1,17 +1,18 @@
 #pragma once
 #include <string>
 #include <nlohmann/json.hpp>
+#include "task.h"
 
 namespace spectre {
 using json = nlohmann::json;
-struct Task {
-    json data;
-};
 class Plugin {
 public:
     virtual ~Plugin() = default;
     virtual void handle_task(const Task&) = 0;
     virtual std::string name() const = 0;
+    // Expensive setup, run once on a background thread right after loading.
+    // Must be idempotent: handle_task may need the same state first.
+    virtual void warm_up() {}
 };
 } // namespace spectre
 
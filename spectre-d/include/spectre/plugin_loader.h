@@ -1,15 +1,52 @@
 #pragma once
+#include <atomic>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 #include "plugin.h"
 
 namespace spectre {
 class PluginLoader {
 public:
+    using LoadedHandler = std::function<void(std::shared_ptr<Plugin>)>;
+    using RemovedHandler = std::function<void(const std::string& name)>;
+    // Makes the stand-in for a library that runs outside this process;
+    // nullptr on failure.
+    using Isolator = std::function<std::shared_ptr<Plugin>(const std::string& path)>;
+
     explicit PluginLoader(const std::string& directory);
+    ~PluginLoader();
     std::vector<std::shared_ptr<Plugin>> load_all();
+    // Loads one library through a private copy, so the file on disk can be
+    // overwritten while the old code is still running. nullptr on failure.
+    std::shared_ptr<Plugin> load(const std::string& path);
+    // Libraries whose file name, with or without the extension, is in
+    // `files` (every library if it holds "all") are passed to `isolator` by
+    // load() instead of being opened here. Call before load_all().
+    void isolate(std::set<std::string> files, Isolator isolator);
+
+    // Watches the directory with inotify. Libraries that are written or moved
+    // in are loaded and passed to on_loaded; deleted ones report the name of
+    // the plugin they provided to on_removed.
+    void watch(LoadedHandler on_loaded, RemovedHandler on_removed);
+    void stop_watching();
+
 private:
+    void watch_loop(int fd, LoadedHandler on_loaded, RemovedHandler on_removed);
+
     std::string dir;
+    std::string shadow_dir_;
+    std::set<std::string> isolated_files_;
+    Isolator isolator_;
+    std::atomic<std::uint64_t> generation_{0};
+    std::mutex names_mutex_;
+    std::map<std::string, std::string> names_by_file_;
+    std::atomic<bool> watching_{false};
+    std::thread watch_thread_;
 };
-} // namespace spectre 
\ No newline at end of file
+} // namespace spectre
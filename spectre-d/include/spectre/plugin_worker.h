@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "plugin.h"
+
+namespace spectre {
+
+struct WorkerOptions {
+    // Worker processes per isolated plugin.
+    std::size_t processes = 1;
+    // Threads running tasks inside each worker.
+    std::size_t threads = 4;
+    // CPUs workers are pinned to, handed out round robin across all isolated
+    // plugins. Empty leaves scheduling to the kernel.
+    std::vector<int> cpus;
+    // A worker still busy with one task this long after a worker thread
+    // picked it up is killed and restarted; time queued behind the worker's
+    // other tasks does not count. Zero disables the check.
+    std::chrono::seconds task_timeout{0};
+    // Bytes of message space in each direction of a worker's ring.
+    std::size_t ring_bytes = 4u << 20;
+
+    // SPECTRE_WORKER_PROCESSES, _THREADS, _CPUS, _TASK_TIMEOUT_S, _RING_KB.
+    static WorkerOptions from_env();
+};
+
+// Runs the plugin library at `library` in supervised child processes (this
+// executable started with --worker) and returns a stand-in Plugin for the
+// dispatcher. The library is never loaded into the calling process: the
+// stand-in takes its name from the first worker once that has loaded it, and
+// is nullptr if the worker fails to within 30 seconds. The stand-in forwards
+// tasks of the plugin's own type over a shared-memory ring and blocks until
+// the worker reports back; proofs and scan progress stream back on a second
+// ring. A worker that dies or overruns task_timeout fails the tasks it held
+// and is restarted with backoff.
+std::shared_ptr<Plugin> make_isolated_plugin(const std::string& library, const WorkerOptions& options);
+
+bool is_worker_invocation(int argc, char* argv[]);
+// main() for `spectre-d --worker ...`. Returns the process exit code.
+int run_plugin_worker(int argc, char* argv[]);
+
+} // namespace spectre
@@ -1,6 +1,8 @@
 #pragma once
 
-#include <vector>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <string>
 #include <nlohmann/json.hpp>
 #include <mutex>
@@ -22,7 +24,11 @@ public:
 
 private:
     void process_proofs();
-    std::vector<VulnProof> proofs_;
+    struct Pending {
+        VulnProof proof;
+        std::uint64_t enqueued_ns;
+    };
+    std::deque<Pending> proofs_;
     std::mutex mutex_;
     std::condition_variable cv_;
     bool stop_ = false;
@@ -33,6 +39,9 @@ private:
 
 void enqueue_proof(const VulnProof& proof);
 void init_proof_queue(WebSocketServer& ws);
+// Sends proofs to `sink` instead of the queue. Plugin worker processes use it
+// to hand proofs back to the daemon. Set before any plugin runs.
+void set_proof_sink(std::function<void(const VulnProof&)> sink);
 void shutdown_proof_queue();
 
 } // namespace spectre 
\ No newline at end of file
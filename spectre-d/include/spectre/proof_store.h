@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "arweave_client.h"
+
+namespace spectre {
+
+struct ProofQuery {
+    std::string target;
+    std::string vuln_type;
+    std::string scan_id;
+    std::int64_t since = 0;
+    std::int64_t until = std::numeric_limits<std::int64_t>::max();
+    std::uint64_t cursor = 0;
+};
+
+struct ProofPage {
+    // Records written to out.
+    std::size_t count = 0;
+    // Last record taken, including any skipped because it could not be read.
+    std::uint64_t last_seq = 0;
+    bool exhausted = false;
+};
+
+// Append-only JSON-lines file of every proof the daemon has produced, with an
+// in-memory index so queries only touch the records they return. Queries on
+// target, vuln type or scan id walk that field's posting list rather than
+// every record.
+class ProofStore {
+public:
+    static ProofStore& get_instance();
+    ~ProofStore();
+
+    bool open(const std::string& path);
+    std::uint64_t append(const VulnProof& proof);
+
+    // Appends up to max_records matching records (comma separated JSON
+    // objects, prefixed with a comma when `continuation` is set) to out.
+    // A record that cannot be read back is logged and left out.
+    ProofPage read_page(const ProofQuery& query, std::size_t max_records, std::string& out, bool continuation);
+
+private:
+    ProofStore() = default;
+
+    struct Entry {
+        std::uint64_t seq;
+        std::uint64_t offset;
+        std::uint32_t length;
+        std::int64_t timestamp;
+        std::string target;
+        std::string vuln_type;
+        std::string scan_id;
+    };
+    // Positions in index_, ascending, of the records with one field value.
+    using Postings = std::unordered_map<std::string, std::vector<std::uint32_t>>;
+
+    // With mutex_ held exclusively.
+    void add_entry(Entry entry);
+
+    std::shared_mutex mutex_;
+    std::vector<Entry> index_;
+    Postings by_target_;
+    Postings by_vuln_type_;
+    Postings by_scan_id_;
+    std::uint64_t end_offset_ = 0;
+    std::uint64_t next_seq_ = 1;
+    int write_fd_ = -1;
+    int read_fd_ = -1;
+};
+
+} // namespace spectre
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+namespace spectre {
+using json = nlohmann::json;
+
+// What some piece of work cost. The dispatcher measures one per plugin per
+// task and charges it to the plugin, the task type and the scan.
+struct ResourceUsage {
+    std::uint64_t cpu_ns = 0;
+    std::uint64_t allocated_bytes = 0;
+    std::uint64_t requests = 0;
+    std::uint64_t bytes_sent = 0;
+    std::uint64_t bytes_received = 0;
+
+    ResourceUsage& operator+=(const ResourceUsage& other);
+};
+
+inline void to_json(json& j, const ResourceUsage& usage) {
+    j = json{
+        {"cpu_ms", static_cast<double>(usage.cpu_ns) / 1e6},
+        {"allocated_bytes", usage.allocated_bytes},
+        {"requests", usage.requests},
+        {"bytes_sent", usage.bytes_sent},
+        {"bytes_received", usage.bytes_received}
+    };
+}
+
+// Bytes requested through operator new on this thread. spectre-d's own
+// operator new adds to it; in other executables it stays at zero.
+extern constinit thread_local std::uint64_t tls_allocated_bytes;
+
+// Charges an outbound request to the calling thread. HttpClient calls it.
+void usage_record_request(std::uint64_t bytes_sent, std::uint64_t bytes_received);
+// Charges usage incurred elsewhere on this thread's behalf, e.g. by a plugin
+// worker process.
+void usage_record_remote(const ResourceUsage& usage);
+
+// Measures what the calling thread uses between construction and elapsed().
+// Threads a plugin starts itself are not included.
+class UsageMeter {
+public:
+    UsageMeter();
+    ResourceUsage elapsed() const;
+
+private:
+    static ResourceUsage now();
+    ResourceUsage start_;
+};
+
+} // namespace spectre
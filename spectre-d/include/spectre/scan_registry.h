@@ -0,0 +1,100 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+#include "resource_usage.h"
+
+namespace spectre {
+using json = nlohmann::json;
+
+enum class ScanState { queued, running, done, failed };
+
+// Live counters for one scan. Plugins update them through the scan_* helpers
+// below, which resolve the scan from the calling worker thread.
+struct ScanProgress {
+    std::atomic<std::uint64_t> requests_sent{0};
+    std::atomic<std::uint64_t> payloads_total{0};
+    std::atomic<std::uint64_t> payloads_done{0};
+    std::atomic<std::uint64_t> findings{0};
+};
+
+class ScanRegistry {
+public:
+    using EventSink = std::function<void(const std::string&)>;
+
+    static ScanRegistry& get_instance();
+
+    std::string create(const std::string& type, const std::string& target);
+    // Registers a scan id assigned elsewhere (another daemon, the CLI).
+    void ensure(const std::string& id, const std::string& type, const std::string& target);
+    std::shared_ptr<ScanProgress> mark_running(const std::string& id);
+    void mark_finished(const std::string& id, bool ok, const std::string& error = "");
+    // Adds what one plugin used on the scan; reported under "usage".
+    void add_usage(const std::string& id, const std::string& plugin, const ResourceUsage& usage);
+
+    std::optional<json> status(const std::string& id);
+    json summary();
+
+    // Progress events are pushed to the sink on state changes immediately and
+    // otherwise at most once per interval per scan.
+    void start_events(EventSink sink, std::chrono::milliseconds interval);
+    void stop_events();
+
+    static std::string new_id();
+
+private:
+    ScanRegistry() = default;
+    struct Entry;
+    json to_json(const Entry& entry) const;
+    void emit(const json& event);
+    void event_loop();
+    void retire(const std::string& id);
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Entry>> scans_;
+    std::deque<std::string> finished_;
+    EventSink sink_;
+    std::chrono::milliseconds interval_{500};
+    std::thread events_thread_;
+    std::condition_variable events_cv_;
+    bool events_running_ = false;
+};
+
+// Binds the calling thread to a scan while a task is being dispatched.
+class ScanScope {
+public:
+    ScanScope(std::string id, std::shared_ptr<ScanProgress> progress);
+    ~ScanScope();
+    ScanScope(const ScanScope&) = delete;
+    ScanScope& operator=(const ScanScope&) = delete;
+};
+
+const std::string& current_scan_id();
+// Counters of the scan bound to this thread; null outside a ScanScope.
+const std::shared_ptr<ScanProgress>& current_scan_progress();
+void scan_request_sent();
+void scan_add_payloads(std::uint64_t count);
+void scan_payload_done();
+void scan_finding();
+
+// Results a scan hands on while it runs: each page a crawl reaches ("url"),
+// each proof it raises ("finding"). The workflow scheduler feeds them to the
+// stages downstream. Set the sink before any plugin runs.
+using ScanOutputSink = std::function<void(const std::string& scan_id, const std::string& kind, const json& value)>;
+void set_scan_output_sink(ScanOutputSink sink);
+void publish_scan_output(const std::string& scan_id, const std::string& kind, const json& value);
+// Publishes for the scan bound to this thread; a no-op outside a ScanScope.
+void scan_output(const std::string& kind, const json& value);
+
+} // namespace spectre
@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace spectre {
+
+// Single-producer single-consumer queue of length-prefixed messages in memory
+// shared between two processes. Head and tail are lock-free atomics in the
+// shared header; a side that runs dry sleeps on a futex word the other side
+// bumps. The ring does not own its memory.
+class ShmRing {
+public:
+    ShmRing() = default;
+
+    // Bytes of shared memory a ring with `capacity` bytes of message space
+    // needs. capacity is rounded up to a power of two.
+    static std::size_t region_size(std::size_t capacity);
+    // Lays out an empty ring in `memory` (region_size(capacity) bytes).
+    static ShmRing create(void* memory, std::size_t capacity);
+    // Uses a ring the other process created.
+    static ShmRing attach(void* memory);
+
+    bool try_push(std::string_view message);
+    // Waits up to timeout for room. false also when the message can never fit.
+    bool push(std::string_view message, std::chrono::milliseconds timeout);
+    bool try_pop(std::string& out);
+    bool pop(std::string& out, std::chrono::milliseconds timeout);
+
+    std::size_t max_message() const;
+    explicit operator bool() const { return header_ != nullptr; }
+
+private:
+    struct Header;
+    ShmRing(Header* header, unsigned char* data, std::uint64_t capacity)
+        : header_(header), data_(data), capacity_(capacity) {}
+    void copy_in(std::uint64_t pos, const void* src, std::size_t len);
+    void copy_out(std::uint64_t pos, void* dst, std::size_t len) const;
+
+    Header* header_ = nullptr;
+    unsigned char* data_ = nullptr;
+    // Copied out of the header so the other side cannot change it later.
+    std::uint64_t capacity_ = 0;
+};
+
+} // namespace spectre
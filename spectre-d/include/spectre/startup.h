@@ -0,0 +1,51 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace spectre {
+using json = nlohmann::json;
+
+// Tracks daemon startup for GET /ready. Required components gate readiness;
+// optional ones (background warm-ups, the Tor probe) are only reported.
+// Also records time to ready and time to the first accepted task.
+class Startup {
+public:
+    static Startup& get_instance();
+
+    // Starts the clock; call first thing in main.
+    void begin();
+    void pending(const std::string& component, bool required = true);
+    void ready(const std::string& component);
+
+    bool is_ready();
+    json status();
+
+    // Cheap after the first call; the dispatcher calls it for every task.
+    void task_accepted() {
+        if (!first_task_seen_.load(std::memory_order_relaxed)) record_first_task();
+    }
+
+private:
+    Startup() = default;
+    void record_first_task();
+    std::int64_t elapsed_ms() const;
+
+    struct Component {
+        bool required = true;
+        bool ready = false;
+        std::int64_t ready_ms = -1;
+    };
+
+    std::chrono::steady_clock::time_point started_ = std::chrono::steady_clock::now();
+    std::mutex mutex_;
+    std::map<std::string, Component> components_;
+    std::int64_t ready_ms_ = -1;
+    std::int64_t first_task_ms_ = -1;
+    std::atomic<bool> first_task_seen_{false};
+};
+
+} // namespace spectre
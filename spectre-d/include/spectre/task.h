@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace spectre {
+
+// Process-wide handle for a task type name. Plugins intern their type once
+// and compare integers per task instead of strings.
+using TaskType = std::uint32_t;
+constexpr TaskType kNoTaskType = 0;
+
+// Returns kNoTaskType for an empty name or once kMaxTaskTypes distinct names
+// exist. Only for names the daemon trusts: plugins and code.
+constexpr std::size_t kMaxTaskTypes = 4096;
+TaskType intern_task_type(std::string_view name);
+// Looks a name up without adding it, for types that arrive from peers and
+// clients. Names no plugin registered map to the "unknown" type.
+TaskType find_task_type(std::string_view name);
+const std::string& task_type_name(TaskType type);
+
+// Components of a task target, split once at ingest. Userinfo is dropped and
+// port is 0 when the URL does not name one.
+struct TargetUrl {
+    std::string scheme;
+    std::string host;
+    unsigned short port = 0;
+    std::string path;
+    std::string query;
+};
+TargetUrl parse_target_url(std::string_view url);
+
+struct Task {
+    TaskType type = kNoTaskType;
+    std::string target;
+    TargetUrl url;
+    std::string id;
+    // Scalar option values as text, nested objects and arrays as compact JSON.
+    std::map<std::string, std::string> options;
+    // The task as it arrived on the wire, re-broadcast without serialising
+    // again. Not updated when the dispatcher assigns an id.
+    std::string raw;
+
+    const std::string& type_name() const { return task_type_name(type); }
+};
+
+// Single pass over the bytes with no intermediate DOM. Throws
+// std::invalid_argument for malformed JSON, a non-object root, or a type,
+// target or id that is not a string. Unknown top-level keys are ignored.
+Task parse_task(std::string raw);
+
+// Builds a task in code and fills in its wire form.
+Task make_task(std::string_view type, std::string target, std::string id = "",
+               std::map<std::string, std::string> options = {});
+
+} // namespace spectre
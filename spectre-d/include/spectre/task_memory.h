@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+namespace spectre {
+
+// Bump allocator for one task's short-lived temporaries: query parameter
+// lists, encoded payloads, scratch buffers. Allocations walk a pointer through a
+// block reused from task to task; once the block is full they go to the
+// fallback resource instead. Freeing arena memory is a no-op, and reset()
+// takes everything back at once. Not thread-safe.
+class TaskArena final : public std::pmr::memory_resource {
+public:
+    TaskArena(std::pmr::memory_resource* fallback, std::size_t capacity);
+
+    void reset();
+    std::size_t used() const { return static_cast<std::size_t>(cur_ - begin_); }
+    std::size_t overflow_bytes() const { return overflow_; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t align) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    std::pmr::memory_resource* fallback_;
+    std::size_t capacity_;
+    std::unique_ptr<std::byte[]> block_;
+    std::byte* begin_ = nullptr;
+    std::byte* cur_ = nullptr;
+    std::byte* end_ = nullptr;
+    std::size_t overflow_ = 0;
+};
+
+// Binds the calling thread's arena for the length of a task; the dispatcher
+// opens one per task. Each worker thread has its own arena (capacity
+// SPECTRE_TASK_ARENA_KB, default 1024) backed by a per-thread pool, and both
+// are emptied when the outermost scope closes.
+class TaskArenaScope {
+public:
+    TaskArenaScope();
+    ~TaskArenaScope();
+    TaskArenaScope(const TaskArenaScope&) = delete;
+    TaskArenaScope& operator=(const TaskArenaScope&) = delete;
+};
+
+// Memory for temporaries of the task running on this thread; the global
+// heap outside a task. Opt-in: nothing allocates here unless passed it.
+// Anything allocated from it must be gone by the end of the task and must not
+// be grown from another thread.
+std::pmr::memory_resource* task_memory();
+
+} // namespace spectre
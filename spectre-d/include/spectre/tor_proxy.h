@@ -1,4 +1,6 @@
 #pragma once
+#include <future>
+#include <mutex>
 
 namespace spectre {
 
@@ -6,11 +8,18 @@ class TorProxy {
 public:
     static TorProxy& get_instance();
 
+    // Probes the local SOCKS port on a background thread; idempotent.
+    void start_probe();
+    // Starts the probe if needed and waits for it (bounded by the connect
+    // timeout), so no request goes out before anonymity is known.
     bool is_available();
 
 private:
-    TorProxy();
-    bool available_ = false;
+    TorProxy() = default;
+    static bool probe();
+
+    std::once_flag started_;
+    std::shared_future<bool> available_;
 };
 
-} // namespace spectre 
\ No newline at end of file
+} // namespace spectre
@@ -0,0 +1,71 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace spectre {
+
+namespace trace_detail {
+extern std::atomic<bool> enabled;
+struct ThreadBufferHolder;
+} // namespace trace_detail
+
+inline bool tracing_enabled() {
+    return trace_detail::enabled.load(std::memory_order_relaxed);
+}
+
+std::uint64_t trace_now();
+
+// Records a finished span. Name, category and detail are copied (and
+// truncated), so callers may pass temporaries.
+void trace_complete(std::string_view name, std::string_view category, std::uint64_t start_ns,
+                    std::uint64_t end_ns, std::string_view detail = {});
+
+// Scoped span. The strings are only copied when the span ends, so they must
+// outlive it. When tracing is off the constructor is a single relaxed load and
+// the destructor a branch.
+class TraceSpan {
+public:
+    TraceSpan(std::string_view name, std::string_view category, std::string_view detail = {})
+        : name_(name), category_(category), detail_(detail), start_(tracing_enabled() ? trace_now() : 0) {}
+    ~TraceSpan() {
+        if (start_) trace_complete(name_, category_, start_, trace_now(), detail_);
+    }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    std::string_view name_;
+    std::string_view category_;
+    std::string_view detail_;
+    std::uint64_t start_;
+};
+
+// Per-thread flight recorder of recent spans, exported in Chrome trace-event
+// JSON (loadable in chrome://tracing and ui.perfetto.dev).
+class Tracer {
+public:
+    static Tracer& get_instance();
+
+    void set_enabled(bool on);
+    bool enabled() const { return tracing_enabled(); }
+    void clear();
+
+    void write_chrome_trace(std::ostream& out);
+    // Writes a trace file into dir and returns its path, or "" on failure.
+    std::string dump_to_file(const std::string& dir);
+
+private:
+    Tracer();
+    ~Tracer();
+    friend void trace_complete(std::string_view, std::string_view, std::uint64_t, std::uint64_t, std::string_view);
+    friend struct trace_detail::ThreadBufferHolder;
+
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace spectre
@@ -0,0 +1,35 @@
+#pragma once
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace spectre {
+
+// Decodes %XX escapes and '+' as used in query strings and form bodies.
+std::string percent_decode(std::string_view in);
+
+// Decoded key/value pairs of a query string or form body (without the '?').
+// Later duplicates win; pairs with an empty key are skipped.
+std::map<std::string, std::string> parse_query(std::string_view query);
+
+// Percent-encodes everything except RFC 3986 unreserved characters, as
+// cpr::util::urlEncode does, into memory from mr. Probe loops pass
+// task_memory() for encodings that do not outlive the task.
+std::pmr::string url_encode(std::string_view in, std::pmr::memory_resource* mr = std::pmr::new_delete_resource());
+
+// Names of the query parameters in url, raw as they appear (the form
+// with_query_param matches), first occurrence only, into memory from mr.
+std::pmr::vector<std::pmr::string> query_param_names(std::string_view url,
+                                                     std::pmr::memory_resource* mr = std::pmr::new_delete_resource());
+
+// Replaces the value of every `param=...` pair in the query string of url
+// with value (inserted verbatim; encode it first if needed). Probes build
+// the URL they send this way: cpr and proofs take a std::string anyway.
+std::string with_query_param(std::string_view url, std::string_view param, std::string_view value);
+
+// href targets of the <a> tags in an HTML document, in document order.
+std::vector<std::string> extract_links(const std::string& html);
+
+} // namespace spectre
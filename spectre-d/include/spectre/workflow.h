@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "dispatcher.h"
+
+namespace spectre {
+using json = nlohmann::json;
+
+// Runs a scan as a DAG of stages on the local dispatcher. A stage with
+// for_each gets one task per distinct item its upstream stages output ("url"
+// from a crawl, "finding" from any proof) and starts as soon as the first one
+// arrives, so stages overlap. A stage without it runs once against the
+// workflow target after its upstream stages finish. At most max_concurrency
+// tasks of a workflow are on the dispatcher at once; the rest wait here.
+// Destroying the scheduler stops the dispatcher, whose threads call into it.
+class WorkflowScheduler {
+public:
+    explicit WorkflowScheduler(Dispatcher& dispatcher);
+    ~WorkflowScheduler();
+    WorkflowScheduler(const WorkflowScheduler&) = delete;
+    WorkflowScheduler& operator=(const WorkflowScheduler&) = delete;
+
+    // Starts the workflow and returns its id. Throws std::invalid_argument
+    // with a message for the client when the spec is not a valid DAG of
+    // loaded plugins.
+    std::string submit(const json& spec);
+    std::optional<json> status(const std::string& id);
+
+private:
+    struct Stage;
+    struct Workflow;
+    struct Queued {
+        std::size_t stage;
+        std::string type;
+        std::string target;
+        std::map<std::string, std::string> options;
+    };
+
+    void on_output(const std::string& scan_id, const std::string& kind, const json& value);
+    void on_done(const std::string& scan_id, bool ok);
+    void add_item(Workflow& workflow, std::size_t stage, const std::string& key, const std::string& target,
+                  std::map<std::string, std::string> options);
+    // Launches barrier stages that became ready, closes finished ones and
+    // fills free slots. Returns the tasks to hand to the dispatcher once the
+    // lock is released.
+    std::vector<Task> advance(const std::shared_ptr<Workflow>& workflow);
+    void dispatch(std::vector<Task> tasks);
+    json to_json(const Workflow& workflow) const;
+
+    Dispatcher& dispatcher_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Workflow>> workflows_;
+    std::deque<std::string> finished_;
+    struct Owner {
+        std::shared_ptr<Workflow> workflow;
+        std::size_t stage;
+    };
+    // Scans on the dispatcher -> the stage they run for.
+    std::unordered_map<std::string, Owner> scans_;
+};
+
+} // namespace spectre
@@ -1,14 +1,29 @@
 #include "spectre/plugin.h"
 #include "spectre/proof_queue.h"
 #include "spectre/tor_proxy.h"
+#include "spectre/http_client.h"
+#include "spectre/scan_registry.h"
+#include "spectre/api_schema.h"
+#include "spectre/log.h"
 #include <cpr/cpr.h>
 #include <nlohmann/json.hpp>
-#include <iostream>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <set>
 #include <string>
 #include <vector>
 
 namespace {
 
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("api_fuzzer");
+const spectre::TaskType task_type = spectre::intern_task_type("api_fuzzer");
+
+std::size_t env_size(const char* name, std::size_t fallback) {
+    const char* value = std::getenv(name);
+    return value && *value ? std::strtoull(value, nullptr, 10) : fallback;
+}
+
 class APIFuzzer : public spectre::Plugin {
 private:
     struct FuzzPayload {
@@ -16,64 +31,185 @@ private:
         std::string body;
     };
 
-    std::vector<FuzzPayload> fuzz_payloads = {
-        {"Empty JSON", "{}"},
-        {"Malformed JSON", "{\"key\": \"value\""},
-        {"Large String", "{\"data\": \"" + std::string(10000, 'A') + "\"}"},
-        {"Special Chars", "{\"data\": \"!@#$%^&*()_+-=[]{};':\\\",./<>?`~\"}"},
-        {"SQLi Attempt", "{\"id\": \"' OR 1=1 --\"}"},
-        {"XSS Attempt", "{\"html\": \"<script>alert('fuzzer')</script>\"}"}
-    };
+    // Sent when the target has no schema. Built once for every instance.
+    static const std::vector<FuzzPayload>& fixed_payloads() {
+        static const std::vector<FuzzPayload> payloads = {
+            {"Empty JSON", "{}"},
+            {"Malformed JSON", "{\"key\": \"value\""},
+            {"Large String", "{\"data\": \"" + std::string(10000, 'A') + "\"}"},
+            {"Special Chars", "{\"data\": \"!@#$%^&*()_+-=[]{};':\\\",./<>?`~\"}"},
+            {"SQLi Attempt", "{\"id\": \"' OR 1=1 --\"}"},
+            {"XSS Attempt", "{\"html\": \"<script>alert('fuzzer')</script>\"}"}
+        };
+        return payloads;
+    }
 
 public:
     std::string name() const override { return "api_fuzzer"; }
-    
+
     void handle_task(const spectre::Task& task) override {
-        if (task.data.value("type", "") != name()) {
+        if (task.type != task_type) {
             return;
         }
-        
-        std::string url = task.data.value("target", "");
+
+        const std::string& url = task.target;
         if (url.empty()) {
             return;
         }
-        
-        std::cout << "[api_fuzzer] fuzzing " << url << std::endl;
 
-        for (const auto& payload : fuzz_payloads) {
-            test_payload(url, payload);
+        logger.info("fuzzing", {{"target", url}});
+
+        if (auto corpus = load_schema(task)) {
+            fuzz_schema(url, *corpus, max_requests(task));
+        } else {
+            fuzz_fixed(url);
         }
     }
 
 private:
-    void test_payload(const std::string& url, const FuzzPayload& payload) {
-        cpr::Session session;
-        session.SetUrl(cpr::Url{url});
-        session.SetHeader({{"Content-Type", "application/json"}});
-        session.SetBody(cpr::Body{payload.body});
-        session.SetTimeout(cpr::Timeout{10000});
+    // SPECTRE_API_SCHEMA_DIR/<name>, where name is the "schema" option or
+    // else "<host>.json". Tasks come from peers, so the option may only name
+    // a file in that directory.
+    static std::shared_ptr<const spectre::ApiCorpus> load_schema(const spectre::Task& task) {
+        const char* dir = std::getenv("SPECTRE_API_SCHEMA_DIR");
+        if (!dir || !*dir) return nullptr;
+        std::string name;
+        if (auto it = task.options.find("schema"); it != task.options.end()) {
+            name = it->second;
+            if (name.empty() || name == "." || name == ".." || name.find('/') != std::string::npos ||
+                name.find('\\') != std::string::npos) {
+                logger.warn("ignoring schema option that is not a plain file name", {{"schema", name}});
+                return nullptr;
+            }
+        } else if (!task.url.host.empty()) {
+            name = task.url.host + ".json";
+        } else {
+            return nullptr;
+        }
+        std::string path = std::string(dir) + "/" + name;
+        std::error_code ec;
+        if (!std::filesystem::is_regular_file(path, ec)) return nullptr;
+        return spectre::ApiCorpus::load(path);
+    }
+
+    static std::size_t max_requests(const spectre::Task& task) {
+        if (auto it = task.options.find("max_requests"); it != task.options.end()) {
+            return std::strtoull(it->second.c_str(), nullptr, 10);
+        }
+        static const std::size_t fallback = env_size("SPECTRE_API_FUZZ_MAX_REQUESTS", 1000);
+        return fallback;
+    }
+
+    static std::size_t concurrency() {
+        static const std::size_t value = std::max<std::size_t>(1, env_size("SPECTRE_API_FUZZ_CONCURRENCY", 16));
+        return value;
+    }
 
-        if (spectre::TorProxy::get_instance().is_available()) {
+    static void prepare(cpr::Session& session, const std::string& url, const std::string& body, bool use_tor) {
+        spectre::HttpClient::get_instance().set_url(session, url);
+        if (!body.empty()) session.SetBody(cpr::Body{body});
+        session.SetTimeout(cpr::Timeout{10000});
+        if (use_tor) {
             session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
                                 {"https", "socks5://127.0.0.1:9050"}});
         }
+    }
+
+    void fuzz_fixed(const std::string& url) {
+        const auto& payloads = fixed_payloads();
+        spectre::scan_add_payloads(payloads.size());
+        bool use_tor = spectre::TorProxy::get_instance().is_available();
+        std::deque<cpr::Session> sessions;
+        std::vector<cpr::Session*> batch;
+        for (const auto& payload : payloads) {
+            cpr::Session& session = sessions.emplace_back();
+            session.SetHeader({{"Content-Type", "application/json"}});
+            prepare(session, url, payload.body, use_tor);
+            batch.push_back(&session);
+        }
+        auto responses = spectre::HttpClient::get_instance().send_all(batch, {spectre::HttpClient::Method::post});
+        for (std::size_t i = 0; i < payloads.size(); ++i) {
+            if (responses[i].status_code >= 500) {
+                logger.warn("vulnerability discovered (server error)",
+                            {{"target", url}, {"payload", payloads[i].name}, {"status", responses[i].status_code}});
+                submit_proof(url, payloads[i].name, payloads[i].body, responses[i].status_code, nlohmann::json::object());
+            }
+            spectre::scan_payload_done();
+        }
+    }
+
+    // Streams the corpus through the shared client, `concurrency()` requests
+    // at a time, stopping after `limit`. An operation whose valid baseline
+    // already fails is not reported, and each field is reported once.
+    void fuzz_schema(const std::string& url, const spectre::ApiCorpus& corpus, std::size_t limit) {
+        std::size_t planned = std::min(corpus.size(), limit);
+        spectre::scan_add_payloads(planned);
+        logger.info("fuzzing from schema",
+                    {{"target", url}, {"operations", corpus.operations().size()}, {"requests", planned},
+                     {"available", corpus.size()}});
 
-        cpr::Response r = session.Post();
+        bool use_tor = spectre::TorProxy::get_instance().is_available();
+        spectre::ApiCorpus::Cursor cursor(corpus, url);
+        std::vector<bool> baseline_fails(corpus.operations().size());
+        std::set<std::pair<std::size_t, std::string>> reported;
+        std::vector<spectre::ApiRequest> requests(concurrency());
+        std::size_t sent = 0;
+        while (sent < planned) {
+            std::size_t count = 0;
+            while (count < requests.size() && sent + count < planned && cursor.next(requests[count])) ++count;
+            if (count == 0) break;
 
-        if (r.status_code >= 500) {
-            std::cout << "[api_fuzzer] VULNERABILITY DISCOVERED (Server Error)" << std::endl;
-            std::cout << "  -> Target: " << url << std::endl;
-            std::cout << "  -> Payload Name: " << payload.name << std::endl;
-            std::cout << "  -> Status Code: " << r.status_code << std::endl;
-            submit_proof(url, payload, r.status_code);
+            std::deque<cpr::Session> sessions;
+            std::vector<cpr::Session*> batch;
+            std::vector<spectre::HttpClient::Method> methods;
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto& request = requests[i];
+                cpr::Session& session = sessions.emplace_back();
+                cpr::Header header;
+                for (const auto& [key, value] : request.headers) header[key] = value;
+                session.SetHeader(header);
+                prepare(session, request.url, request.body, use_tor);
+                batch.push_back(&session);
+                methods.push_back(method_of(request.method));
+            }
+            auto responses = spectre::HttpClient::get_instance().send_all(batch, methods);
+
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto& request = requests[i];
+                long status = responses[i].status_code;
+                if (request.field.empty()) {
+                    baseline_fails[request.operation] = status >= 500;
+                } else if (status >= 500 && !baseline_fails[request.operation] &&
+                           reported.emplace(request.operation, request.field).second) {
+                    const auto& op = corpus.operations()[request.operation];
+                    std::string name = op.method + " " + op.path + " " + request.field + ": " + request.mutation;
+                    logger.warn("vulnerability discovered (server error)",
+                                {{"target", url}, {"payload", name}, {"status", status}});
+                    submit_proof(url, name, request.body, status,
+                                 {{"request_method", request.method},
+                                  {"request_url", request.url},
+                                  {"field", request.field},
+                                  {"mutation", request.mutation}});
+                }
+                spectre::scan_payload_done();
+            }
+            sent += count;
         }
     }
 
-    void submit_proof(const std::string& target, const FuzzPayload& payload, int status_code) {
-        nlohmann::json evidence;
+    static spectre::HttpClient::Method method_of(const std::string& method) {
+        using Method = spectre::HttpClient::Method;
+        if (method == "POST") return Method::post;
+        if (method == "PUT") return Method::put;
+        if (method == "PATCH") return Method::patch;
+        return Method::get;
+    }
+
+    void submit_proof(const std::string& target, const std::string& payload_name, const std::string& payload_body,
+                      long status_code, nlohmann::json evidence) {
         evidence["description"] = "The API endpoint returned a server error when fuzzed with a malformed request, indicating a potential unhandled exception or other vulnerability.";
-        evidence["payload_name"] = payload.name;
-        evidence["payload_body"] = payload.body;
+        evidence["payload_name"] = payload_name;
+        evidence["payload_body"] = payload_body;
         evidence["response_status_code"] = status_code;
 
         spectre::VulnProof proof = {
@@ -84,7 +220,7 @@ private:
             ""
         };
         spectre::enqueue_proof(proof);
-        std::cout << "[api_fuzzer] proof queued" << std::endl;
+        logger.debug("proof queued");
     }
 };
 
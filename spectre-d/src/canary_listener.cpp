@@ -0,0 +1,286 @@
+#include "spectre/canary_listener.h"
+#include "spectre/log.h"
+#include "spectre/metrics.h"
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <array>
+#include <chrono>
+#include <optional>
+#include <cctype>
+#include <cstdlib>
+#include <thread>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using udp = net::ip::udp;
+
+namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("canary_listener");
+
+Counter& callbacks(const char* protocol) {
+    return MetricsRegistry::get_instance().counter("spectre_canary_callbacks_total",
+                                                   "Requests and queries received by the built-in canary listener.",
+                                                   {{"protocol", protocol}});
+}
+
+unsigned short env_port(const char* name, unsigned short fallback) {
+    const char* value = std::getenv(name);
+    return value ? static_cast<unsigned short>(std::strtoul(value, nullptr, 10)) : fallback;
+}
+
+std::string lower(std::string s) {
+    for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+// A callback has this long to send its request and read the answer.
+constexpr auto kCallbackTimeout = std::chrono::seconds(10);
+
+class HttpCallback : public std::enable_shared_from_this<HttpCallback> {
+public:
+    HttpCallback(tcp::socket socket, const CanaryListener::SeenHandler& on_seen, std::size_t& open)
+        : stream_(std::move(socket)), on_seen_(on_seen), open_(open) {
+        ++open_;
+    }
+    ~HttpCallback() { --open_; }
+
+    void run() {
+        parser_.body_limit(64 * 1024);
+        stream_.expires_after(kCallbackTimeout);
+        http::async_read(stream_, buffer_, parser_,
+                         beast::bind_front_handler(&HttpCallback::on_read, shared_from_this()));
+    }
+
+private:
+    void on_read(beast::error_code ec, std::size_t) {
+        if (ec) return;
+        const auto& req = parser_.get();
+        callbacks("http").inc();
+        on_seen_(std::string(req[http::field::host]) + " " + std::string(req.method_string()) + " " +
+                 std::string(req.target()));
+
+        response_.result(http::status::ok);
+        response_.set(http::field::content_type, "text/plain");
+        response_.keep_alive(false);
+        response_.body() = "ok\n";
+        response_.prepare_payload();
+        stream_.expires_after(kCallbackTimeout);
+        http::async_write(stream_, response_, [self = shared_from_this()](beast::error_code, std::size_t) {
+            beast::error_code ignored;
+            self->stream_.socket().shutdown(tcp::socket::shutdown_send, ignored);
+        });
+    }
+
+    beast::tcp_stream stream_;
+    const CanaryListener::SeenHandler& on_seen_;
+    std::size_t& open_;
+    beast::flat_buffer buffer_;
+    http::request_parser<http::string_body> parser_;
+    http::response<http::string_body> response_;
+};
+
+// Answers from the question alone: no recursion, no compression in what it
+// reads, one A record with TTL 0 so every resolution reaches us.
+class DnsResponder {
+public:
+    DnsResponder(udp::socket socket, std::string domain, net::ip::address answer,
+                 const CanaryListener::SeenHandler& on_seen)
+        : socket_(std::move(socket)), domain_(lower(std::move(domain))), answer_(answer), on_seen_(on_seen) {}
+
+    void run() {
+        socket_.async_receive_from(net::buffer(buffer_), peer_, [this](beast::error_code ec, std::size_t n) {
+            if (ec == net::error::operation_aborted) return;
+            if (!ec) handle(n);
+            run();
+        });
+    }
+
+private:
+    void handle(std::size_t n) {
+        constexpr std::size_t kHeader = 12;
+        if (n < kHeader + 5 || (buffer_[2] & 0x80)) return;
+        std::size_t pos = kHeader;
+        std::string name;
+        while (pos < n && buffer_[pos] != 0) {
+            std::size_t len = buffer_[pos];
+            if (len > 63 || pos + 1 + len >= n) return;
+            if (!name.empty()) name += '.';
+            name.append(reinterpret_cast<const char*>(&buffer_[pos + 1]), len);
+            pos += 1 + len;
+        }
+        if (pos + 5 > n) return;
+        std::size_t question_end = pos + 5;
+        unsigned qtype = (buffer_[pos + 1] << 8) | buffer_[pos + 2];
+        name = lower(std::move(name));
+        callbacks("dns").inc();
+        on_seen_(name);
+
+        bool in_zone = domain_.empty() || name == domain_ ||
+                       (name.size() > domain_.size() && name.ends_with("." + domain_));
+        std::string out(reinterpret_cast<const char*>(buffer_.data()), question_end);
+        out[2] = static_cast<char>(0x84 | (buffer_[2] & 0x79));  // QR, AA, opcode and RD echoed
+        out[3] = static_cast<char>(in_zone ? 0 : 5);             // NOERROR or REFUSED
+        out[4] = 0;
+        out[5] = 1;
+        out[6] = out[7] = out[8] = out[9] = out[10] = out[11] = 0;
+        if (in_zone && answer_.is_v4() && !answer_.is_unspecified() && (qtype == 1 || qtype == 255)) {
+            out[7] = 1;
+            const unsigned char record[] = {0xc0, 0x0c, 0, 1, 0, 1, 0, 0, 0, 0, 0, 4};
+            out.append(reinterpret_cast<const char*>(record), sizeof(record));
+            auto bytes = answer_.to_v4().to_bytes();
+            out.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        }
+        beast::error_code ignored;
+        socket_.send_to(net::buffer(out), peer_, 0, ignored);
+    }
+
+    udp::socket socket_;
+    std::string domain_;
+    net::ip::address answer_;
+    const CanaryListener::SeenHandler& on_seen_;
+    std::array<unsigned char, 512> buffer_{};
+    udp::endpoint peer_;
+};
+} // namespace
+
+CanaryListenerOptions CanaryListenerOptions::from_env() {
+    CanaryListenerOptions options;
+    if (const char* v = std::getenv("SPECTRE_CANARY_LISTEN")) options.address = v;
+    options.http_port = env_port("SPECTRE_CANARY_HTTP_PORT", options.http_port);
+    options.dns_port = env_port("SPECTRE_CANARY_DNS_PORT", options.dns_port);
+    if (const char* v = std::getenv("SPECTRE_CANARY_DOMAIN")) options.domain = v;
+    if (const char* v = std::getenv("SPECTRE_CANARY_PUBLIC_IP")) options.public_address = v;
+    if (const char* v = std::getenv("SPECTRE_CANARY_MAX_CONNECTIONS")) options.max_connections = std::strtoul(v, nullptr, 10);
+    return options;
+}
+
+std::string CanaryListenerOptions::url_format() const {
+    std::string port = http_port && http_port != 80 ? ":" + std::to_string(http_port) : "";
+    if (!domain.empty()) return "http://{token}." + domain + port + "/";
+    std::string host = public_address.empty() ? address : public_address;
+    if (host.find(':') != std::string::npos) host = "[" + host + "]";
+    return "http://" + host + port + "/{token}";
+}
+
+class CanaryListener::Impl {
+public:
+    bool start(const CanaryListenerOptions& options, SeenHandler on_seen) {
+        if (thread_.joinable()) return false;
+        io_.restart();
+        on_seen_ = std::move(on_seen);
+        max_connections_ = options.max_connections;
+        beast::error_code ec;
+        auto address = net::ip::make_address(options.address, ec);
+        if (ec) {
+            logger.error("bad listen address", {{"address", options.address}, {"error", ec.message()}});
+            return false;
+        }
+        if (options.http_port) {
+            acceptor_.emplace(io_);
+            tcp::endpoint endpoint(address, options.http_port);
+            acceptor_->open(endpoint.protocol(), ec);
+            if (!ec) acceptor_->set_option(net::socket_base::reuse_address(true), ec);
+            if (!ec) acceptor_->bind(endpoint, ec);
+            if (!ec) acceptor_->listen(net::socket_base::max_listen_connections, ec);
+            if (ec) {
+                logger.error("cannot listen for HTTP callbacks",
+                             {{"port", options.http_port}, {"error", ec.message()}});
+                acceptor_.reset();
+            } else {
+                http_port_ = acceptor_->local_endpoint().port();
+                accept();
+            }
+        }
+        if (options.dns_port) {
+            udp::socket socket(io_);
+            udp::endpoint endpoint(address, options.dns_port);
+            socket.open(endpoint.protocol(), ec);
+            if (!ec) socket.bind(endpoint, ec);
+            if (ec) {
+                logger.error("cannot listen for DNS callbacks", {{"port", options.dns_port}, {"error", ec.message()}});
+            } else {
+                dns_port_ = socket.local_endpoint().port();
+                auto answer = net::ip::make_address(
+                    options.public_address.empty() ? options.address : options.public_address, ec);
+                if (ec || answer.is_unspecified()) answer = net::ip::address();
+                dns_.emplace(std::move(socket), options.domain, answer, on_seen_);
+                dns_->run();
+            }
+        }
+        if (!acceptor_ && !dns_) return false;
+        thread_ = std::thread([this] { io_.run(); });
+        logger.info("listening for canary callbacks",
+                    {{"address", options.address}, {"http_port", http_port_}, {"dns_port", dns_port_},
+                     {"domain", options.domain}});
+        return true;
+    }
+
+    void stop() {
+        io_.stop();
+        if (thread_.joinable()) thread_.join();
+        acceptor_.reset();
+        dns_.reset();
+        http_port_ = dns_port_ = 0;
+    }
+
+    unsigned short http_port_ = 0;
+    unsigned short dns_port_ = 0;
+
+private:
+    void accept() {
+        acceptor_->async_accept([this](beast::error_code ec, tcp::socket socket) {
+            if (ec == net::error::operation_aborted) return;
+            if (!ec && max_connections_ && open_ >= max_connections_) {
+                // Full of slow or idle clients; drop the newcomer rather than
+                // let them hold every socket.
+                static Counter& rejected = MetricsRegistry::get_instance().counter(
+                    "spectre_canary_connections_rejected_total",
+                    "HTTP callbacks closed unanswered because the listener was at its connection limit.");
+                rejected.inc();
+                socket.close(ec);
+            } else if (!ec) {
+                std::make_shared<HttpCallback>(std::move(socket), on_seen_, open_)->run();
+            }
+            accept();
+        });
+    }
+
+    // Declared before io_ so it outlives the handlers io_ destroys.
+    std::size_t open_ = 0;
+    std::size_t max_connections_ = 0;
+    net::io_context io_;
+    SeenHandler on_seen_;
+    std::optional<tcp::acceptor> acceptor_;
+    std::optional<DnsResponder> dns_;
+    std::thread thread_;
+};
+
+CanaryListener::CanaryListener() : impl_(std::make_unique<Impl>()) {}
+CanaryListener::~CanaryListener() = default;
+
+CanaryListener& CanaryListener::get_instance() {
+    static CanaryListener instance;
+    return instance;
+}
+
+bool CanaryListener::start(const CanaryListenerOptions& options, SeenHandler on_seen) {
+    return impl_->start(options, std::move(on_seen));
+}
+
+void CanaryListener::stop() {
+    impl_->stop();
+}
+
+unsigned short CanaryListener::http_port() const {
+    return impl_->http_port_;
+}
+
+unsigned short CanaryListener::dns_port() const {
+    return impl_->dns_port_;
+}
+
+} // namespace spectre
@@ -1,68 +1,163 @@
 #include "spectre/canary_monitor.h"
-#include <iostream>
+#include "spectre/canary_listener.h"
+#include "spectre/metrics.h"
+#include "spectre/log.h"
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <vector>
+#include <queue>
 #include <random>
 #include <chrono>
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 #include <cpr/cpr.h>
 
 namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("canary_monitor");
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t kTokenLength = 16;
+
+long env_long(const char* name, long fallback) {
+    const char* value = std::getenv(name);
+    return value ? std::strtol(value, nullptr, 10) : fallback;
+}
+
+// Every run of exactly kTokenLength letters and digits, lowercased: DNS
+// resolvers along the way may change the case of a host name.
+std::vector<std::string> candidate_tokens(const std::string& seen) {
+    std::vector<std::string> tokens;
+    std::size_t i = 0;
+    while (i < seen.size()) {
+        if (!std::isalnum(static_cast<unsigned char>(seen[i]))) {
+            ++i;
+            continue;
+        }
+        std::size_t start = i;
+        while (i < seen.size() && std::isalnum(static_cast<unsigned char>(seen[i]))) ++i;
+        if (i - start == kTokenLength) {
+            std::string token = seen.substr(start, kTokenLength);
+            for (char& c : token) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            tokens.push_back(std::move(token));
+        }
+    }
+    return tokens;
+}
+} // namespace
+
 
 struct CanaryMonitor::pimpl {
+    struct Waiter {
+        Clock::time_point deadline;
+        std::promise<bool> promise;
+    };
+    struct Entry {
+        Clock::time_point expires;
+        bool chirped = false;
+        std::vector<Waiter> waiters;
+    };
+    using Deadline = std::pair<Clock::time_point, std::string>;
+
     std::string webhook_url;
-    std::vector<std::string> active_canaries;
-    std::vector<std::string> chirped_canaries;
+    std::string url_format;
+    std::unordered_map<std::string, Entry> canaries;
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> deadlines;
     std::mutex mtx;
+    std::condition_variable wake;
     bool running = false;
     std::thread worker;
 
-    void poll_webhook() {
+    const std::chrono::seconds ttl{env_long("SPECTRE_CANARY_TTL_S", 600)};
+    const std::chrono::milliseconds poll_interval{env_long("SPECTRE_CANARY_POLL_MS", 5000)};
+
+    // Expires waiters and canaries, and polls the webhook when one is set.
+    void run() {
+        constexpr auto sweep_interval = std::chrono::seconds(30);
+        auto next_poll = Clock::now();
+        auto next_sweep = Clock::now() + sweep_interval;
+        std::unique_lock<std::mutex> lock(mtx);
         while (running) {
-            std::this_thread::sleep_for(std::chrono::seconds(5));
-            if (webhook_url.empty()) {
-                continue;
+            auto now = Clock::now();
+            expire_waiters(now);
+            if (now >= next_sweep) {
+                std::erase_if(canaries, [now](const auto& item) {
+                    return item.second.expires <= now && item.second.waiters.empty();
+                });
+                next_sweep = now + sweep_interval;
             }
-
-            cpr::Response r = cpr::Get(cpr::Url{webhook_url});
-
-            if (r.status_code != 200) {
+            if (!webhook_url.empty() && now >= next_poll) {
+                lock.unlock();
+                poll_webhook();
+                lock.lock();
+                next_poll = Clock::now() + poll_interval;
                 continue;
             }
+            auto until = next_sweep;
+            if (!webhook_url.empty()) until = std::min(until, next_poll);
+            if (!deadlines.empty()) until = std::min(until, deadlines.top().first);
+            wake.wait_until(lock, until);
+        }
+        for (auto& [id, entry] : canaries) {
+            for (auto& waiter : entry.waiters) waiter.promise.set_value(false);
+            entry.waiters.clear();
+        }
+    }
 
-            try {
-                auto json_body = nlohmann::json::parse(r.text);
-                if (!json_body.contains("data")) {
-                    continue;
-                }
+    void expire_waiters(Clock::time_point now) {
+        while (!deadlines.empty() && deadlines.top().first <= now) {
+            auto it = canaries.find(deadlines.top().second);
+            deadlines.pop();
+            if (it == canaries.end()) continue;
+            std::erase_if(it->second.waiters, [now](Waiter& waiter) {
+                if (waiter.deadline > now) return false;
+                waiter.promise.set_value(false);
+                return true;
+            });
+        }
+    }
 
-                std::lock_guard<std::mutex> lock(mtx);
-                for (const auto& item : json_body["data"]) {
-                    if (!item.contains("url")) {
-                        continue;
-                    }
-                    std::string url = item["url"];
-                    for (const auto& canary : active_canaries) {
-                        if (url.find(canary) != std::string::npos) {
-                            bool already_chirped = false;
-                            for (const auto& chirped : chirped_canaries) {
-                                if (chirped == canary) {
-                                    already_chirped = true;
-                                    break;
-                                }
-                            }
-
-                            if (!already_chirped) {
-                                std::cout << "[canary_monitor] HIT DETECTED on: " << url << std::endl;
-                                chirped_canaries.push_back(canary);
-                            }
-                        }
-                    }
+    void record_hit(const std::string& seen) {
+        static Counter& hits = MetricsRegistry::get_instance().counter("spectre_canary_hits_total",
+                                                                       "Distinct canaries seen calling back.");
+        std::lock_guard<std::mutex> lock(mtx);
+        for (const auto& token : candidate_tokens(seen)) {
+            auto it = canaries.find(token);
+            if (it == canaries.end() || it->second.chirped) continue;
+            logger.warn("hit detected", {{"canary", token}, {"seen", seen}});
+            it->second.chirped = true;
+            hits.inc();
+            for (auto& waiter : it->second.waiters) waiter.promise.set_value(true);
+            it->second.waiters.clear();
+        }
+    }
+
+    // Bounded so a stalled webhook cannot hold back expire_waiters() on the
+    // same thread for longer than one poll interval.
+    void poll_webhook() {
+        auto timeout = std::min<std::chrono::milliseconds>(poll_interval, std::chrono::seconds(5));
+        cpr::Response r = cpr::Get(cpr::Url{webhook_url}, cpr::Timeout{timeout},
+                                   cpr::ConnectTimeout{std::min<std::chrono::milliseconds>(timeout, std::chrono::seconds(2))});
+        if (r.status_code != 200) {
+            return;
+        }
+        try {
+            auto json_body = nlohmann::json::parse(r.text);
+            if (!json_body.contains("data")) {
+                return;
+            }
+            for (const auto& item : json_body["data"]) {
+                if (item.contains("url") && item["url"].is_string()) {
+                    record_hit(item["url"].get<std::string>());
                 }
-            } catch (const nlohmann::json::parse_error& e) {
-                
             }
+        } catch (const nlohmann::json::parse_error& e) {
+            
         }
     }
 };
@@ -77,59 +172,151 @@ void CanaryMonitor::start(const std::string& webhook_url) {
         pimpl_ = std::make_unique<pimpl>();
     }
     pimpl_->webhook_url = webhook_url;
+    pimpl_->url_format = webhook_url + "/{token}";
     pimpl_->running = true;
-    pimpl_->worker = std::thread(&pimpl::poll_webhook, pimpl_.get());
-    std::cout << "[canary_monitor] started. Webhook: " << webhook_url << std::endl;
+    pimpl_->worker = std::thread(&pimpl::run, pimpl_.get());
+    logger.info("started", {{"webhook", webhook_url}});
 }
 
 void CanaryMonitor::stop() {
     if (pimpl_ && pimpl_->running) {
-        pimpl_->running = false;
+        {
+            std::lock_guard<std::mutex> lock(pimpl_->mtx);
+            pimpl_->running = false;
+        }
+        pimpl_->wake.notify_all();
         if (pimpl_->worker.joinable()) {
             pimpl_->worker.join();
         }
     }
 }
 
-std::string CanaryMonitor::get_canary_url() {
+bool CanaryMonitor::is_running() {
+    if (!pimpl_) return false;
+    std::lock_guard<std::mutex> lock(pimpl_->mtx);
+    return pimpl_->running;
+}
+
+Canary CanaryMonitor::issue_canary() {
     static const char* chars = "abcdefghijklmnopqrstuvwxyz0123456789";
     thread_local std::mt19937 gen(std::random_device{}());
     std::uniform_int_distribution<> dist(0, 35);
-    std::string token(16, '\0');
+    std::string token(kTokenLength, '\0');
     for (char& c : token) {
         c = chars[dist(gen)];
     }
     
     if (pimpl_) {
         std::lock_guard<std::mutex> lock(pimpl_->mtx);
-        pimpl_->active_canaries.push_back(token);
-        return pimpl_->webhook_url + "/" + token;
+        pimpl_->canaries[token].expires = Clock::now() + pimpl_->ttl;
+        std::string url = pimpl_->url_format;
+        auto at = url.find("{token}");
+        if (at != std::string::npos) url.replace(at, 7, token);
+        return {token, url};
     }
-    return "error-canary-monitor-not-started";
+    return {};
+}
+
+void CanaryMonitor::set_url_format(const std::string& format) {
+    if (!pimpl_) return;
+    std::lock_guard<std::mutex> lock(pimpl_->mtx);
+    pimpl_->url_format = format;
+}
+
+std::string CanaryMonitor::get_canary_url() {
+    Canary canary = issue_canary();
+    return canary.id.empty() ? "error-canary-monitor-not-started" : canary.url;
 }
 
 bool CanaryMonitor::has_canary_chirped(const std::string& canary_id) {
     if (pimpl_) {
         std::lock_guard<std::mutex> lock(pimpl_->mtx);
-        for(const auto& c : pimpl_->chirped_canaries) {
-            if (c == canary_id) return true;
-        }
+        auto it = pimpl_->canaries.find(canary_id);
+        return it != pimpl_->canaries.end() && it->second.chirped;
     }
     return false;
 }
 
-void start_canary_monitor() {
-    char* url = std::getenv("CANARY_WEBHOOK_API_URL");
-    if (!url) {
-        std::cerr << "CANARY_WEBHOOK_API_URL environment variable not set. Canary monitor will not start." << std::endl;
+std::future<bool> CanaryMonitor::wait_for_chirp(const std::string& canary_id, Clock::time_point deadline) {
+    std::promise<bool> promise;
+    auto future = promise.get_future();
+    if (!pimpl_) {
+        promise.set_value(false);
+        return future;
+    }
+    std::lock_guard<std::mutex> lock(pimpl_->mtx);
+    auto it = pimpl_->canaries.find(canary_id);
+    if (it == pimpl_->canaries.end() || it->second.chirped || !pimpl_->running || deadline <= Clock::now()) {
+        promise.set_value(it != pimpl_->canaries.end() && it->second.chirped);
+        return future;
+    }
+    it->second.waiters.push_back({deadline, std::move(promise)});
+    bool earliest = pimpl_->deadlines.empty() || deadline < pimpl_->deadlines.top().first;
+    pimpl_->deadlines.emplace(deadline, canary_id);
+    if (earliest) pimpl_->wake.notify_all();
+    return future;
+}
+
+void CanaryMonitor::record_hit(const std::string& seen) {
+    if (pimpl_) pimpl_->record_hit(seen);
+}
+
+// Kept outside pimpl: isolated plugins register before the monitor starts.
+namespace {
+struct CallbackObservers {
+    std::mutex mtx;
+    std::map<int, std::function<void(const std::string&)>> observers;
+    int next = 0;
+};
+
+CallbackObservers& callback_observers() {
+    static CallbackObservers observers;
+    return observers;
+}
+} // namespace
+
+void CanaryMonitor::report_callback(const std::string& seen) {
+    record_hit(seen);
+    auto& registry = callback_observers();
+    std::lock_guard<std::mutex> lock(registry.mtx);
+    for (auto& [id, observer] : registry.observers) observer(seen);
+}
+
+int CanaryMonitor::add_callback_observer(std::function<void(const std::string&)> observer) {
+    auto& registry = callback_observers();
+    std::lock_guard<std::mutex> lock(registry.mtx);
+    int id = registry.next++;
+    registry.observers.emplace(id, std::move(observer));
+    return id;
+}
+
+void CanaryMonitor::remove_callback_observer(int id) {
+    auto& registry = callback_observers();
+    std::lock_guard<std::mutex> lock(registry.mtx);
+    registry.observers.erase(id);
+}
+
+void start_canary_monitor(bool listen) {
+    const char* url = std::getenv("CANARY_WEBHOOK_API_URL");
+    auto options = CanaryListenerOptions::from_env();
+    if (!url && !options.enabled()) {
+        logger.warn("neither CANARY_WEBHOOK_API_URL nor SPECTRE_CANARY_LISTEN set, canary monitor will not start");
         return;
     }
-    CanaryMonitor::get_instance().start(url);
+    auto& monitor = CanaryMonitor::get_instance();
+    monitor.start(url ? url : "");
+    if (!options.enabled()) return;
+    monitor.set_url_format(options.url_format());
+    if (listen) {
+        CanaryListener::get_instance().start(options, [](const std::string& seen) {
+            CanaryMonitor::get_instance().report_callback(seen);
+        });
+    }
 }
 
 void stop_canary_monitor() {
+    CanaryListener::get_instance().stop();
     CanaryMonitor::get_instance().stop();
 }
 
-} // namespace spectre 
-
+} // namespace spectre
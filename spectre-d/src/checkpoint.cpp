@@ -0,0 +1,200 @@
+#include "spectre/checkpoint.h"
+#include "spectre/log.h"
+#include "spectre/metrics.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+
+namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("checkpoint");
+
+thread_local const Task* tls_task = nullptr;
+thread_local std::chrono::steady_clock::time_point tls_last_save;
+
+// Scan ids come from peers and clients; only plain ones become file names.
+bool safe_id(const std::string& id) {
+    return !id.empty() && id.size() <= 128 && std::all_of(id.begin(), id.end(), [](unsigned char c) {
+        return std::isalnum(c) || c == '-' || c == '_';
+    });
+}
+
+Counter& writes() {
+    static Counter& counter = MetricsRegistry::get_instance().counter(
+        "spectre_checkpoint_writes_total", "Task checkpoints written to disk.");
+    return counter;
+}
+} // namespace
+
+CheckpointStore& CheckpointStore::get_instance() {
+    static CheckpointStore instance;
+    return instance;
+}
+
+CheckpointStore::CheckpointStore() {
+    const char* dir = std::getenv("SPECTRE_CHECKPOINT_DIR");
+    dir_ = dir ? dir : "spectre-checkpoints";
+    if (const char* interval = std::getenv("SPECTRE_CHECKPOINT_INTERVAL_S")) {
+        interval_ = std::chrono::seconds(std::strtol(interval, nullptr, 10));
+    }
+    if (const char* attempts = std::getenv("SPECTRE_CHECKPOINT_MAX_ATTEMPTS")) {
+        max_attempts_ = std::max(1, static_cast<int>(std::strtol(attempts, nullptr, 10)));
+    }
+    if (dir_.empty()) return;
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+    if (ec) {
+        logger.error("cannot create checkpoint directory, checkpoints are off", {{"dir", dir_}, {"error", ec.message()}});
+        dir_.clear();
+    }
+}
+
+std::string CheckpointStore::path_of(const std::string& id) const {
+    return dir_ + "/" + id + ".json";
+}
+
+// Replaces the file through a rename so readers never see half of it.
+bool CheckpointStore::write(const std::string& path, const json& saved) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << saved.dump();
+        if (!out.flush()) {
+            logger.warn("checkpoint write failed", {{"path", tmp}});
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) {
+        logger.warn("checkpoint rename failed", {{"path", path}, {"error", ec.message()}});
+        return false;
+    }
+    return true;
+}
+
+void CheckpointStore::save(const std::string& id, const std::string& task_raw, const json& state) {
+    if (!enabled() || !safe_id(id)) return;
+    std::string path = path_of(id);
+    // A save during shutdown means this run ended cleanly, so it does not
+    // count against the scan; otherwise keep the resume count pending() set.
+    int attempts = 0;
+    if (!interrupted()) {
+        std::ifstream in(path);
+        if (in) {
+            json previous = json::parse(in, nullptr, false);
+            if (previous.is_object()) attempts = previous.value("attempts", 0);
+        }
+    }
+    json saved{{"id", id}, {"task", task_raw}, {"state", state}, {"saved_at", std::time(nullptr)},
+               {"attempts", attempts}};
+    if (write(path, saved)) writes().inc();
+}
+
+std::optional<json> CheckpointStore::load(const std::string& id) {
+    if (!enabled() || !safe_id(id)) return std::nullopt;
+    std::ifstream in(path_of(id));
+    if (!in) return std::nullopt;
+    try {
+        json saved = json::parse(in);
+        auto state = saved.find("state");
+        if (state == saved.end() || state->is_null()) return std::nullopt;
+        return *state;
+    } catch (const json::exception& ex) {
+        logger.warn("ignoring unreadable checkpoint", {{"id", id}, {"error", ex.what()}});
+        return std::nullopt;
+    }
+}
+
+void CheckpointStore::remove(const std::string& id) {
+    if (!enabled() || !safe_id(id)) return;
+    std::error_code ec;
+    std::filesystem::remove(path_of(id), ec);
+}
+
+std::vector<Task> CheckpointStore::pending() {
+    static Counter& abandoned = MetricsRegistry::get_instance().counter(
+        "spectre_checkpoint_abandoned_total", "Checkpointed scans dropped after too many failed resumes.");
+    std::vector<Task> tasks;
+    if (!enabled()) return tasks;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+        const auto& path = entry.path();
+        if (path.extension() != ".json") continue;
+        std::string id = path.stem().string();
+        try {
+            std::ifstream in(path);
+            json saved = json::parse(in);
+            in.close();
+            // Counted before the scan runs, so a task that takes the daemon
+            // down with it is not resumed forever.
+            int attempts = saved.value("attempts", 0) + 1;
+            if (attempts > max_attempts_) {
+                logger.error("giving up on scan that failed to resume", {{"id", id}, {"attempts", attempts - 1}});
+                std::filesystem::remove(path, ec);
+                abandoned.inc();
+                continue;
+            }
+            saved["attempts"] = attempts;
+            Task task = parse_task(saved.at("task").get<std::string>());
+            task.id = id;
+            if (!write(path.string(), saved)) continue;
+            tasks.push_back(std::move(task));
+        } catch (const std::exception& ex) {
+            logger.warn("dropping unreadable checkpoint", {{"path", path.string()}, {"error", ex.what()}});
+            std::filesystem::remove(path, ec);
+        }
+    }
+    return tasks;
+}
+
+void CheckpointStore::interrupt() {
+    if (interrupted_.exchange(true)) return;
+    std::lock_guard<std::mutex> lock(observers_mutex_);
+    for (auto& [id, observer] : observers_) observer();
+}
+
+int CheckpointStore::add_interrupt_observer(std::function<void()> observer) {
+    std::lock_guard<std::mutex> lock(observers_mutex_);
+    int id = next_observer_++;
+    observers_.emplace(id, std::move(observer));
+    return id;
+}
+
+void CheckpointStore::remove_interrupt_observer(int id) {
+    std::lock_guard<std::mutex> lock(observers_mutex_);
+    observers_.erase(id);
+}
+
+CheckpointScope::CheckpointScope(const Task& task) {
+    tls_task = &task;
+    tls_last_save = std::chrono::steady_clock::now();
+}
+
+CheckpointScope::~CheckpointScope() {
+    tls_task = nullptr;
+}
+
+std::optional<json> checkpoint_resume() {
+    if (!tls_task) return std::nullopt;
+    return CheckpointStore::get_instance().load(tls_task->id);
+}
+
+bool checkpoint_due() {
+    auto& store = CheckpointStore::get_instance();
+    if (!tls_task || !store.enabled()) return false;
+    return store.interrupted() || std::chrono::steady_clock::now() - tls_last_save >= store.interval();
+}
+
+void checkpoint(const json& state) {
+    auto& store = CheckpointStore::get_instance();
+    if (!tls_task || !store.enabled()) return;
+    store.save(tls_task->id, tls_task->raw, state);
+    tls_last_save = std::chrono::steady_clock::now();
+    if (store.interrupted()) throw ScanInterrupted();
+}
+
+} // namespace spectre
@@ -0,0 +1,143 @@
+#include "spectre/curl_multiplexer.h"
+#include "spectre/log.h"
+#include "spectre/metrics.h"
+
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("http");
+
+long env_long(const char* name, long fallback) {
+    const char* value = std::getenv(name);
+    return value ? std::strtol(value, nullptr, 10) : fallback;
+}
+
+Counter& transfers(const char* version) {
+    return MetricsRegistry::get_instance().counter("spectre_outbound_transfers_total",
+                                                   "Outbound transfers by negotiated HTTP version.",
+                                                   {{"version", version}});
+}
+
+const char* version_label(long version) {
+    switch (version) {
+    case CURL_HTTP_VERSION_1_0: return "1.0";
+    case CURL_HTTP_VERSION_1_1: return "1.1";
+    case CURL_HTTP_VERSION_2_0: return "2";
+    case CURL_HTTP_VERSION_3: return "3";
+    default: return "none";
+    }
+}
+} // namespace
+
+class CurlMultiplexer::Impl {
+public:
+    Impl() : http2_(env_long("SPECTRE_HTTP2", 1) != 0) {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        multi_ = curl_multi_init();
+        curl_multi_setopt(multi_, CURLMOPT_PIPELINING, http2_ ? CURLPIPE_MULTIPLEX : CURLPIPE_NOTHING);
+        // No host cap by default: PIPEWAIT already keeps h2 requests on one
+        // connection, and a cap would make HTTP/1.1 requests queue inside
+        // curl, where the wait counts against their timeouts.
+        curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, env_long("SPECTRE_HTTP_MAX_HOST_CONNECTIONS", 0));
+        curl_multi_setopt(multi_, CURLMOPT_MAX_CONCURRENT_STREAMS, env_long("SPECTRE_HTTP_MAX_STREAMS", 32));
+        thread_ = std::thread(&Impl::run, this);
+    }
+
+    void submit(CURL* handle, Done done) {
+        // h2 is offered via ALPN on TLS only; cleartext targets stay on 1.1.
+        curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, http2_ ? CURL_HTTP_VERSION_2TLS : CURL_HTTP_VERSION_1_1);
+        curl_easy_setopt(handle, CURLOPT_PIPEWAIT, http2_ ? 1L : 0L);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            incoming_.emplace_back(handle, std::move(done));
+        }
+        curl_multi_wakeup(multi_);
+    }
+
+private:
+    void run() {
+        static Gauge& active_gauge = MetricsRegistry::get_instance().gauge(
+            "spectre_outbound_transfers_active", "Transfers on the shared curl multi handle.");
+        std::unordered_map<CURL*, Done> active;
+        while (true) {
+            std::vector<std::pair<CURL*, Done>> adding;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                adding.swap(incoming_);
+            }
+            for (auto& [handle, done] : adding) {
+                CURLMcode added = curl_multi_add_handle(multi_, handle);
+                if (added != CURLM_OK) {
+                    logger.error("cannot start transfer", {{"error", curl_multi_strerror(added)}});
+                    done(CURLE_FAILED_INIT);
+                    continue;
+                }
+                active.emplace(handle, std::move(done));
+            }
+            active_gauge.set(static_cast<std::int64_t>(active.size()));
+
+            int running = 0;
+            curl_multi_perform(multi_, &running);
+            while (CURLMsg* msg = curl_multi_info_read(multi_, &running)) {
+                if (msg->msg != CURLMSG_DONE) continue;
+                CURL* handle = msg->easy_handle;
+                CURLcode result = msg->data.result;
+                curl_multi_remove_handle(multi_, handle);
+                auto it = active.find(handle);
+                if (it == active.end()) continue;
+                Done done = std::move(it->second);
+                active.erase(it);
+                long version = 0;
+                curl_easy_getinfo(handle, CURLINFO_HTTP_VERSION, &version);
+                transfers(version_label(version)).inc();
+                done(result);
+            }
+            // Returns early on socket activity or curl_multi_wakeup.
+            curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+        }
+    }
+
+    const bool http2_;
+    CURLM* multi_ = nullptr;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::vector<std::pair<CURL*, Done>> incoming_;
+};
+
+CurlMultiplexer::CurlMultiplexer() : impl_(std::make_unique<Impl>()) {}
+CurlMultiplexer::~CurlMultiplexer() = default;
+
+// Leaked: the transfer thread runs for the life of the process.
+CurlMultiplexer& CurlMultiplexer::get_instance() {
+    static CurlMultiplexer* instance = new CurlMultiplexer();
+    return *instance;
+}
+
+void CurlMultiplexer::submit(CURL* handle, Done done) {
+    impl_->submit(handle, std::move(done));
+}
+
+std::vector<CURLcode> CurlMultiplexer::perform(const std::vector<CURL*>& handles) {
+    std::vector<CURLcode> results(handles.size(), CURLE_OK);
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::size_t remaining = handles.size();
+    for (std::size_t i = 0; i < handles.size(); ++i) {
+        submit(handles[i], [&, i](CURLcode result) {
+            std::lock_guard<std::mutex> lock(mutex);
+            results[i] = result;
+            if (--remaining == 0) finished.notify_one();
+        });
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&] { return remaining == 0; });
+    return results;
+}
+
+} // namespace spectre
@@ -0,0 +1,261 @@
+#include "spectre/dispatcher.h"
+#include "spectre/checkpoint.h"
+#include "spectre/scan_registry.h"
+#include "spectre/log.h"
+#include "spectre/resource_usage.h"
+#include "spectre/startup.h"
+#include "spectre/task_memory.h"
+#include "spectre/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("dispatcher");
+
+struct UsageCounters {
+    Counter* cpu = nullptr;
+    Counter* allocated;
+    Counter* requests;
+    Counter* sent;
+    Counter* received;
+};
+
+// Charges one plugin's usage on a task to its plugin/type series. Looking a
+// series up takes the registry lock, so each thread caches the ones it used.
+void charge(const std::string& plugin, const std::string& type, const ResourceUsage& usage) {
+    thread_local std::unordered_map<std::string, UsageCounters> by_key;
+    auto& c = by_key[plugin + '\n' + type];
+    if (!c.cpu) {
+        auto& registry = MetricsRegistry::get_instance();
+        MetricLabels labels{{"plugin", plugin}, {"type", type.empty() ? "unknown" : type}};
+        c.cpu = &registry.counter("spectre_plugin_cpu_microseconds_total",
+                                  "Thread CPU time plugins spent handling tasks.", labels);
+        c.allocated = &registry.counter("spectre_plugin_allocated_bytes_total",
+                                        "Heap bytes plugins allocated while handling tasks.", labels);
+        c.requests = &registry.counter("spectre_plugin_requests_total",
+                                       "Outbound requests plugins made while handling tasks.", labels);
+        c.sent = &registry.counter("spectre_plugin_request_bytes_sent_total",
+                                   "Request body bytes plugins sent.", labels);
+        c.received = &registry.counter("spectre_plugin_request_bytes_received_total",
+                                       "Response body bytes plugins received.", labels);
+    }
+    c.cpu->inc(usage.cpu_ns / 1000);
+    c.allocated->inc(usage.allocated_bytes);
+    c.requests->inc(usage.requests);
+    c.sent->inc(usage.bytes_sent);
+    c.received->inc(usage.bytes_received);
+}
+} // namespace
+
+
+Dispatcher::Dispatcher(std::vector<std::shared_ptr<Plugin>> plugins, std::size_t workers)
+    : worker_count_(workers == 0 ? 1 : workers) {
+    auto set = std::make_shared<PluginSet>();
+    for (auto& p : plugins) {
+        set->push_back(describe(std::move(p)));
+    }
+    plugins_ = std::move(set);
+}
+
+Dispatcher::LoadedPlugin Dispatcher::describe(std::shared_ptr<Plugin> plugin) {
+    std::string name = plugin->name();
+    TaskType type = intern_task_type(name);
+    Histogram* latency = &MetricsRegistry::get_instance().histogram(
+        "spectre_plugin_task_duration_seconds", "Time a plugin spends handling a task addressed to it.",
+        {{"plugin", name}});
+    return {std::move(plugin), std::move(name), type, latency};
+}
+
+std::shared_ptr<const Dispatcher::PluginSet> Dispatcher::plugins() {
+    std::lock_guard<std::mutex> lock(plugins_mutex_);
+    return plugins_;
+}
+
+void Dispatcher::warm_up(const LoadedPlugin& loaded) {
+    auto& startup = Startup::get_instance();
+    std::string component = "warm_up:" + loaded.name;
+    startup.pending(component, false);
+    try {
+        TraceSpan span("warm_up", "plugin", loaded.name);
+        loaded.plugin->warm_up();
+    } catch (const std::exception& ex) {
+        logger.error("plugin warm-up threw", {{"plugin", loaded.name}, {"error", ex.what()}});
+    } catch (...) {
+        logger.error("plugin warm-up threw unknown exception", {{"plugin", loaded.name}});
+    }
+    startup.ready(component);
+}
+
+void Dispatcher::upsert_plugin(std::shared_ptr<Plugin> plugin) {
+    auto loaded = describe(std::move(plugin));
+    // Called from the reload watcher, so warming here delays nothing but
+    // the swap itself; tasks keep running on the old instance meanwhile.
+    warm_up(loaded);
+    std::lock_guard<std::mutex> lock(plugins_mutex_);
+    auto set = std::make_shared<PluginSet>(*plugins_);
+    auto it = std::find_if(set->begin(), set->end(), [&](const LoadedPlugin& p) { return p.name == loaded.name; });
+    logger.info(it == set->end() ? "plugin added" : "plugin replaced", {{"plugin", loaded.name}});
+    if (it == set->end()) {
+        set->push_back(std::move(loaded));
+    } else {
+        *it = std::move(loaded);
+    }
+    plugins_ = std::move(set);
+}
+
+void Dispatcher::remove_plugin(const std::string& name) {
+    std::lock_guard<std::mutex> lock(plugins_mutex_);
+    auto set = std::make_shared<PluginSet>(*plugins_);
+    auto it = std::find_if(set->begin(), set->end(), [&](const LoadedPlugin& p) { return p.name == name; });
+    if (it == set->end()) return;
+    set->erase(it);
+    plugins_ = std::move(set);
+    logger.info("plugin removed", {{"plugin", name}});
+}
+
+std::vector<std::string> Dispatcher::plugin_names() {
+    std::vector<std::string> names;
+    for (const auto& p : *plugins()) names.push_back(p.name);
+    return names;
+}
+
+Dispatcher::~Dispatcher() {
+    stop();
+}
+
+void Dispatcher::start() {
+    for (std::size_t i = 0; i < worker_count_; ++i) {
+        threads_.emplace_back(&Dispatcher::worker_loop, this);
+    }
+    // Workers take tasks straight away; plugins finish heavy setup in the
+    // background and do it inline only if a task needs it first.
+    for (const auto& loaded : *plugins()) {
+        warmers_.emplace_back([loaded] { warm_up(loaded); });
+    }
+    logger.info("started", {{"workers", worker_count_}});
+}
+
+void Dispatcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+    threads_.clear();
+    // Tasks that never started come back on the next start as well.
+    auto& checkpoints = CheckpointStore::get_instance();
+    if (checkpoints.interrupted()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& queued : queue_) checkpoints.save(queued.task.id, queued.task.raw, nullptr);
+        queue_.clear();
+    }
+    for (auto& t : warmers_) {
+        if (t.joinable()) t.join();
+    }
+    warmers_.clear();
+}
+
+void Dispatcher::submit(Task task, TaskDone on_done) {
+    Startup::get_instance().task_accepted();
+    if (task.id.empty()) {
+        task.id = ScanRegistry::get_instance().create(task.type_name(), task.target);
+    } else {
+        ScanRegistry::get_instance().ensure(task.id, task.type_name(), task.target);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back({std::move(task), tracing_enabled() ? trace_now() : 0, std::move(on_done)});
+    }
+    cv_.notify_one();
+}
+
+std::size_t Dispatcher::queued() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return queue_.size();
+}
+
+void Dispatcher::worker_loop() {
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+        if (stop_) {
+            return;
+        }
+        Queued next = std::move(queue_.front());
+        queue_.pop_front();
+        running_.fetch_add(1, std::memory_order_relaxed);
+        lock.unlock();
+
+        if (next.enqueued_ns) {
+            trace_complete("queued", "dispatcher", next.enqueued_ns, trace_now(), next.task.id);
+        }
+        bool ok = run(next.task);
+        if (next.on_done) next.on_done(next.task, ok);
+        running_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+bool Dispatcher::run(const Task& task) {
+    auto& registry = ScanRegistry::get_instance();
+    const std::string& id = task.id;
+    bool ok = true;
+    bool interrupted = false;
+    std::string error;
+    {
+        ScanScope scope(id, registry.mark_running(id));
+        CheckpointScope checkpoint_scope(task);
+        LogScope log_scope(id, task.url.host);
+        TraceSpan task_span("task", "dispatcher", id);
+        TaskArenaScope arena;
+        // Holding the snapshot keeps every plugin in it loaded until this
+        // task is done, even if it is replaced meanwhile.
+        auto snapshot = plugins();
+        for (const auto& loaded : *snapshot) {
+            const auto& p = loaded.plugin;
+            const std::string& plugin_name = loaded.name;
+            auto started = std::chrono::steady_clock::now();
+            TraceSpan plugin_span(plugin_name, "plugin", id);
+            UsageMeter meter;
+            try {
+                p->handle_task(task);
+            } catch (const ScanInterrupted&) {
+                logger.info("plugin stopped for shutdown, scan will resume", {{"plugin", plugin_name}});
+                interrupted = true;
+            } catch (const std::exception& ex) {
+                logger.error("plugin threw", {{"plugin", plugin_name}, {"error", ex.what()}});
+                ok = false;
+                error = plugin_name + ": " + ex.what();
+            } catch (...) {
+                logger.error("plugin threw unknown exception", {{"plugin", plugin_name}});
+                ok = false;
+                error = plugin_name + ": unknown exception";
+            }
+            auto usage = meter.elapsed();
+            // Every plugin sees every task; only the one it is addressed to
+            // is worth a per-type series.
+            if (loaded.type == task.type) {
+                auto elapsed = std::chrono::steady_clock::now() - started;
+                loaded.task_latency->observe(
+                    std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+                charge(plugin_name, task.type_name(), usage);
+            }
+            // Plugins that only glanced at a task of another type stay out of
+            // the scan's summary.
+            if (loaded.type == task.type || usage.requests > 0) registry.add_usage(id, plugin_name, usage);
+        }
+    }
+    if (interrupted) {
+        registry.mark_finished(id, false, ScanInterrupted::kMessage);
+        return false;
+    }
+    CheckpointStore::get_instance().remove(id);
+    registry.mark_finished(id, ok, error);
+    return ok;
+}
+
+} // namespace spectre
@@ -0,0 +1,300 @@
+#include "spectre/dns_resolver.h"
+#include "spectre/log.h"
+#include "spectre/metrics.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <arpa/inet.h>
+#include <ares.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("dns");
+
+using Clock = std::chrono::steady_clock;
+
+std::chrono::seconds env_seconds(const char* name, long fallback) {
+    const char* value = std::getenv(name);
+    return std::chrono::seconds(value ? std::strtol(value, nullptr, 10) : fallback);
+}
+
+Counter& lookups(const char* result) {
+    return MetricsRegistry::get_instance().counter("spectre_dns_lookups_total",
+                                                   "Name lookups by how they were answered.",
+                                                   {{"result", result}});
+}
+
+bool is_address_literal(const std::string& host) {
+    unsigned char buf[sizeof(in6_addr)];
+    return inet_pton(AF_INET, host.c_str(), buf) == 1 || inet_pton(AF_INET6, host.c_str(), buf) == 1;
+}
+
+constexpr std::size_t kMaxCacheEntries = 16384;
+} // namespace
+
+bool DnsResolver::Result::not_found() const {
+    return status == ARES_ENOTFOUND || status == ARES_ENODATA;
+}
+
+std::string DnsResolver::Result::error() const {
+    if (status == ARES_SUCCESS) return addresses.empty() ? "no addresses" : "";
+    return ares_strerror(status);
+}
+
+class DnsResolver::Impl {
+public:
+    Impl() {
+        ares_library_init(ARES_LIB_INIT_ALL);
+        ares_options options{};
+        options.timeout = 1500;
+        options.tries = 2;
+        int status = ares_init_options(&channel_, &options, ARES_OPT_TIMEOUTMS | ARES_OPT_TRIES);
+        if (status != ARES_SUCCESS) {
+            logger.error("resolver init failed", {{"error", ares_strerror(status)}});
+            channel_ = nullptr;
+            return;
+        }
+        if (const char* servers = std::getenv("SPECTRE_DNS_SERVERS")) set_servers(servers);
+        wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        thread_ = std::thread(&Impl::run, this);
+    }
+
+    void resolve_async(const std::string& host, Callback callback) {
+        if (is_address_literal(host)) {
+            Result literal;
+            literal.addresses.push_back(host);
+            callback(literal);
+            return;
+        }
+        Result cached;
+        bool hit = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = cache_.find(host);
+            if (it != cache_.end() && it->second.expires > Clock::now()) {
+                cached = it->second.result;
+                hit = true;
+            } else {
+                auto [waiting, first] = inflight_.try_emplace(host);
+                waiting->second.push_back(std::move(callback));
+                if (!first) {
+                    lookups("coalesced").inc();
+                    return;
+                }
+                pending_.push_back(host);
+            }
+        }
+        if (hit) {
+            lookups(cached.ok() ? "hit" : "negative_hit").inc();
+            callback(cached);
+            return;
+        }
+        lookups("miss").inc();
+        if (!channel_) {
+            Result failed;
+            failed.status = ARES_ENOTINITIALIZED;
+            complete(host, failed);
+            return;
+        }
+        wake();
+    }
+
+    bool set_servers(const std::string& servers) {
+        if (!channel_) return false;
+        std::lock_guard<std::mutex> lock(channel_mutex_);
+        int status = ares_set_servers_ports_csv(channel_, servers.c_str());
+        if (status != ARES_SUCCESS) {
+            logger.warn("bad resolver list", {{"servers", servers}, {"error", ares_strerror(status)}});
+            return false;
+        }
+        logger.info("using resolvers", {{"servers", servers}});
+        return true;
+    }
+
+    void clear_cache() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cache_.clear();
+    }
+
+private:
+    struct Entry {
+        Result result;
+        Clock::time_point expires;
+    };
+    struct Query {
+        Impl* self;
+        std::string host;
+        Clock::time_point started;
+    };
+
+    void wake() {
+        std::uint64_t one = 1;
+        [[maybe_unused]] auto n = ::write(wake_fd_, &one, sizeof(one));
+    }
+
+    void run() {
+        while (true) {
+            std::deque<std::string> starting;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                starting.swap(pending_);
+            }
+            std::vector<pollfd> fds;
+            int timeout_ms = -1;
+            {
+                std::lock_guard<std::mutex> lock(channel_mutex_);
+                ares_addrinfo_hints hints{};
+                hints.ai_family = AF_UNSPEC;
+                for (auto& host : starting) {
+                    auto* query = new Query{this, std::move(host), Clock::now()};
+                    ares_getaddrinfo(channel_, query->host.c_str(), nullptr, &hints, &Impl::on_answer, query);
+                }
+                ares_socket_t socks[ARES_GETSOCK_MAXNUM];
+                int mask = ares_getsock(channel_, socks, ARES_GETSOCK_MAXNUM);
+                for (int i = 0; i < ARES_GETSOCK_MAXNUM; ++i) {
+                    short events = 0;
+                    if (ARES_GETSOCK_READABLE(mask, i)) events |= POLLIN;
+                    if (ARES_GETSOCK_WRITABLE(mask, i)) events |= POLLOUT;
+                    if (events) fds.push_back({socks[i], events, 0});
+                }
+                timeval tv{};
+                if (ares_timeout(channel_, nullptr, &tv)) {
+                    timeout_ms = static_cast<int>(tv.tv_sec * 1000 + (tv.tv_usec + 999) / 1000);
+                }
+            }
+            fds.push_back({wake_fd_, POLLIN, 0});
+
+            int ready = ::poll(fds.data(), fds.size(), timeout_ms);
+            if (fds.back().revents & POLLIN) {
+                std::uint64_t count;
+                [[maybe_unused]] auto n = ::read(wake_fd_, &count, sizeof(count));
+            }
+            std::lock_guard<std::mutex> lock(channel_mutex_);
+            if (ready <= 0) {
+                // Lets c-ares retry or fail queries whose timeout passed.
+                ares_process_fd(channel_, ARES_SOCKET_BAD, ARES_SOCKET_BAD);
+                continue;
+            }
+            for (std::size_t i = 0; i + 1 < fds.size(); ++i) {
+                if (!fds[i].revents) continue;
+                ares_socket_t r = (fds[i].revents & (POLLIN | POLLERR | POLLHUP)) ? fds[i].fd : ARES_SOCKET_BAD;
+                ares_socket_t w = (fds[i].revents & POLLOUT) ? fds[i].fd : ARES_SOCKET_BAD;
+                ares_process_fd(channel_, r, w);
+            }
+            ares_process_fd(channel_, ARES_SOCKET_BAD, ARES_SOCKET_BAD);
+        }
+    }
+
+    static void on_answer(void* arg, int status, int, ares_addrinfo* info) {
+        std::unique_ptr<Query> query(static_cast<Query*>(arg));
+        static Histogram& duration = MetricsRegistry::get_instance().histogram(
+            "spectre_dns_query_duration_seconds", "Wall time of DNS queries that went to the network.");
+        duration.observe(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - query->started).count()));
+
+        Result result;
+        result.status = status;
+        if (status == ARES_SUCCESS && info) {
+            int ttl = -1;
+            for (auto* node = info->nodes; node; node = node->ai_next) {
+                char text[INET6_ADDRSTRLEN] = {};
+                const void* addr = node->ai_family == AF_INET6
+                                       ? static_cast<const void*>(&reinterpret_cast<sockaddr_in6*>(node->ai_addr)->sin6_addr)
+                                       : static_cast<const void*>(&reinterpret_cast<sockaddr_in*>(node->ai_addr)->sin_addr);
+                if (!inet_ntop(node->ai_family, addr, text, sizeof(text))) continue;
+                if (std::find(result.addresses.begin(), result.addresses.end(), text) == result.addresses.end()) {
+                    result.addresses.emplace_back(text);
+                }
+                ttl = ttl < 0 ? node->ai_ttl : std::min(ttl, node->ai_ttl);
+            }
+            result.ttl = std::chrono::seconds(std::max(ttl, 0));
+        }
+        if (info) ares_freeaddrinfo(info);
+        // ARES_EDESTRUCTION: the channel is going away with the process.
+        if (status == ARES_EDESTRUCTION) return;
+        query->self->complete(query->host, result);
+    }
+
+    void complete(const std::string& host, Result result) {
+        static const auto max_ttl = env_seconds("SPECTRE_DNS_MAX_TTL_S", 3600);
+        static const auto negative_ttl = env_seconds("SPECTRE_DNS_NEGATIVE_TTL_S", 30);
+        std::vector<Callback> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Timeouts and server failures are not cached; the next lookup retries.
+            auto ttl = result.ok() ? std::min(result.ttl, max_ttl)
+                                   : result.not_found() ? negative_ttl : std::chrono::seconds(0);
+            if (ttl.count() > 0) {
+                if (cache_.size() >= kMaxCacheEntries) evict_expired();
+                cache_[host] = Entry{result, Clock::now() + ttl};
+            }
+            auto it = inflight_.find(host);
+            if (it != inflight_.end()) {
+                callbacks = std::move(it->second);
+                inflight_.erase(it);
+            }
+        }
+        if (!result.ok()) logger.debug("lookup failed", {{"host", host}, {"error", result.error()}});
+        for (auto& callback : callbacks) callback(result);
+    }
+
+    void evict_expired() {
+        auto now = Clock::now();
+        std::erase_if(cache_, [now](const auto& entry) { return entry.second.expires <= now; });
+        if (cache_.size() >= kMaxCacheEntries) cache_.clear();
+    }
+
+    ares_channel channel_ = nullptr;
+    // c-ares channels are not thread-safe before 1.23.
+    std::mutex channel_mutex_;
+    int wake_fd_ = -1;
+    std::thread thread_;
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, Entry> cache_;
+    std::unordered_map<std::string, std::vector<Callback>> inflight_;
+    std::deque<std::string> pending_;
+};
+
+DnsResolver::DnsResolver() : impl_(std::make_unique<Impl>()) {}
+DnsResolver::~DnsResolver() = default;
+
+// Leaked: the event thread runs for the life of the process.
+DnsResolver& DnsResolver::get_instance() {
+    static DnsResolver* instance = new DnsResolver();
+    return *instance;
+}
+
+void DnsResolver::resolve_async(const std::string& host, Callback callback) {
+    impl_->resolve_async(host, std::move(callback));
+}
+
+DnsResolver::Result DnsResolver::resolve(const std::string& host, std::chrono::milliseconds timeout) {
+    auto promise = std::make_shared<std::promise<Result>>();
+    auto future = promise->get_future();
+    impl_->resolve_async(host, [promise](const Result& result) { promise->set_value(result); });
+    if (future.wait_for(timeout) != std::future_status::ready) {
+        Result timed_out;
+        timed_out.status = ARES_ETIMEOUT;
+        return timed_out;
+    }
+    return future.get();
+}
+
+bool DnsResolver::set_servers(const std::string& servers) {
+    return impl_->set_servers(servers);
+}
+
+void DnsResolver::clear_cache() {
+    impl_->clear_cache();
+}
+
+} // namespace spectre
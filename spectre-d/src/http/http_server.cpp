@@ -1,22 +1,60 @@
 #include "spectre/http/http_server.h"
+#include "spectre/metrics.h"
+#include "spectre/log.h"
+#include "spectre/trace.h"
+#include "spectre/proof_store.h"
+#include "spectre/scan_registry.h"
+#include "spectre/startup.h"
+#include "spectre/url_utils.h"
 #include <boost/beast/http.hpp>
 #include <boost/beast/core.hpp>
 #include <nlohmann/json.hpp>
+#include <map>
+#include <sstream>
+#include <stdexcept>
 
 namespace beast = boost::beast;
 namespace http = beast::http;
 namespace net = boost::asio;
 using tcp = net::ip::tcp;
 
+namespace {
+struct RequestTarget {
+    std::string path;
+    std::map<std::string, std::string> params;
+};
+
+RequestTarget split_target(std::string_view target) {
+    RequestTarget out;
+    auto qpos = target.find('?');
+    out.path = std::string(target.substr(0, qpos));
+    if (qpos == std::string_view::npos) {
+        return out;
+    }
+    out.params = spectre::parse_query(target.substr(qpos + 1));
+    return out;
+}
+
+std::int64_t param_int(const std::map<std::string, std::string>& params, const std::string& key, std::int64_t fallback) {
+    auto it = params.find(key);
+    if (it == params.end() || it->second.empty()) return fallback;
+    return std::stoll(it->second);
+}
+} // namespace
+
 class session : public std::enable_shared_from_this<session> {
     tcp::socket socket_;
     beast::flat_buffer buffer_;
     http::request<http::string_body> req_;
     spectre::NetworkManager& network_manager_;
+    spectre::Dispatcher& dispatcher_;
+    spectre::WorkflowScheduler& workflows_;
 
 public:
-    session(tcp::socket socket, spectre::NetworkManager& network_manager)
-        : socket_(std::move(socket)), network_manager_(network_manager) {}
+    session(tcp::socket socket, spectre::NetworkManager& network_manager, spectre::Dispatcher& dispatcher,
+            spectre::WorkflowScheduler& workflows)
+        : socket_(std::move(socket)), network_manager_(network_manager), dispatcher_(dispatcher),
+          workflows_(workflows) {}
 
     void run() {
         do_read();
@@ -44,24 +82,25 @@ private:
     }
 
     void handle_request() {
-        if (req_.method() == http::verb::post && req_.target() == "/scan") {
+        auto target = split_target(std::string_view(req_.target().data(), req_.target().size()));
+        if (req_.method() == http::verb::post && target.path == "/scan") {
             try {
-                auto body = nlohmann::json::parse(req_.body());
-                if (body.contains("target")) {
-                    nlohmann::json task_data;
-                    task_data["type"] = "scan";
-                    task_data["target"] = body["target"];
-                    spectre::Task task{task_data};
-                    network_manager_.publish_task(task);
-
-                    http::response<http::string_body> res{http::status::ok, req_.version()};
-                    res.set(http::field::server, "Spectre-HTTP");
-                    res.set(http::field::content_type, "application/json");
-                    res.keep_alive(req_.keep_alive());
-                    res.body() = "{\"status\":\"scan initiated\"}";
-                    res.prepare_payload();
-                    send_response(std::move(res));
+                auto body = spectre::parse_task(req_.body());
+                if (body.target.empty()) {
+                    return send_text(http::status::bad_request, "application/json", "{\"error\":\"missing target\"}");
                 }
+                std::string type = body.type == spectre::kNoTaskType ? "scan" : body.type_name();
+                std::string id = spectre::ScanRegistry::get_instance().create(type, body.target);
+                network_manager_.publish_task(
+                    spectre::make_task(type, std::move(body.target), id, std::move(body.options)));
+
+                http::response<http::string_body> res{http::status::ok, req_.version()};
+                res.set(http::field::server, "Spectre-HTTP");
+                res.set(http::field::content_type, "application/json");
+                res.keep_alive(req_.keep_alive());
+                res.body() = nlohmann::json{{"status", "scan initiated"}, {"id", id}}.dump();
+                res.prepare_payload();
+                send_response(std::move(res));
             } catch (const std::exception& e) {
                 http::response<http::string_body> res{http::status::bad_request, req_.version()};
                 res.set(http::field::server, "Spectre-HTTP");
@@ -71,6 +110,52 @@ private:
                 res.prepare_payload();
                 send_response(std::move(res));
             }
+        } else if (req_.method() == http::verb::get && target.path.rfind("/scan/", 0) == 0) {
+            auto status = spectre::ScanRegistry::get_instance().status(target.path.substr(6));
+            if (!status) {
+                return send_text(http::status::not_found, "application/json", "{\"error\":\"unknown scan\"}");
+            }
+            send_text(http::status::ok, "application/json", status->dump());
+        } else if (req_.method() == http::verb::post && target.path == "/workflow") {
+            handle_workflow();
+        } else if (req_.method() == http::verb::get && target.path.rfind("/workflow/", 0) == 0) {
+            auto status = workflows_.status(target.path.substr(10));
+            if (!status) {
+                return send_text(http::status::not_found, "application/json", "{\"error\":\"unknown workflow\"}");
+            }
+            send_text(http::status::ok, "application/json", status->dump());
+        } else if (req_.method() == http::verb::get && target.path == "/scans") {
+            auto summary = spectre::ScanRegistry::get_instance().summary();
+            summary["workers"] = dispatcher_.workers();
+            summary["workers_busy"] = dispatcher_.running();
+            summary["dispatch_queue"] = dispatcher_.queued();
+            summary["plugins"] = dispatcher_.plugin_names();
+            send_text(http::status::ok, "application/json", summary.dump());
+        } else if (req_.method() == http::verb::get && target.path == "/ready") {
+            auto& startup = spectre::Startup::get_instance();
+            bool ready = startup.is_ready();
+            send_text(ready ? http::status::ok : http::status::service_unavailable, "application/json",
+                      startup.status().dump());
+        } else if (req_.method() == http::verb::get && target.path == "/proofs") {
+            handle_proofs(target.params);
+        } else if (req_.method() == http::verb::get && target.path == "/log") {
+            send_text(http::status::ok, "application/json", spectre::Logger::get_instance().levels().dump());
+        } else if (req_.method() == http::verb::put && target.path == "/log") {
+            handle_log_level(target.params);
+        } else if (req_.method() == http::verb::get && target.path == "/trace") {
+            std::ostringstream trace;
+            spectre::Tracer::get_instance().write_chrome_trace(trace);
+            send_text(http::status::ok, "application/json", trace.str());
+        } else if (req_.method() == http::verb::put && target.path == "/trace") {
+            handle_trace_toggle(target.params);
+        } else if (req_.method() == http::verb::get && target.path == "/metrics") {
+            http::response<http::string_body> res{http::status::ok, req_.version()};
+            res.set(http::field::server, "Spectre-HTTP");
+            res.set(http::field::content_type, "text/plain; version=0.0.4");
+            res.keep_alive(req_.keep_alive());
+            res.body() = spectre::MetricsRegistry::get_instance().render_prometheus();
+            res.prepare_payload();
+            send_response(std::move(res));
         } else {
             http::response<http::string_body> res{http::status::not_found, req_.version()};
             res.set(http::field::server, "Spectre-HTTP");
@@ -82,10 +167,150 @@ private:
         }
     }
 
+    // POST /workflow runs a DAG of stages on this daemon; see WorkflowScheduler.
+    void handle_workflow() {
+        nlohmann::json spec;
+        try {
+            spec = nlohmann::json::parse(req_.body());
+        } catch (const nlohmann::json::exception&) {
+            return send_text(http::status::bad_request, "application/json", "{\"error\":\"invalid json\"}");
+        }
+        try {
+            std::string id = workflows_.submit(spec);
+            send_text(http::status::ok, "application/json",
+                      nlohmann::json{{"status", "workflow started"}, {"id", id}}.dump());
+        } catch (const std::invalid_argument& ex) {
+            send_text(http::status::bad_request, "application/json", nlohmann::json{{"error", ex.what()}}.dump());
+        }
+    }
+
+    // PUT /log?level=debug sets the default; adding source=xss_hunter overrides one source.
+    void handle_log_level(const std::map<std::string, std::string>& params) {
+        auto& logger = spectre::Logger::get_instance();
+        auto level_it = params.find("level");
+        spectre::LogLevel level;
+        if (level_it == params.end() || !spectre::parse_log_level(level_it->second, level)) {
+            return send_text(http::status::bad_request, "application/json", "{\"error\":\"invalid level\"}");
+        }
+        auto source_it = params.find("source");
+        if (source_it != params.end()) {
+            logger.set_level(source_it->second, level);
+        } else {
+            logger.set_level(level);
+        }
+        send_text(http::status::ok, "application/json", logger.levels().dump());
+    }
+
+    // PUT /trace?enabled=1 clears the buffers and starts recording; enabled=0 stops.
+    void handle_trace_toggle(const std::map<std::string, std::string>& params) {
+        auto it = params.find("enabled");
+        if (it == params.end()) {
+            return send_text(http::status::bad_request, "application/json", "{\"error\":\"missing enabled\"}");
+        }
+        bool on = it->second == "1" || it->second == "true";
+        auto& tracer = spectre::Tracer::get_instance();
+        if (on && !tracer.enabled()) tracer.clear();
+        tracer.set_enabled(on);
+        send_text(http::status::ok, "application/json", nlohmann::json{{"enabled", on}}.dump());
+    }
+
+    void send_text(http::status status, const std::string& content_type, std::string body) {
+        http::response<http::string_body> res{status, req_.version()};
+        res.set(http::field::server, "Spectre-HTTP");
+        res.set(http::field::content_type, content_type);
+        res.keep_alive(req_.keep_alive());
+        res.body() = std::move(body);
+        res.prepare_payload();
+        send_response(std::move(res));
+    }
+
+    // GET /proofs streams matching records from the local proof store as a
+    // chunked JSON document, one page of records per chunk, so the response
+    // never has to be materialised in memory.
+    struct ProofStream {
+        spectre::ProofQuery query;
+        std::size_t remaining = 0;
+        bool started = false;
+        std::string chunk;
+        http::response<http::empty_body> header;
+        std::unique_ptr<http::response_serializer<http::empty_body>> serializer;
+    };
+
+    static constexpr std::size_t kProofPageSize = 256;
+    static constexpr std::int64_t kMaxProofLimit = 100000;
+
+    void handle_proofs(const std::map<std::string, std::string>& params) {
+        auto stream = std::make_shared<ProofStream>();
+        try {
+            auto get = [&](const char* key) {
+                auto it = params.find(key);
+                return it == params.end() ? std::string() : it->second;
+            };
+            stream->query.target = get("target");
+            stream->query.vuln_type = get("vuln_type");
+            stream->query.scan_id = get("scan_id");
+            stream->query.since = param_int(params, "since", stream->query.since);
+            stream->query.until = param_int(params, "until", stream->query.until);
+            stream->query.cursor = static_cast<std::uint64_t>(param_int(params, "cursor", 0));
+            std::int64_t limit = param_int(params, "limit", 1000);
+            if (limit <= 0 || limit > kMaxProofLimit) {
+                return send_text(http::status::bad_request, "application/json", "{\"error\":\"limit out of range\"}");
+            }
+            stream->remaining = static_cast<std::size_t>(limit);
+        } catch (const std::exception&) {
+            return send_text(http::status::bad_request, "application/json", "{\"error\":\"invalid query\"}");
+        }
+
+        stream->header = http::response<http::empty_body>{http::status::ok, req_.version()};
+        stream->header.set(http::field::server, "Spectre-HTTP");
+        stream->header.set(http::field::content_type, "application/json");
+        stream->header.keep_alive(false);
+        stream->header.chunked(true);
+        stream->serializer = std::make_unique<http::response_serializer<http::empty_body>>(stream->header);
+
+        auto self = shared_from_this();
+        http::async_write_header(socket_, *stream->serializer,
+            [self, stream](beast::error_code ec, std::size_t) {
+                if (ec) return self->do_close();
+                self->write_proof_page(stream);
+            });
+    }
+
+    void write_proof_page(std::shared_ptr<ProofStream> stream) {
+        stream->chunk.clear();
+        if (!stream->started) {
+            stream->chunk = "{\"proofs\":[";
+        }
+        auto page = spectre::ProofStore::get_instance().read_page(
+            stream->query, std::min(stream->remaining, kProofPageSize), stream->chunk, stream->started);
+        stream->started = stream->started || page.count > 0;
+        stream->remaining -= page.count;
+        if (page.last_seq > stream->query.cursor) {
+            stream->query.cursor = page.last_seq;
+        }
+
+        bool last = page.exhausted || stream->remaining == 0;
+        if (last) {
+            stream->chunk += "],\"next_cursor\":";
+            stream->chunk += page.exhausted ? "null" : std::to_string(stream->query.cursor);
+            stream->chunk += "}";
+        }
+
+        auto self = shared_from_this();
+        net::async_write(socket_, http::make_chunk(net::buffer(stream->chunk)),
+            [self, stream, last](beast::error_code ec, std::size_t) {
+                if (ec) return self->do_close();
+                if (!last) return self->write_proof_page(stream);
+                net::async_write(self->socket_, http::make_chunk_last(),
+                    [self, stream](beast::error_code, std::size_t) { self->do_close(); });
+            });
+    }
+
     void send_response(http::response<http::string_body>&& res) {
         auto self = shared_from_this();
-        http::async_write(socket_, std::move(res),
-            [self](beast::error_code ec, std::size_t bytes_transferred) {
+        auto msg = std::make_shared<http::response<http::string_body>>(std::move(res));
+        http::async_write(socket_, *msg,
+            [self, msg](beast::error_code ec, std::size_t bytes_transferred) {
                 boost::ignore_unused(ec, bytes_transferred);
                 self->do_close();
             });
@@ -99,8 +324,10 @@ private:
 
 namespace spectre {
 
-http_server::http_server(boost::asio::io_context& io_context, unsigned short port, NetworkManager& network_manager)
-    : acceptor_(io_context, {tcp::v4(), port}), network_manager_(network_manager) {
+http_server::http_server(boost::asio::io_context& io_context, unsigned short port, NetworkManager& network_manager,
+                         Dispatcher& dispatcher, WorkflowScheduler& workflows)
+    : acceptor_(io_context, {tcp::v4(), port}), network_manager_(network_manager), dispatcher_(dispatcher),
+      workflows_(workflows) {
     do_accept();
 }
 
@@ -108,7 +335,7 @@ void http_server::do_accept() {
     acceptor_.async_accept(
         [this](boost::system::error_code ec, tcp::socket socket) {
             if (!ec) {
-                std::make_shared<session>(std::move(socket), network_manager_)->run();
+                std::make_shared<session>(std::move(socket), network_manager_, dispatcher_, workflows_)->run();
             }
             do_accept();
         });
@@ -0,0 +1,278 @@
+#include "spectre/http_client.h"
+#include "spectre/curl_multiplexer.h"
+#include "spectre/dns_resolver.h"
+#include "spectre/metrics.h"
+#include "spectre/resource_usage.h"
+#include "spectre/scan_registry.h"
+#include "spectre/tor_proxy.h"
+#include "spectre/trace.h"
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace spectre {
+namespace {
+// Resolution set_url pinned on a session. Owns the list CURLOPT_CONNECT_TO
+// points at, so it must outlive every transfer that may read it. Unlike
+// CURLOPT_RESOLVE, which fills the DNS cache every handle on the
+// multiplexer shares, CONNECT_TO applies to this handle alone and leaves
+// nothing behind to clean up.
+struct Pin {
+    curl_slist* connect_to = nullptr;
+    bool unresolvable = false;
+    std::string url;
+    std::string error;
+
+    Pin() = default;
+    Pin(const Pin&) = delete;
+    Pin& operator=(const Pin&) = delete;
+    ~Pin() {
+        if (connect_to) curl_slist_free_all(connect_to);
+    }
+};
+
+// Pins by handle, each valid only while the session that set it is alive:
+// a new session whose handle reuses the address sees an expired owner.
+struct PinSlot {
+    std::weak_ptr<cpr::CurlHolder> owner;
+    std::unique_ptr<Pin> pin;
+};
+
+std::mutex pins_mutex;
+std::unordered_map<CURL*, PinSlot> pins;
+std::size_t pins_sweep_at = 64;
+
+std::unique_ptr<Pin> take_pin(cpr::Session& session) {
+    auto holder = session.GetCurlHolder();
+    std::lock_guard<std::mutex> lock(pins_mutex);
+    auto it = pins.find(holder->handle);
+    if (it == pins.end()) return nullptr;
+    std::unique_ptr<Pin> pin;
+    if (it->second.owner.lock() == holder) pin = std::move(it->second.pin);
+    pins.erase(it);
+    return pin;
+}
+
+void put_pin(cpr::Session& session, std::unique_ptr<Pin> pin) {
+    auto holder = session.GetCurlHolder();
+    std::lock_guard<std::mutex> lock(pins_mutex);
+    pins[holder->handle] = PinSlot{holder, std::move(pin)};
+    if (pins.size() >= pins_sweep_at) {
+        // Sessions set up but destroyed without sending anything.
+        std::erase_if(pins, [](const auto& entry) { return entry.second.owner.expired(); });
+        pins_sweep_at = std::max<std::size_t>(64, pins.size() * 2);
+    }
+}
+
+// Host (without IPv6 brackets) and port curl will connect to for an http(s)
+// URL; empty host for other schemes.
+std::pair<std::string, std::string> endpoint_of(const std::string& url) {
+    std::string scheme = "http";
+    std::size_t sep = url.find("://");
+    if (sep != std::string::npos) {
+        scheme = url.substr(0, sep);
+        for (auto& c : scheme) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    if (scheme != "http" && scheme != "https") return {};
+    std::string authority = HttpClient::host_of(url);
+    std::string host = authority, port;
+    if (!authority.empty() && authority[0] == '[') {
+        std::size_t close = authority.find(']');
+        if (close == std::string::npos) return {};
+        host = authority.substr(1, close - 1);
+        if (close + 1 < authority.size() && authority[close + 1] == ':') port = authority.substr(close + 2);
+    } else if (std::size_t colon = authority.rfind(':'); colon != std::string::npos) {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+    }
+    if (port.empty()) port = scheme == "https" ? "443" : "80";
+    return {host, port};
+}
+
+const char* method_name(HttpClient::Method method) {
+    switch (method) {
+    case HttpClient::Method::get: return "GET";
+    case HttpClient::Method::post: return "POST";
+    case HttpClient::Method::put: return "PUT";
+    case HttpClient::Method::patch: return "PATCH";
+    case HttpClient::Method::head: return "HEAD";
+    }
+    return "GET";
+}
+} // namespace
+
+HttpClient& HttpClient::get_instance() {
+    static HttpClient instance;
+    return instance;
+}
+
+cpr::Response HttpClient::get(cpr::Session& session) {
+    return send_all({&session}, {Method::get}).front();
+}
+
+cpr::Response HttpClient::post(cpr::Session& session) {
+    return send_all({&session}, {Method::post}).front();
+}
+
+cpr::Response HttpClient::head(cpr::Session& session) {
+    return send_all({&session}, {Method::head}).front();
+}
+
+std::vector<cpr::Response> HttpClient::get_all(const std::vector<cpr::Session*>& sessions) {
+    return send_all(sessions, {Method::get});
+}
+
+std::vector<cpr::Response> HttpClient::send_all(const std::vector<cpr::Session*>& sessions,
+                                                const std::vector<Method>& methods) {
+    std::vector<cpr::Response> responses(sessions.size());
+    std::vector<std::unique_ptr<Pin>> taken(sessions.size());
+    std::vector<CURL*> handles;
+    std::vector<std::size_t> sent;
+    for (std::size_t i = 0; i < sessions.size(); ++i) {
+        CURL* handle = sessions[i]->GetCurlHolder()->handle;
+        taken[i] = take_pin(*sessions[i]);
+        if (taken[i] && taken[i]->unresolvable) {
+            responses[i].url = cpr::Url{taken[i]->url};
+            responses[i].error.code = cpr::ErrorCode::HOST_RESOLUTION_FAILURE;
+            responses[i].error.message = taken[i]->error;
+            // Dropped with the pin: a resend goes to curl.
+            continue;
+        }
+        Method method = methods[methods.size() == 1 ? 0 : i];
+        switch (method) {
+        case Method::get: sessions[i]->PrepareGet(); break;
+        case Method::post: sessions[i]->PreparePost(); break;
+        case Method::put: sessions[i]->PreparePut(); break;
+        case Method::patch: sessions[i]->PreparePatch(); break;
+        case Method::head: sessions[i]->PrepareHead(); break;
+        }
+        handles.push_back(handle);
+        sent.push_back(i);
+    }
+    if (handles.empty()) return responses;
+
+    std::uint64_t start = tracing_enabled() ? trace_now() : 0;
+    std::vector<CURLcode> results = CurlMultiplexer::get_instance().perform(handles);
+    for (std::size_t j = 0; j < sent.size(); ++j) {
+        std::size_t i = sent[j];
+        responses[i] = sessions[i]->Complete(results[j]);
+        // The pin covers one request; a resend without set_url resolves anew.
+        if (taken[i]) curl_easy_setopt(handles[j], CURLOPT_CONNECT_TO, nullptr);
+        taken[i].reset();
+        observe(responses[i]);
+        if (start) trace(*sessions[i], responses[i], method_name(methods[methods.size() == 1 ? 0 : i]), start);
+    }
+    return responses;
+}
+
+void HttpClient::set_url(cpr::Session& session, const std::string& url) {
+    session.SetUrl(cpr::Url{url});
+    if (TorProxy::get_instance().is_available()) return;
+    auto [host, port] = endpoint_of(url);
+    if (host.empty()) return;
+
+    auto pin = std::make_unique<Pin>();
+    pin->url = url;
+    auto result = DnsResolver::get_instance().resolve(host);
+    if (result.ok()) {
+        // CONNECT_TO takes a single target, so curl no longer falls back
+        // across the answer's addresses; the resolver's first one is used.
+        const auto& address = result.addresses.front();
+        std::string entry = (host.find(':') == std::string::npos ? host : "[" + host + "]") + ":" + port + ":" +
+                            (address.find(':') == std::string::npos ? address : "[" + address + "]") + ":" + port;
+        pin->connect_to = curl_slist_append(nullptr, entry.c_str());
+    } else if (result.not_found()) {
+        pin->unresolvable = true;
+        pin->error = "could not resolve " + host + ": " + result.error();
+    }
+    // Anything else (a timeout, no resolver) leaves the lookup to curl.
+
+    // Replaces any previous pin, which is freed once the handle stops
+    // pointing at it.
+    curl_easy_setopt(session.GetCurlHolder()->handle, CURLOPT_CONNECT_TO, pin->connect_to);
+    take_pin(session);
+    if (pin->connect_to || pin->unresolvable) put_pin(session, std::move(pin));
+}
+
+std::string HttpClient::host_of(const std::string& url) {
+    std::size_t start = url.find("://");
+    start = (start == std::string::npos) ? 0 : start + 3;
+    std::size_t end = url.find_first_of("/?#", start);
+    std::string authority = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    std::size_t at = authority.rfind('@');
+    if (at != std::string::npos) {
+        authority.erase(0, at + 1);
+    }
+    return authority;
+}
+
+void HttpClient::observe(const cpr::Response& response) {
+    auto& registry = MetricsRegistry::get_instance();
+    static Histogram& latency = registry.histogram("spectre_outbound_request_duration_seconds",
+                                                   "Wall time of outbound probe requests.");
+    static Counter& bytes = registry.counter("spectre_outbound_bytes_received_total",
+                                             "Response body bytes received by outbound probes.");
+
+    // Resolving a labelled series takes the registry lock, so each thread keeps
+    // its own host/status -> counter map and only goes to the registry once.
+    thread_local std::unordered_map<std::string, Counter*> requests_by_key;
+    std::string host = host_of(response.url.str());
+    std::string status = response.status_code == 0 ? "error" : std::to_string(response.status_code);
+    auto& slot = requests_by_key[host + '\n' + status];
+    if (!slot) {
+        slot = &registry.counter("spectre_outbound_requests_total", "Outbound probe requests by host and status.",
+                                 {{"host", host}, {"status", status}});
+    }
+    slot->inc();
+    scan_request_sent();
+    usage_record_request(response.uploaded_bytes > 0 ? static_cast<std::uint64_t>(response.uploaded_bytes) : 0,
+                         response.downloaded_bytes > 0 ? static_cast<std::uint64_t>(response.downloaded_bytes) : 0);
+
+    latency.observe(static_cast<std::uint64_t>(response.elapsed * 1e6));
+    if (response.downloaded_bytes > 0) {
+        bytes.inc(static_cast<std::uint64_t>(response.downloaded_bytes));
+    }
+}
+
+std::chrono::microseconds HttpClient::server_time(cpr::Session& session) {
+    CURL* handle = session.GetCurlHolder()->handle;
+    curl_off_t pretransfer = 0, first_byte = 0;
+    curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    return std::chrono::microseconds(first_byte > pretransfer ? first_byte - pretransfer : 0);
+}
+
+// Splits the request into curl's phases. curl reports each as cumulative
+// microseconds since the transfer started.
+void HttpClient::trace(cpr::Session& session, const cpr::Response& response, const char* method,
+                       std::uint64_t start_ns) {
+    std::uint64_t end_ns = trace_now();
+    std::string host = host_of(response.url.str());
+    trace_complete(method, "http", start_ns, end_ns, host);
+
+    CURL* handle = session.GetCurlHolder()->handle;
+    curl_off_t dns = 0, connect = 0, tls = 0, pretransfer = 0, first_byte = 0, total = 0;
+    curl_easy_getinfo(handle, CURLINFO_NAMELOOKUP_TIME_T, &dns);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connect);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &tls);
+    curl_easy_getinfo(handle, CURLINFO_PRETRANSFER_TIME_T, &pretransfer);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(handle, CURLINFO_TOTAL_TIME_T, &total);
+
+    auto phase = [&](const char* name, curl_off_t from, curl_off_t to) {
+        if (to > from) {
+            trace_complete(name, "http", start_ns + static_cast<std::uint64_t>(from) * 1000,
+                           start_ns + static_cast<std::uint64_t>(to) * 1000, host);
+        }
+    };
+    phase("dns", 0, dns);
+    phase("connect", dns, connect);
+    if (tls > 0) phase("tls", connect, tls);
+    phase("wait", pretransfer, first_byte);
+    phase("transfer", first_byte, total);
+}
+
+} // namespace spectre
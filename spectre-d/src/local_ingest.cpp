@@ -0,0 +1,267 @@
+#include "spectre/local_ingest.h"
+#include "spectre/metrics.h"
+#include "spectre/log.h"
+#include <boost/asio.hpp>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using boost::asio::local::stream_protocol;
+
+namespace spectre {
+
+namespace {
+const LogSource& logger = Logger::get_instance().source("ingest");
+
+constexpr std::uint32_t kMaxFrameBytes = 16u << 20;
+constexpr std::size_t kMaxQueuedFrames = 64;
+constexpr std::size_t kPooledBuffers = 64;
+constexpr std::size_t kMaxPooledCapacity = 1u << 20;
+
+std::uint32_t read_u32(const unsigned char* p) {
+    return (std::uint32_t(p[0]) << 24) | (std::uint32_t(p[1]) << 16) | (std::uint32_t(p[2]) << 8) | std::uint32_t(p[3]);
+}
+
+// A leftover from an earlier run is removed; anything else at the path,
+// including another user's socket, is left alone and blocks the bind.
+bool clear_stale_socket(const std::string& path) {
+    struct stat st{};
+    if (::lstat(path.c_str(), &st) != 0) return errno == ENOENT;
+    if (!S_ISSOCK(st.st_mode) || st.st_uid != ::geteuid()) {
+        logger.error("path is not our socket, local ingest is off", {{"path", path}});
+        return false;
+    }
+    return ::unlink(path.c_str()) == 0;
+}
+} // namespace
+
+class LocalIngest::Impl {
+    struct Connection {
+        explicit Connection(stream_protocol::socket s) : socket(std::move(s)) {}
+        stream_protocol::socket socket;
+        std::array<unsigned char, 4> header{};
+        std::vector<char> body;
+    };
+
+    std::string path_;
+    boost::asio::io_context io_;
+    stream_protocol::acceptor acceptor_;
+    std::thread io_thread_;
+    std::thread parse_thread_;
+    TaskHandler handler_;
+
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<std::vector<char>> frames_;
+    std::vector<std::vector<char>> pool_;
+    bool running_ = false;
+
+    Counter& accepted_ = MetricsRegistry::get_instance().counter(
+        "spectre_ingest_tasks_total", "Tasks accepted by an ingest path.", {{"source", "unix"}});
+    Counter& rejected_ = MetricsRegistry::get_instance().counter(
+        "spectre_ingest_rejected_total", "Tasks or frames dropped as malformed.", {{"source", "unix"}});
+
+public:
+    explicit Impl(std::string path) : path_(std::move(path)), acceptor_(io_) {}
+
+    void start(TaskHandler handler) {
+        handler_ = std::move(handler);
+        // The other ingest paths still work without this one, so a socket
+        // that cannot be bound is logged instead of failing startup.
+        if (path_.empty()) {
+            logger.error("no private directory for the socket, local ingest is off");
+            return;
+        }
+        if (!clear_stale_socket(path_)) return;
+        stream_protocol::endpoint endpoint(path_);
+        boost::system::error_code ec;
+        acceptor_.open(endpoint.protocol(), ec);
+        if (!ec) {
+            // Created 0600 rather than chmod-ed after bind, which would leave
+            // it open to other users in between. Startup is single-threaded
+            // here, so the process-wide umask is safe to swap.
+            mode_t previous = ::umask(0177);
+            acceptor_.bind(endpoint, ec);
+            ::umask(previous);
+        }
+        if (!ec) acceptor_.listen(stream_protocol::acceptor::max_listen_connections, ec);
+        if (ec) {
+            logger.error("cannot listen, local ingest is off", {{"path", path_}, {"error", ec.message()}});
+            acceptor_.close(ec);
+            return;
+        }
+
+        running_ = true;
+        start_accept();
+        io_thread_ = std::thread([this] { io_.run(); });
+        parse_thread_ = std::thread([this] { parse_loop(); });
+        logger.info("listening", {{"path", path_}});
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!running_) return;
+            running_ = false;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
+        io_.stop();
+        if (io_thread_.joinable()) io_thread_.join();
+        if (parse_thread_.joinable()) parse_thread_.join();
+        ::unlink(path_.c_str());
+    }
+
+private:
+    void start_accept() {
+        acceptor_.async_accept([this](boost::system::error_code ec, stream_protocol::socket socket) {
+            if (!ec) {
+                read_header(std::make_shared<Connection>(std::move(socket)));
+            }
+            if (running_) start_accept();
+        });
+    }
+
+    void read_header(std::shared_ptr<Connection> conn) {
+        boost::asio::async_read(conn->socket, boost::asio::buffer(conn->header),
+            [this, conn](boost::system::error_code ec, std::size_t) {
+                if (ec) return;
+                std::uint32_t length = read_u32(conn->header.data());
+                if (length < 4 || length > kMaxFrameBytes) {
+                    rejected_.inc();
+                    logger.warn("bad frame length, closing connection", {{"length", length}});
+                    return;
+                }
+                conn->body = acquire_buffer();
+                conn->body.resize(length);
+                read_body(conn);
+            });
+    }
+
+    void read_body(std::shared_ptr<Connection> conn) {
+        boost::asio::async_read(conn->socket, boost::asio::buffer(conn->body),
+            [this, conn](boost::system::error_code ec, std::size_t) {
+                if (ec) {
+                    release_buffer(std::move(conn->body));
+                    return;
+                }
+                if (!enqueue(std::move(conn->body))) return;
+                read_header(conn);
+            });
+    }
+
+    // Blocks the I/O thread when the parser falls behind; that stalls reads
+    // and pushes back on writers through the socket buffers.
+    bool enqueue(std::vector<char> frame) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return !running_ || frames_.size() < kMaxQueuedFrames; });
+        if (!running_) return false;
+        frames_.push_back(std::move(frame));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    std::vector<char> acquire_buffer() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pool_.empty()) return {};
+        auto buffer = std::move(pool_.back());
+        pool_.pop_back();
+        return buffer;
+    }
+
+    void release_buffer(std::vector<char> buffer) {
+        if (buffer.capacity() > kMaxPooledCapacity) return;
+        buffer.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pool_.size() < kPooledBuffers) pool_.push_back(std::move(buffer));
+    }
+
+    void parse_loop() {
+        while (true) {
+            std::vector<char> frame;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                not_empty_.wait(lock, [this] { return !running_ || !frames_.empty(); });
+                if (!running_) return;
+                frame = std::move(frames_.front());
+                frames_.pop_front();
+            }
+            not_full_.notify_one();
+            parse_frame(frame);
+            release_buffer(std::move(frame));
+        }
+    }
+
+    void parse_frame(const std::vector<char>& frame) {
+        const auto* p = reinterpret_cast<const unsigned char*>(frame.data());
+        const auto* end = p + frame.size();
+        std::uint32_t count = read_u32(p);
+        p += 4;
+        for (std::uint32_t i = 0; i < count; ++i) {
+            if (end - p < 4) {
+                rejected_.inc();
+                return;
+            }
+            std::uint32_t length = read_u32(p);
+            p += 4;
+            if (static_cast<std::size_t>(end - p) < length) {
+                rejected_.inc();
+                return;
+            }
+            try {
+                Task task = parse_task(std::string(reinterpret_cast<const char*>(p), length));
+                accepted_.inc();
+                handler_(task);
+            } catch (const std::exception&) {
+                rejected_.inc();
+            }
+            p += length;
+        }
+    }
+};
+
+LocalIngest::LocalIngest(std::string socket_path) : impl_(std::make_unique<Impl>(std::move(socket_path))) {}
+LocalIngest::~LocalIngest() { impl_->stop(); }
+
+std::string LocalIngest::default_path() {
+    namespace fs = std::filesystem;
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) return (fs::path(runtime) / "spectre-d.sock").string();
+
+    std::error_code ec;
+    fs::path base = fs::temp_directory_path(ec);
+    if (base.empty()) base = "/tmp";
+    std::string dir = (base / ("spectre-d-" + std::to_string(::geteuid()))).string();
+    if (::mkdir(dir.c_str(), S_IRWXU) != 0 && errno != EEXIST) {
+        logger.error("could not create socket directory", {{"path", dir}, {"error", std::strerror(errno)}});
+        return "";
+    }
+    // The name is predictable, so it may have been created by someone else.
+    struct stat st{};
+    if (::lstat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != ::geteuid() ||
+        (st.st_mode & 077) != 0) {
+        logger.error("socket directory is not private", {{"path", dir}});
+        return "";
+    }
+    return dir + "/spectre-d.sock";
+}
+
+void LocalIngest::start(TaskHandler handler) {
+    impl_->start(std::move(handler));
+}
+
+void LocalIngest::stop() {
+    impl_->stop();
+}
+
+} // namespace spectre
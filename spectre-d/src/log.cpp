@@ -0,0 +1,381 @@
+#include "spectre/log.h"
+#include "spectre/metrics.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace spectre {
+
+namespace {
+constexpr std::size_t kRingSize = 1024;
+
+struct Record {
+    std::uint64_t ts_ns = 0;
+    LogLevel level = LogLevel::info;
+    const LogSource* source = nullptr;
+    std::string scan;
+    std::string host;
+    std::string text;
+};
+
+// Single-producer single-consumer ring owned by one logging thread.
+struct Ring {
+    std::array<Record, kRingSize> slots;
+    alignas(64) std::atomic<std::uint64_t> head{0};
+    alignas(64) std::atomic<std::uint64_t> tail{0};
+    std::atomic<bool> retired{false};
+};
+
+thread_local std::string tls_scan;
+thread_local std::string tls_host;
+
+bool needs_quotes(std::string_view v) {
+    if (v.empty()) return true;
+    for (char c : v) {
+        if (c == ' ' || c == '=' || c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20) return true;
+    }
+    return false;
+}
+
+void append_value(std::string& out, std::string_view v) {
+    if (!needs_quotes(v)) {
+        out.append(v);
+        return;
+    }
+    out.push_back('"');
+    for (char c : v) {
+        switch (c) {
+        case '"': out.append("\\\""); break;
+        case '\\': out.append("\\\\"); break;
+        case '\n': out.append("\\n"); break;
+        case '\r': out.append("\\r"); break;
+        case '\t': out.append("\\t"); break;
+        default: out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+void append_field(std::string& out, const LogField& f) {
+    out.push_back(' ');
+    out.append(f.key);
+    out.push_back('=');
+    if (f.is_real) {
+        char buf[32];
+        int n = std::snprintf(buf, sizeof(buf), "%g", f.real);
+        out.append(buf, n > 0 ? static_cast<std::size_t>(n) : 0);
+    } else if (f.is_number) {
+        char buf[24];
+        int n = std::snprintf(buf, sizeof(buf), "%lld", f.number);
+        out.append(buf, n > 0 ? static_cast<std::size_t>(n) : 0);
+    } else {
+        append_value(out, f.text);
+    }
+}
+
+void format_body(std::string& out, std::string_view msg, std::initializer_list<LogField> fields) {
+    out.assign("msg=");
+    append_value(out, msg);
+    for (const auto& f : fields) append_field(out, f);
+}
+
+void format_line(std::string& line, const Record& r) {
+    std::time_t secs = static_cast<std::time_t>(r.ts_ns / 1000000000);
+    std::tm tm{};
+    gmtime_r(&secs, &tm);
+    char ts[40];
+    std::snprintf(ts, sizeof(ts), "%04d-%02d-%02dT%02d:%02d:%02d.%06uZ", tm.tm_year + 1900, tm.tm_mon + 1,
+                  tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                  static_cast<unsigned>((r.ts_ns % 1000000000) / 1000));
+    line.append("ts=").append(ts);
+    line.append(" level=").append(to_string(r.level));
+    line.append(" source=");
+    append_value(line, r.source->name());
+    if (!r.scan.empty()) {
+        line.append(" scan=");
+        append_value(line, r.scan);
+    }
+    if (!r.host.empty()) {
+        line.append(" host=");
+        append_value(line, r.host);
+    }
+    line.push_back(' ');
+    line.append(r.text);
+    line.push_back('\n');
+}
+
+std::uint64_t now_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+} // namespace
+
+const char* to_string(LogLevel level) {
+    switch (level) {
+    case LogLevel::trace: return "trace";
+    case LogLevel::debug: return "debug";
+    case LogLevel::info: return "info";
+    case LogLevel::warn: return "warn";
+    case LogLevel::error: return "error";
+    case LogLevel::off: return "off";
+    }
+    return "unknown";
+}
+
+bool parse_log_level(std::string_view text, LogLevel& level) {
+    static const std::pair<std::string_view, LogLevel> names[] = {
+        {"trace", LogLevel::trace}, {"debug", LogLevel::debug}, {"info", LogLevel::info},
+        {"warn", LogLevel::warn},   {"warning", LogLevel::warn}, {"error", LogLevel::error},
+        {"off", LogLevel::off},
+    };
+    for (const auto& [name, value] : names) {
+        if (text == name) {
+            level = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+class Logger::Impl {
+public:
+    std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<LogSource>> sources_;
+    std::map<std::string, LogLevel> overrides_;
+    LogLevel default_level_ = LogLevel::info;
+
+    std::mutex rings_mutex_;
+    std::vector<std::shared_ptr<Ring>> rings_;
+
+    std::mutex out_mutex_;
+    std::FILE* out_ = stderr;
+    std::atomic<bool> running_{false};
+    std::thread writer_;
+    std::condition_variable wake_;
+    std::mutex wake_mutex_;
+    bool stopping_ = false;
+
+    Counter& dropped_ = MetricsRegistry::get_instance().counter(
+        "spectre_log_dropped_total", "Log records dropped because a thread's ring was full.");
+
+    std::shared_ptr<Ring> register_ring() {
+        auto ring = std::make_shared<Ring>();
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.push_back(ring);
+        return ring;
+    }
+
+    void write_sync(LogLevel level, const LogSource& source, std::string_view msg,
+                    std::initializer_list<LogField> fields) {
+        Record r;
+        r.ts_ns = now_ns();
+        r.level = level;
+        r.source = &source;
+        r.scan = tls_scan;
+        r.host = tls_host;
+        format_body(r.text, msg, fields);
+        std::string line;
+        format_line(line, r);
+        std::lock_guard<std::mutex> lock(out_mutex_);
+        std::fwrite(line.data(), 1, line.size(), out_);
+        std::fflush(out_);
+    }
+
+    // Returns the number of records written.
+    std::size_t drain(std::vector<const Record*>& batch, std::string& buffer) {
+        std::vector<std::pair<Ring*, std::uint64_t>> claimed;
+        {
+            std::lock_guard<std::mutex> lock(rings_mutex_);
+            for (auto& ring : rings_) {
+                std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+                std::uint64_t head = ring->head.load(std::memory_order_acquire);
+                for (std::uint64_t i = tail; i < head; ++i) {
+                    batch.push_back(&ring->slots[i % kRingSize]);
+                }
+                if (head != tail) claimed.emplace_back(ring.get(), head);
+            }
+        }
+        if (batch.empty()) {
+            collect_retired();
+            return 0;
+        }
+        std::stable_sort(batch.begin(), batch.end(),
+                         [](const Record* a, const Record* b) { return a->ts_ns < b->ts_ns; });
+        buffer.clear();
+        for (const Record* r : batch) format_line(buffer, *r);
+        std::size_t written = batch.size();
+        batch.clear();
+        for (auto& [ring, head] : claimed) ring->tail.store(head, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(out_mutex_);
+            std::fwrite(buffer.data(), 1, buffer.size(), out_);
+            std::fflush(out_);
+        }
+        return written;
+    }
+
+    void collect_retired() {
+        std::lock_guard<std::mutex> lock(rings_mutex_);
+        rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                    [](const std::shared_ptr<Ring>& r) {
+                                        return r->retired.load(std::memory_order_acquire) &&
+                                               r->tail.load(std::memory_order_relaxed) ==
+                                                   r->head.load(std::memory_order_acquire);
+                                    }),
+                     rings_.end());
+    }
+
+    void writer_loop() {
+        std::vector<const Record*> batch;
+        std::string buffer;
+        while (true) {
+            if (drain(batch, buffer) > 0) continue;
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            if (stopping_) break;
+            wake_.wait_for(lock, std::chrono::milliseconds(20));
+        }
+        while (drain(batch, buffer) > 0) {
+        }
+    }
+};
+
+namespace {
+struct ThreadRing {
+    std::shared_ptr<Ring> ring;
+    ~ThreadRing() {
+        if (ring) ring->retired.store(true, std::memory_order_release);
+    }
+};
+thread_local ThreadRing tls_ring;
+} // namespace
+
+void LogSource::write(LogLevel level, std::string_view msg, std::initializer_list<LogField> fields) const {
+    auto& impl = *Logger::get_instance().impl_;
+    if (!impl.running_.load(std::memory_order_acquire)) {
+        impl.write_sync(level, *this, msg, fields);
+        return;
+    }
+    if (!tls_ring.ring) tls_ring.ring = impl.register_ring();
+    Ring& ring = *tls_ring.ring;
+    std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= kRingSize) {
+        impl.dropped_.inc();
+        return;
+    }
+    Record& r = ring.slots[head % kRingSize];
+    r.ts_ns = now_ns();
+    r.level = level;
+    r.source = this;
+    r.scan = tls_scan;
+    r.host = tls_host;
+    format_body(r.text, msg, fields);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+Logger::Logger() : impl_(std::make_unique<Impl>()) {}
+Logger::~Logger() = default;
+
+// Never destroyed: plugins and late static destructors may still log.
+Logger& Logger::get_instance() {
+    static Logger* instance = new Logger();
+    return *instance;
+}
+
+LogSource& Logger::source(const std::string& name) {
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    auto& slot = impl_->sources_[name];
+    if (!slot) {
+        auto it = impl_->overrides_.find(name);
+        bool overridden = it != impl_->overrides_.end();
+        slot = std::make_unique<LogSource>(name, overridden ? it->second : impl_->default_level_);
+        slot->overridden_ = overridden;
+    }
+    return *slot;
+}
+
+void Logger::set_level(LogLevel level) {
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->default_level_ = level;
+    for (auto& [name, source] : impl_->sources_) {
+        if (!source->overridden_) source->level_.store(level, std::memory_order_relaxed);
+    }
+}
+
+void Logger::set_level(const std::string& source, LogLevel level) {
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    impl_->overrides_[source] = level;
+    auto it = impl_->sources_.find(source);
+    if (it != impl_->sources_.end()) {
+        it->second->overridden_ = true;
+        it->second->level_.store(level, std::memory_order_relaxed);
+    }
+}
+
+bool Logger::configure(std::string_view spec) {
+    bool ok = true;
+    while (!spec.empty()) {
+        std::size_t comma = spec.find(',');
+        std::string_view item = spec.substr(0, comma);
+        spec = comma == std::string_view::npos ? std::string_view{} : spec.substr(comma + 1);
+        if (item.empty()) continue;
+        LogLevel level;
+        std::size_t eq = item.find('=');
+        if (eq == std::string_view::npos) {
+            if (parse_log_level(item, level)) set_level(level);
+            else ok = false;
+        } else if (parse_log_level(item.substr(eq + 1), level)) {
+            set_level(std::string(item.substr(0, eq)), level);
+        } else {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+nlohmann::json Logger::levels() {
+    std::lock_guard<std::mutex> lock(impl_->mutex_);
+    nlohmann::json sources = nlohmann::json::object();
+    for (auto& [name, source] : impl_->sources_) sources[name] = to_string(source->level());
+    return {{"default", to_string(impl_->default_level_)}, {"sources", sources}};
+}
+
+void Logger::start(std::FILE* out) {
+    if (impl_->running_.load()) return;
+    {
+        std::lock_guard<std::mutex> lock(impl_->out_mutex_);
+        impl_->out_ = out ? out : stderr;
+    }
+    impl_->stopping_ = false;
+    impl_->writer_ = std::thread([this] { impl_->writer_loop(); });
+    impl_->running_.store(true, std::memory_order_release);
+}
+
+void Logger::stop() {
+    if (!impl_->running_.exchange(false)) return;
+    {
+        std::lock_guard<std::mutex> lock(impl_->wake_mutex_);
+        impl_->stopping_ = true;
+    }
+    impl_->wake_.notify_all();
+    if (impl_->writer_.joinable()) impl_->writer_.join();
+    std::lock_guard<std::mutex> lock(impl_->out_mutex_);
+    impl_->out_ = stderr;
+}
+
+LogScope::LogScope(std::string scan_id, std::string host)
+    : prev_scan_(std::exchange(tls_scan, std::move(scan_id))), prev_host_(std::exchange(tls_host, std::move(host))) {}
+
+LogScope::~LogScope() {
+    tls_scan = std::move(prev_scan_);
+    tls_host = std::move(prev_host_);
+}
+
+} // namespace spectre
@@ -1,30 +1,81 @@
 #include <boost/asio.hpp>
 #include <boost/asio/signal_set.hpp>
-#include <iostream>
 #include <cstdlib>
+#include <chrono>
+#include <functional>
+#include <set>
+#include <sstream>
+#include <thread>
 #include "spectre/plugin_loader.h"
+#include "spectre/plugin_worker.h"
 #include "spectre/network_manager.h"
+#include "spectre/local_ingest.h"
 #include "spectre/tor_proxy.h"
 #include <nlohmann/json.hpp>
 #include "spectre/websocket_server.h"
 #include "spectre/proof_queue.h"
+#include "spectre/proof_store.h"
 #include "spectre/canary_monitor.h"
+#include "spectre/checkpoint.h"
+#include "spectre/dispatcher.h"
+#include "spectre/scan_registry.h"
 #include "spectre/http/http_server.h"
+#include "spectre/log.h"
+#include "spectre/startup.h"
+#include "spectre/trace.h"
+#include "spectre/workflow.h"
 
 int main(int argc, char* argv[]) {
+    if (spectre::is_worker_invocation(argc, argv)) return spectre::run_plugin_worker(argc, argv);
+
+    auto& startup = spectre::Startup::get_instance();
+    startup.begin();
+    startup.pending("plugins");
+    startup.pending("dispatcher");
+    startup.pending("listeners");
+    auto& log = spectre::Logger::get_instance();
+    const auto& logger = log.source("spectre-d");
+    if (const char* spec = std::getenv("SPECTRE_LOG")) {
+        if (!log.configure(spec)) logger.warn("ignoring invalid parts of SPECTRE_LOG", {{"spec", spec}});
+    } else if (std::getenv("SPECTRE_DEBUG")) {
+        log.set_level(spectre::LogLevel::debug);
+    }
+    std::FILE* log_file = nullptr;
+    if (const char* path = std::getenv("SPECTRE_LOG_FILE")) {
+        log_file = std::fopen(path, "a");
+        if (!log_file) logger.error("could not open log file", {{"path", path}});
+    }
+    log.start(log_file ? log_file : stderr);
+    if (std::getenv("SPECTRE_TRACE")) spectre::Tracer::get_instance().set_enabled(true);
+    // Overlaps the SOCKS probe with plugin loading; the first outbound
+    // request waits for its answer.
+    spectre::TorProxy::get_instance().start_probe();
+
     try {
         boost::asio::io_context io;
 
         std::string plugin_dir = (argc > 1) ? argv[1] : "plugins";
         spectre::PluginLoader loader(plugin_dir);
-        auto plugins = loader.load_all();
-        std::cout << "spectre-d: loaded " << plugins.size() << " plugins" << std::endl;
-            
-        if (spectre::TorProxy::get_instance().is_available()) {
-            std::cout << "spectre-d: Tor proxy available at 127.0.0.1:9050. Anonymity is ON." << std::endl;
-        } else {
-            std::cout << "spectre-d: Tor proxy NOT available. Anonymity is OFF." << std::endl;
+        // SPECTRE_ISOLATE names plugin libraries (or "all") to run in worker
+        // processes; those are never loaded into the daemon.
+        std::set<std::string> isolated;
+        if (const char* isolate_env = std::getenv("SPECTRE_ISOLATE")) {
+            std::stringstream list(isolate_env);
+            for (std::string name; std::getline(list, name, ',');) {
+                if (!name.empty()) isolated.insert(name);
+            }
+        }
+        if (!isolated.empty()) {
+            loader.isolate(std::move(isolated), [options = spectre::WorkerOptions::from_env()](const std::string& path) {
+                return spectre::make_isolated_plugin(path, options);
+            });
         }
+        auto plugins = loader.load_all();
+        logger.info("plugins loaded", {{"count", plugins.size()}});
+        startup.ready("plugins");
+
+        const char* proof_store_path = std::getenv("SPECTRE_PROOF_STORE");
+        spectre::ProofStore::get_instance().open(proof_store_path ? proof_store_path : "spectre-proofs.jsonl");
 
         spectre::WebSocketServer ws;
         ws.start();
@@ -33,38 +84,79 @@ int main(int argc, char* argv[]) {
         
         spectre::start_canary_monitor();
         
+        const char* workers_env = std::getenv("SPECTRE_WORKERS");
+        std::size_t workers = workers_env ? std::strtoul(workers_env, nullptr, 10) : std::thread::hardware_concurrency();
+        spectre::Dispatcher dispatcher(plugins, workers);
+        spectre::WorkflowScheduler workflows(dispatcher);
+        dispatcher.start();
+        startup.ready("dispatcher");
+
+        const char* watch_env = std::getenv("SPECTRE_PLUGIN_WATCH");
+        if (!watch_env || std::string(watch_env) != "0") {
+            loader.watch(
+                [&dispatcher](std::shared_ptr<spectre::Plugin> plugin) { dispatcher.upsert_plugin(std::move(plugin)); },
+                [&dispatcher](const std::string& name) { dispatcher.remove_plugin(name); });
+        }
+
+        const char* interval_env = std::getenv("SPECTRE_PROGRESS_INTERVAL_MS");
+        spectre::ScanRegistry::get_instance().start_events(
+            [&ws](const std::string& event) { ws.broadcast(event); },
+            std::chrono::milliseconds(interval_env ? std::strtoul(interval_env, nullptr, 10) : 500));
+
         spectre::NetworkManager network;
-        network.start([&plugins, &ws](const spectre::Task& task) {
-            ws.broadcast(task.data.dump());
-            for (auto& p : plugins) {
-                try {
-                    p->handle_task(task);
-                } catch (const std::exception& ex) {
-                    std::cerr << "[plugin] exception from " << p->name() << ": " << ex.what() << std::endl;
-                } catch (...) {
-                    std::cerr << "[plugin] unknown exception from " << p->name() << std::endl;
-                }
-            }
+        network.start([&dispatcher, &ws](const spectre::Task& task) {
+            ws.broadcast(task.raw);
+            dispatcher.submit(task);
         });
 
-        spectre::http_server http_server(io, 8081, network);
+        const char* ingest_path = std::getenv("SPECTRE_INGEST_SOCKET");
+        spectre::LocalIngest ingest(ingest_path ? ingest_path : spectre::LocalIngest::default_path());
+        ingest.start([&dispatcher](const spectre::Task& task) { dispatcher.submit(task); });
+
+        auto resumed = spectre::CheckpointStore::get_instance().pending();
+        if (!resumed.empty()) logger.info("resuming unfinished scans", {{"count", resumed.size()}});
+        for (auto& task : resumed) dispatcher.submit(std::move(task));
 
-        std::cout << "spectre-d: daemon started" << std::endl;
+        spectre::http_server http_server(io, 8081, network, dispatcher, workflows);
+        startup.ready("listeners");
+
+        logger.info("daemon started");
 
         boost::asio::signal_set signals(io, SIGINT, SIGTERM);
         signals.async_wait([&](const boost::system::error_code&, int) {
             io.stop();
         });
 
+        const char* trace_dir = std::getenv("SPECTRE_TRACE_DIR");
+        boost::asio::signal_set trace_signal(io, SIGUSR1);
+        std::function<void(const boost::system::error_code&, int)> on_trace_signal =
+            [&](const boost::system::error_code& ec, int) {
+                if (ec) return;
+                std::string path = spectre::Tracer::get_instance().dump_to_file(trace_dir ? trace_dir : ".");
+                if (path.empty()) logger.error("trace dump failed");
+                else logger.info("trace written", {{"path", path}});
+                trace_signal.async_wait(on_trace_signal);
+            };
+        trace_signal.async_wait(on_trace_signal);
+
         io.run();
 
+        loader.stop_watching();
+        network.stop();
+        ingest.stop();
+        // Running scans save their state at their next checkpoint and stop.
+        spectre::CheckpointStore::get_instance().interrupt();
+        dispatcher.stop();
+        spectre::ScanRegistry::get_instance().stop_events();
     } catch (const std::exception& e) {
-        std::cerr << "spectre-d: exception: " << e.what() << std::endl;
+        logger.error("exception", {{"error", e.what()}});
     }
 
     spectre::shutdown_proof_queue();
     spectre::stop_canary_monitor();
-    std::cout << "spectre-d: shutdown" << std::endl;
+    logger.info("shutdown");
+    log.stop();
+    if (log_file) std::fclose(log_file);
 
     return 0;
 } 
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "spectre/matchers.h"
+#include <cctype>
+#include <deque>
+
+namespace spectre {
+
+const SqlErrorMatcher& SqlErrorMatcher::get_instance() {
+    static const SqlErrorMatcher instance;
+    return instance;
+}
+
+SqlErrorMatcher::SqlErrorMatcher() {
+    static const char* const patterns[] = {
+        "SQL syntax.*MySQL",
+        "Warning.*mysql_",
+        "MySQLSyntaxErrorException",
+        "valid MySQL result",
+        "PostgreSQL.*ERROR",
+        "Warning.*pg_",
+        "valid PostgreSQL result",
+        "ORA-[0-9][0-9][0-9][0-9]",
+        "Oracle error",
+        "Oracle.*Driver",
+        "SQLServer JDBC Driver",
+        "SqlException",
+        "SQLite/JDBCDriver",
+        "SQLite.Exception",
+        "System.Data.SQLite.SQLiteException",
+        "Warning.*sqlite_",
+        "Microsoft.*ODBC.*SQL Server.*Driver",
+        "\\[SQL Server\\]",
+        "ODBC SQL Server Driver",
+        "ODBC Driver.*for SQL Server",
+        "SQLServer JDBC Driver",
+        "com.jnetdirect.jsql",
+        "macromedia.jdbc.sqlserver",
+        "Zend.Db.(Adapter|Statement)",
+        "Pdo.*(mysql|pgsql|oci):",
+        "PDOException"
+    };
+    for (const char* pattern : patterns) {
+        signatures_.emplace_back(pattern, std::regex_constants::icase | std::regex_constants::optimize);
+    }
+}
+
+bool SqlErrorMatcher::matches(const std::string& body) const {
+    for (const auto& sig : signatures_) {
+        if (std::regex_search(body, sig)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+MultiPatternMatcher::MultiPatternMatcher(const std::vector<std::string>& patterns, bool ignore_case)
+    : pattern_count_(patterns.size()), ignore_case_(ignore_case) {
+    auto fold = [ignore_case](char c) {
+        auto b = static_cast<unsigned char>(c);
+        return ignore_case ? static_cast<unsigned char>(std::tolower(b)) : b;
+    };
+    // Trie first, with kNone for missing edges.
+    next_.assign(256, kNone);
+    output_.assign(1, kNone);
+    for (std::size_t p = 0; p < patterns.size(); ++p) {
+        std::uint32_t state = 0;
+        for (char c : patterns[p]) {
+            std::uint32_t& edge = next_[state * 256 + fold(c)];
+            if (edge == kNone) {
+                edge = static_cast<std::uint32_t>(output_.size());
+                next_.resize(next_.size() + 256, kNone);
+                output_.push_back(kNone);
+            }
+            state = next_[state * 256 + fold(c)];
+        }
+        // Empty patterns never match; duplicates report the first index.
+        if (state != 0 && output_[state] == kNone) output_[state] = static_cast<std::uint32_t>(p);
+    }
+
+    // Breadth-first, so every state's failure target is finished before it.
+    std::vector<std::uint32_t> fail(output_.size(), 0);
+    output_link_.assign(output_.size(), kNone);
+    std::deque<std::uint32_t> queue;
+    for (unsigned c = 0; c < 256; ++c) {
+        std::uint32_t& edge = next_[c];
+        if (edge == kNone) {
+            edge = 0;
+        } else {
+            queue.push_back(edge);
+        }
+    }
+    while (!queue.empty()) {
+        std::uint32_t state = queue.front();
+        queue.pop_front();
+        std::uint32_t f = fail[state];
+        output_link_[state] = output_[f] != kNone ? f : output_link_[f];
+        for (unsigned c = 0; c < 256; ++c) {
+            std::uint32_t& edge = next_[state * 256 + c];
+            if (edge == kNone) {
+                edge = next_[f * 256 + c];
+            } else {
+                fail[edge] = next_[f * 256 + c];
+                queue.push_back(edge);
+            }
+        }
+    }
+}
+
+std::vector<std::size_t> MultiPatternMatcher::find_all(std::string_view text) const {
+    std::vector<std::size_t> found;
+    if (pattern_count_ == 0) return found;
+    std::vector<bool> seen(pattern_count_);
+    std::uint32_t state = 0;
+    for (char c : text) {
+        auto b = static_cast<unsigned char>(c);
+        state = step(state, ignore_case_ ? static_cast<unsigned char>(std::tolower(b)) : b);
+        for (std::uint32_t s = output_[state] != kNone ? state : output_link_[state]; s != kNone;
+             s = output_link_[s]) {
+            std::uint32_t p = output_[s];
+            if (!seen[p]) {
+                seen[p] = true;
+                found.push_back(p);
+            }
+        }
+    }
+    return found;
+}
+
+} // namespace spectre
@@ -0,0 +1,214 @@
+#include "spectre/metrics.h"
+#include <cstdio>
+#include <sstream>
+#include <unistd.h>
+
+namespace spectre {
+
+namespace metrics_detail {
+std::size_t shard_index() {
+    static std::atomic<std::size_t> next{0};
+    thread_local const std::size_t index = next.fetch_add(1, std::memory_order_relaxed) % kShards;
+    return index;
+}
+} // namespace metrics_detail
+
+namespace {
+std::string escape_label_value(const std::string& value) {
+    std::string out;
+    out.reserve(value.size());
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            out += '\\';
+            out += c;
+        } else if (c == '\n') {
+            out += "\\n";
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+std::string label_key(const MetricLabels& labels) {
+    std::string key;
+    for (const auto& [name, value] : labels) {
+        if (!key.empty()) key += ',';
+        key += name + "=\"" + escape_label_value(value) + "\"";
+    }
+    return key;
+}
+
+std::string with_label(const std::string& key, const std::string& extra) {
+    if (key.empty()) return "{" + extra + "}";
+    return "{" + key + "," + extra + "}";
+}
+
+std::string braced(const std::string& key) {
+    return key.empty() ? std::string() : "{" + key + "}";
+}
+
+std::string micros_to_seconds(std::uint64_t micros) {
+    std::ostringstream out;
+    out << static_cast<double>(micros) / 1e6;
+    return out.str();
+}
+} // namespace
+
+std::uint64_t Counter::value() const {
+    std::uint64_t total = 0;
+    for (const auto& cell : cells_) {
+        total += cell.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::size_t Histogram::bucket_index(std::uint64_t micros) {
+    if (micros < kSubBuckets) {
+        return static_cast<std::size_t>(micros);
+    }
+    unsigned msb = 63 - static_cast<unsigned>(__builtin_clzll(micros));
+    std::size_t exponent = msb - kSubBits + 1;
+    std::size_t index = exponent * kSubBuckets + ((micros >> (msb - kSubBits)) & (kSubBuckets - 1));
+    return index < kBuckets ? index : kBuckets - 1;
+}
+
+std::uint64_t Histogram::bucket_upper(std::size_t index) {
+    std::size_t exponent = index / kSubBuckets;
+    std::uint64_t mantissa = index % kSubBuckets;
+    if (exponent == 0) {
+        return mantissa + 1;
+    }
+    return (kSubBuckets + mantissa + 1) << (exponent - 1);
+}
+
+void Histogram::observe(std::uint64_t micros) {
+    auto& shard = shards_[metrics_detail::shard_index()];
+    shard.buckets[bucket_index(micros)].fetch_add(1, std::memory_order_relaxed);
+    shard.count.fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(micros, std::memory_order_relaxed);
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snap;
+    for (const auto& shard : shards_) {
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            snap.buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        snap.count += shard.count.load(std::memory_order_relaxed);
+        snap.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    return snap;
+}
+
+std::uint64_t Histogram::Snapshot::quantile(double q) const {
+    if (count == 0) return 0;
+    auto rank = static_cast<std::uint64_t>(q * static_cast<double>(count));
+    if (rank >= count) rank = count - 1;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            std::uint64_t lower = i == 0 ? 0 : bucket_upper(i - 1);
+            return lower + (bucket_upper(i) - lower) / 2;
+        }
+    }
+    return bucket_upper(kBuckets - 1);
+}
+
+struct MetricsRegistry::Family {
+    struct Series {
+        std::unique_ptr<Counter> counter;
+        std::unique_ptr<Gauge> gauge;
+        std::unique_ptr<Histogram> histogram;
+    };
+    std::string help;
+    Kind kind;
+    std::map<std::string, Series> series;
+};
+
+MetricsRegistry& MetricsRegistry::get_instance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+MetricsRegistry::Family& MetricsRegistry::family(const std::string& name, const std::string& help, Kind kind) {
+    auto& fam = families_[name];
+    if (!fam) {
+        fam = std::make_unique<Family>();
+        fam->help = help;
+        fam->kind = kind;
+    }
+    return *fam;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = family(name, help, Kind::counter).series[label_key(labels)];
+    if (!series.counter) series.counter = std::make_unique<Counter>();
+    return *series.counter;
+}
+
+// Sampled at scrape time rather than on a timer; resident pages come from
+// the second field of /proc/self/statm.
+void MetricsRegistry::update_process_metrics() {
+    static Gauge& rss = gauge("spectre_process_resident_memory_bytes", "Resident set size of the daemon process.");
+    std::FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (!statm) return;
+    unsigned long size = 0, resident = 0;
+    if (std::fscanf(statm, "%lu %lu", &size, &resident) == 2) {
+        rss.set(static_cast<std::int64_t>(resident) * sysconf(_SC_PAGESIZE));
+    }
+    std::fclose(statm);
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = family(name, help, Kind::gauge).series[label_key(labels)];
+    if (!series.gauge) series.gauge = std::make_unique<Gauge>();
+    return *series.gauge;
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& series = family(name, help, Kind::histogram).series[label_key(labels)];
+    if (!series.histogram) series.histogram = std::make_unique<Histogram>();
+    return *series.histogram;
+}
+
+std::string MetricsRegistry::render_prometheus() {
+    update_process_metrics();
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+    for (const auto& [name, fam] : families_) {
+        static const char* kind_names[] = {"counter", "gauge", "histogram"};
+        out << "# HELP " << name << " " << fam->help << "\n";
+        out << "# TYPE " << name << " " << kind_names[static_cast<int>(fam->kind)] << "\n";
+        for (const auto& [key, series] : fam->series) {
+            if (series.counter) {
+                out << name << braced(key) << " " << series.counter->value() << "\n";
+            } else if (series.gauge) {
+                out << name << braced(key) << " " << series.gauge->value() << "\n";
+            } else if (series.histogram) {
+                // Export only the power-of-two boundaries (16us .. ~268s); they
+                // line up exactly with the internal sub-buckets.
+                auto snap = series.histogram->snapshot();
+                std::uint64_t cumulative = 0;
+                for (std::size_t i = 0; i < Histogram::kBuckets; ++i) {
+                    cumulative += snap.buckets[i];
+                    std::uint64_t upper = Histogram::bucket_upper(i);
+                    if (upper >= 16 && upper <= (1ull << 28) && (upper & (upper - 1)) == 0) {
+                        out << name << "_bucket" << with_label(key, "le=\"" + micros_to_seconds(upper) + "\"")
+                            << " " << cumulative << "\n";
+                    }
+                }
+                out << name << "_bucket" << with_label(key, "le=\"+Inf\"") << " " << snap.count << "\n";
+                out << name << "_sum" << braced(key) << " " << micros_to_seconds(snap.sum) << "\n";
+                out << name << "_count" << braced(key) << " " << snap.count << "\n";
+            }
+        }
+    }
+    return out.str();
+}
+
+} // namespace spectre
@@ -1,15 +1,24 @@
 #include "spectre/network_manager.h"
+#include "spectre/log.h"
 #include <boost/asio.hpp>
-#include <iostream>
+#include <array>
+#include <memory>
 #include <thread>
 
 using boost::asio::ip::udp;
 
 namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("network");
+} // namespace
+
 class NetworkManager::Impl {
     boost::asio::io_context io_;
     udp::socket socket_;
     udp::endpoint broadcast_endpoint_;
+    // Largest possible UDP payload; one buffer is reused for every datagram.
+    std::array<char, 65507> recv_buffer_;
+    udp::endpoint sender_;
     std::thread worker_;
     TaskHandler handler_;
     bool running_ = false;
@@ -22,6 +31,7 @@ public:
         socket_.open(udp::v4());
         socket_.set_option(udp::socket::reuse_address(true));
         socket_.set_option(boost::asio::socket_base::broadcast(true));
+        socket_.set_option(boost::asio::socket_base::receive_buffer_size(1 << 20));
         socket_.bind(udp::endpoint(udp::v4(), 8888));
         
         running_ = true;
@@ -30,42 +40,38 @@ public:
             io_.run(); 
         });
         
-        std::cout << "network: UDP broadcast P2P started on port 8888" << std::endl;
+        logger.info("UDP broadcast P2P started", {{"port", 8888}});
     }
     
     void stop() {
         running_ = false;
         io_.stop();
         if (worker_.joinable()) worker_.join();
-        std::cout << "network: P2P stopped" << std::endl;
+        logger.info("P2P stopped");
     }
     
     void publish_task(const Task& task) {
-        auto data = task.data.dump();
+        // The datagram has to outlive the async send.
+        auto data = std::make_shared<std::string>(task.raw);
         socket_.async_send_to(
-            boost::asio::buffer(data),
+            boost::asio::buffer(*data),
             broadcast_endpoint_,
-            [](boost::system::error_code, std::size_t) {}
+            [data](boost::system::error_code, std::size_t) {}
         );
-        std::cout << "network: broadcasted task: " << data << std::endl;
+        logger.debug("broadcasted task", {{"task", *data}});
     }
     
 private:
     void start_receive() {
-        auto buffer = std::make_shared<std::array<char, 1024>>();
-        auto sender = std::make_shared<udp::endpoint>();
-        
         socket_.async_receive_from(
-            boost::asio::buffer(*buffer),
-            *sender,
-            [this, buffer, sender](boost::system::error_code ec, std::size_t bytes) {
+            boost::asio::buffer(recv_buffer_),
+            sender_,
+            [this](boost::system::error_code ec, std::size_t bytes) {
                 if (!ec && running_) {
                     try {
-                        std::string data(buffer->data(), bytes);
-                        auto json = nlohmann::json::parse(data);
-                        Task task{json};
+                        Task task = parse_task(std::string(recv_buffer_.data(), bytes));
                         handler_(task);
-                        std::cout << "network: received task from " << sender->address() << std::endl;
+                        logger.debug("received task", {{"peer", sender_.address().to_string()}});
                     } catch (...) {}
                     start_receive();
                 }
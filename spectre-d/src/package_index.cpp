@@ -0,0 +1,329 @@
+#include "spectre/package_index.h"
+#include "spectre/http_client.h"
+#include "spectre/log.h"
+#include "spectre/metrics.h"
+#include "spectre/tor_proxy.h"
+#include "spectre/url_utils.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("package_index");
+
+constexpr char kMagic[8] = {'S', 'P', 'K', 'G', 'I', 'D', 'X', '1'};
+constexpr std::uint32_t kBloomHashes = 7;
+// ~1% false positives at 7 hashes.
+constexpr std::uint64_t kBloomBitsPerName = 10;
+constexpr std::size_t kOnlineBatch = 32;
+
+struct Header {
+    char magic[8];
+    std::uint64_t count;
+    std::uint64_t bloom_bits;
+    std::uint32_t bloom_hashes;
+    std::uint32_t reserved;
+    std::uint64_t names_size;
+    std::uint64_t padding[3];
+};
+static_assert(sizeof(Header) == 64);
+
+// Fixed hashes so an index built on one machine reads the same on another.
+std::uint64_t fnv1a(std::string_view s) {
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+std::uint64_t mix(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+template <typename Visit>
+void bloom_positions(std::string_view name, std::uint64_t bits, std::uint32_t hashes, Visit visit) {
+    std::uint64_t h1 = fnv1a(name);
+    std::uint64_t h2 = mix(h1) | 1;
+    for (std::uint32_t i = 0; i < hashes; ++i) visit((h1 + i * h2) % bits);
+}
+
+enum Source { kIndex, kCache, kOnline };
+
+Counter& lookups(Ecosystem ecosystem, Source source) {
+    static Counter* counters[2][3] = {};
+    static std::once_flag resolved;
+    std::call_once(resolved, [] {
+        const char* sources[] = {"index", "cache", "online"};
+        for (Ecosystem e : {Ecosystem::npm, Ecosystem::pypi}) {
+            for (int s = 0; s < 3; ++s) {
+                counters[static_cast<int>(e)][s] = &MetricsRegistry::get_instance().counter(
+                    "spectre_registry_lookups_total", "Package existence checks by where the answer came from.",
+                    {{"ecosystem", ecosystem_name(e)}, {"source", sources[s]}});
+            }
+        }
+    });
+    return *counters[static_cast<int>(ecosystem)][source];
+}
+} // namespace
+
+const char* ecosystem_name(Ecosystem ecosystem) {
+    return ecosystem == Ecosystem::npm ? "npm" : "pypi";
+}
+
+std::string normalize_package_name(Ecosystem ecosystem, std::string_view name) {
+    std::string out;
+    out.reserve(name.size());
+    for (char c : name) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        if (ecosystem == Ecosystem::pypi && (c == '-' || c == '_' || c == '.')) {
+            if (!out.empty() && out.back() == '-') continue;
+            c = '-';
+        }
+        out += c;
+    }
+    return out;
+}
+
+PackageIndex::~PackageIndex() {
+    if (map_) ::munmap(map_, map_size_);
+}
+
+std::unique_ptr<PackageIndex> PackageIndex::open(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+        ::close(fd);
+        return nullptr;
+    }
+    auto size = static_cast<std::size_t>(st.st_size);
+    void* map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return nullptr;
+
+    std::unique_ptr<PackageIndex> index(new PackageIndex());
+    index->map_ = map;
+    index->map_size_ = size;
+    const auto* header = static_cast<const Header*>(map);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->bloom_bits == 0) return nullptr;
+    std::uint64_t bloom_words = (header->bloom_bits + 63) / 64;
+    // Sizes come from the file; check them before any pointer is formed.
+    std::uint64_t fixed = sizeof(Header) / 8 + bloom_words + header->count + 1;
+    if (header->count > size / 8 || bloom_words > size / 8 || fixed > size / 8 ||
+        header->names_size != size - fixed * 8) {
+        logger.warn("ignoring damaged index", {{"path", path}});
+        return nullptr;
+    }
+    const auto* words = static_cast<const std::uint64_t*>(map);
+    index->count_ = header->count;
+    index->bloom_bits_ = header->bloom_bits;
+    index->bloom_hashes_ = header->bloom_hashes;
+    index->bloom_ = words + sizeof(Header) / 8;
+    index->offsets_ = index->bloom_ + bloom_words;
+    index->names_ = reinterpret_cast<const char*>(index->offsets_ + header->count + 1);
+    index->names_size_ = header->names_size;
+    if (index->offsets_[index->count_] != index->names_size_) {
+        logger.warn("ignoring damaged index", {{"path", path}});
+        return nullptr;
+    }
+    ::madvise(map, size, MADV_RANDOM);
+    return index;
+}
+
+bool PackageIndex::build(std::vector<std::string> names, const std::string& path) {
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.count = names.size();
+    header.bloom_bits = std::max<std::uint64_t>(64, names.size() * kBloomBitsPerName);
+    header.bloom_hashes = kBloomHashes;
+    std::vector<std::uint64_t> bloom((header.bloom_bits + 63) / 64);
+    std::vector<std::uint64_t> offsets;
+    offsets.reserve(names.size() + 1);
+    std::uint64_t offset = 0;
+    for (const auto& name : names) {
+        bloom_positions(name, header.bloom_bits, header.bloom_hashes,
+                        [&](std::uint64_t bit) { bloom[bit / 64] |= 1ull << (bit % 64); });
+        offsets.push_back(offset);
+        offset += name.size();
+    }
+    offsets.push_back(offset);
+    header.names_size = offset;
+
+    std::string tmp = path + ".tmp";
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(bloom.data()), static_cast<std::streamsize>(bloom.size() * 8));
+    out.write(reinterpret_cast<const char*>(offsets.data()), static_cast<std::streamsize>(offsets.size() * 8));
+    for (const auto& name : names) out.write(name.data(), static_cast<std::streamsize>(name.size()));
+    out.close();
+    if (!out) return false;
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+std::string_view PackageIndex::name_at(std::size_t i) const {
+    std::uint64_t begin = std::min(offsets_[i], names_size_);
+    std::uint64_t end = std::min(std::max(offsets_[i + 1], begin), names_size_);
+    return {names_ + begin, static_cast<std::size_t>(end - begin)};
+}
+
+bool PackageIndex::maybe_contains(std::string_view name) const {
+    bool all = true;
+    bloom_positions(name, bloom_bits_, bloom_hashes_, [&](std::uint64_t bit) {
+        all = all && (bloom_[bit / 64] >> (bit % 64)) & 1;
+    });
+    return all;
+}
+
+bool PackageIndex::contains(std::string_view normalized) const {
+    if (count_ == 0 || !maybe_contains(normalized)) return false;
+    std::size_t lo = 0, hi = count_;
+    while (lo < hi) {
+        std::size_t mid = lo + (hi - lo) / 2;
+        if (name_at(mid) < normalized) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < count_ && name_at(lo) == normalized;
+}
+
+RegistryLookup& RegistryLookup::get_instance() {
+    static RegistryLookup instance;
+    return instance;
+}
+
+RegistryLookup::RegistryLookup() {
+    if (const char* size = std::getenv("SPECTRE_PACKAGE_CACHE_SIZE")) {
+        cache_capacity_ = std::max<std::size_t>(1, std::strtoull(size, nullptr, 10));
+    }
+}
+
+const bool* RegistryLookup::cached(AnswerCache& cache, const std::string& key) {
+    auto it = cache.entries.find(key);
+    if (it == cache.entries.end()) return nullptr;
+    cache.order.splice(cache.order.begin(), cache.order, it->second);
+    return &it->second->second;
+}
+
+void RegistryLookup::remember(AnswerCache& cache, std::string key, bool found) {
+    if (auto it = cache.entries.find(key); it != cache.entries.end()) {
+        it->second->second = found;
+        cache.order.splice(cache.order.begin(), cache.order, it->second);
+        return;
+    }
+    cache.order.emplace_front(std::move(key), found);
+    cache.entries.emplace(cache.order.front().first, cache.order.begin());
+    if (cache.order.size() > cache_capacity_) {
+        cache.entries.erase(cache.order.back().first);
+        cache.order.pop_back();
+    }
+}
+
+const PackageIndex* RegistryLookup::index(Ecosystem ecosystem) {
+    std::call_once(loaded_, [this] {
+        const char* dir = std::getenv("SPECTRE_PACKAGE_INDEX_DIR");
+        std::string base = dir ? dir : "package-index";
+        for (Ecosystem e : {Ecosystem::npm, Ecosystem::pypi}) {
+            std::string path = base + "/" + ecosystem_name(e) + ".idx";
+            auto& slot = indexes_[static_cast<int>(e)];
+            slot = PackageIndex::open(path);
+            if (slot) {
+                logger.info("loaded package index", {{"path", path}, {"names", slot->size()}});
+            } else {
+                logger.info("no package index, checking the registry online", {{"path", path}});
+            }
+        }
+    });
+    return indexes_[static_cast<int>(ecosystem)].get();
+}
+
+std::string RegistryLookup::registry_url(Ecosystem ecosystem, std::string_view name) const {
+    // Names come from the target's manifests, so everything but unreserved
+    // characters is escaped; a name of dots would otherwise walk the path.
+    auto segment = [](std::string_view part) -> std::string {
+        if (part == ".") return "%2E";
+        if (part == "..") return "%2E%2E";
+        return std::string(url_encode(part));
+    };
+    if (ecosystem == Ecosystem::pypi) return "https://pypi.org/pypi/" + segment(name) + "/json";
+    // Scoped packages are fetched as @scope%2Fname.
+    if (!name.empty() && name.front() == '@') return "https://registry.npmjs.org/@" + segment(name.substr(1));
+    return "https://registry.npmjs.org/" + segment(name);
+}
+
+RegistryLookup::Presence RegistryLookup::exists(Ecosystem ecosystem, std::string_view name) {
+    return exists(ecosystem, std::vector<std::string>{std::string(name)}).front();
+}
+
+std::vector<RegistryLookup::Presence> RegistryLookup::exists(Ecosystem ecosystem,
+                                                             const std::vector<std::string>& names) {
+    std::vector<Presence> out(names.size(), Presence::unknown);
+    std::vector<std::size_t> online;
+    const PackageIndex* snapshot = index(ecosystem);
+    auto& cache = cache_[static_cast<int>(ecosystem)];
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        for (std::size_t i = 0; i < names.size(); ++i) {
+            std::string key = normalize_package_name(ecosystem, names[i]);
+            if (snapshot) {
+                out[i] = snapshot->contains(key) ? Presence::present : Presence::absent;
+                lookups(ecosystem, kIndex).inc();
+            } else if (const bool* found = cached(cache, key)) {
+                out[i] = *found ? Presence::present : Presence::absent;
+                lookups(ecosystem, kCache).inc();
+            } else {
+                online.push_back(i);
+            }
+        }
+    }
+
+    bool use_tor = !online.empty() && TorProxy::get_instance().is_available();
+    for (std::size_t first = 0; first < online.size(); first += kOnlineBatch) {
+        std::size_t last = std::min(online.size(), first + kOnlineBatch);
+        std::deque<cpr::Session> sessions;
+        std::vector<cpr::Session*> batch;
+        for (std::size_t k = first; k < last; ++k) {
+            cpr::Session& session = sessions.emplace_back();
+            HttpClient::get_instance().set_url(session, registry_url(ecosystem, names[online[k]]));
+            session.SetTimeout(cpr::Timeout{10000});
+            if (use_tor) {
+                session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
+                                    {"https", "socks5://127.0.0.1:9050"}});
+            }
+            batch.push_back(&session);
+        }
+        auto responses = HttpClient::get_instance().get_all(batch);
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        for (std::size_t k = first; k < last; ++k) {
+            const auto& r = responses[k - first];
+            lookups(ecosystem, kOnline).inc();
+            // Anything but a clear yes or no is asked again next time.
+            if (r.status_code != 200 && r.status_code != 404) continue;
+            bool found = r.status_code == 200;
+            out[online[k]] = found ? Presence::present : Presence::absent;
+            remember(cache, normalize_package_name(ecosystem, names[online[k]]), found);
+        }
+    }
+    return out;
+}
+
+} // namespace spectre
@@ -0,0 +1,228 @@
+#include "spectre/path_probe.h"
+#include "spectre/http_client.h"
+#include "spectre/log.h"
+#include "spectre/matchers.h"
+#include "spectre/metrics.h"
+#include "spectre/tor_proxy.h"
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+
+namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("path_probe");
+
+std::chrono::seconds result_ttl() {
+    static const std::chrono::seconds ttl{[] {
+        const char* value = std::getenv("SPECTRE_PATH_PROBE_TTL_S");
+        return value ? std::strtol(value, nullptr, 10) : 60L;
+    }()};
+    return ttl;
+}
+
+Counter& lookups(const char* source) {
+    return MetricsRegistry::get_instance().counter("spectre_path_probe_lookups_total",
+                                                   "Path probe results by where they came from.",
+                                                   {{"source", source}});
+}
+
+Counter& requests(const char* result) {
+    return MetricsRegistry::get_instance().counter("spectre_path_probe_requests_total",
+                                                   "Well-known path requests by outcome.", {{"result", result}});
+}
+} // namespace
+
+struct PathProbe::Compiled {
+    struct Entry {
+        std::string owner;
+        ProbePath path;
+        // Indexes into signatures.
+        std::vector<std::size_t> signature_ids;
+    };
+
+    Compiled(std::uint64_t generation, const std::map<int, Registration>& registrations)
+        : generation(generation), matcher(collect(registrations, entries, signatures)) {}
+
+    static const std::vector<std::string>& collect(const std::map<int, Registration>& registrations,
+                                                   std::vector<Entry>& entries, std::vector<std::string>& signatures) {
+        std::map<std::string, const std::vector<ProbePath>*> latest;
+        for (const auto& [id, registration] : registrations) latest[registration.owner] = &registration.paths;
+        for (const auto& [owner, paths] : latest) {
+            for (const auto& path : *paths) {
+                Entry entry{owner, path, {}};
+                for (const auto& signature : path.signatures) {
+                    auto it = std::find(signatures.begin(), signatures.end(), signature);
+                    entry.signature_ids.push_back(static_cast<std::size_t>(it - signatures.begin()));
+                    if (it == signatures.end()) signatures.push_back(signature);
+                }
+                entries.push_back(std::move(entry));
+            }
+        }
+        return signatures;
+    }
+
+    bool owns_any(const std::string& owner) const {
+        return std::any_of(entries.begin(), entries.end(), [&](const Entry& e) { return e.owner == owner; });
+    }
+
+    std::uint64_t generation;
+    std::vector<Entry> entries;
+    std::vector<std::string> signatures;
+    MultiPatternMatcher matcher;
+};
+
+PathProbe& PathProbe::get_instance() {
+    static PathProbe instance;
+    return instance;
+}
+
+int PathProbe::register_paths(const std::string& owner, std::vector<ProbePath> paths) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int id = ++next_id_;
+    registrations_[id] = {owner, std::move(paths)};
+    ++generation_;
+    compiled_.reset();
+    return id;
+}
+
+void PathProbe::unregister(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (registrations_.erase(id)) {
+        ++generation_;
+        compiled_.reset();
+    }
+}
+
+std::shared_ptr<const PathProbe::Compiled> PathProbe::compiled() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!compiled_) compiled_ = std::make_shared<const Compiled>(generation_, registrations_);
+    return compiled_;
+}
+
+std::vector<ProbeHit> PathProbe::hits(const std::string& base, const std::string& owner) {
+    auto paths = compiled();
+    if (!paths->owns_any(owner)) return {};
+
+    std::shared_future<ResultPtr> pending;
+    std::promise<ResultPtr> promise;
+    bool leader = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto now = std::chrono::steady_clock::now();
+        if (auto it = results_.find(base);
+            it != results_.end() && it->second->generation == paths->generation && now < it->second->expires) {
+            lookups("cache").inc();
+            auto found = it->second->hits.find(owner);
+            return found == it->second->hits.end() ? std::vector<ProbeHit>{} : found->second;
+        }
+        if (auto it = inflight_.find(base); it != inflight_.end()) {
+            lookups("coalesced").inc();
+            pending = it->second;
+        } else {
+            lookups("network").inc();
+            pending = promise.get_future().share();
+            inflight_[base] = pending;
+            leader = true;
+        }
+    }
+
+    if (leader) {
+        ResultPtr result;
+        try {
+            result = probe(base, *paths);
+        } catch (const std::exception& ex) {
+            logger.error("path probe failed", {{"base", base}, {"error", ex.what()}});
+            auto empty = std::make_shared<Result>();
+            empty->generation = paths->generation;
+            result = std::move(empty);
+        } catch (...) {
+            // Nothing to cache, but waiters must not block on the promise
+            // forever; they get the same exception.
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                inflight_.erase(base);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto now = std::chrono::steady_clock::now();
+            std::erase_if(results_, [&](const auto& entry) { return entry.second->expires <= now; });
+            results_[base] = result;
+            inflight_.erase(base);
+        }
+        promise.set_value(result);
+    }
+
+    ResultPtr result = pending.get();
+    auto found = result->hits.find(owner);
+    return found == result->hits.end() ? std::vector<ProbeHit>{} : found->second;
+}
+
+PathProbe::ResultPtr PathProbe::probe(const std::string& base, const Compiled& compiled) {
+    auto& client = HttpClient::get_instance();
+    bool use_tor = TorProxy::get_instance().is_available();
+    std::deque<cpr::Session> sessions;
+    std::vector<cpr::Session*> batch;
+    std::vector<HttpClient::Method> methods;
+    for (const auto& entry : compiled.entries) {
+        cpr::Session& session = sessions.emplace_back();
+        client.set_url(session, base + entry.path.path);
+        session.SetTimeout(cpr::Timeout{10000});
+        std::size_t fetch = entry.path.fetch;
+        if (fetch != 0 && fetch != ProbePath::kWholeBody) {
+            session.SetHeader({{"Range", "bytes=0-" + std::to_string(fetch - 1)}});
+        }
+        if (use_tor) {
+            session.SetProxies({{"http", "socks5://127.0.0.1:9050"},
+                                {"https", "socks5://127.0.0.1:9050"}});
+        }
+        batch.push_back(&session);
+        methods.push_back(fetch == 0 ? HttpClient::Method::head : HttpClient::Method::get);
+    }
+    auto responses = client.send_all(batch, methods);
+
+    auto result = std::make_shared<Result>();
+    result->generation = compiled.generation;
+    result->expires = std::chrono::steady_clock::now() + result_ttl();
+    std::size_t hit_count = 0;
+    for (std::size_t i = 0; i < responses.size(); ++i) {
+        const auto& entry = compiled.entries[i];
+        auto& r = responses[i];
+        if (r.status_code == 0) {
+            requests("error").inc();
+            continue;
+        }
+        if (r.status_code < 200 || r.status_code >= 300) {
+            requests("miss").inc();
+            continue;
+        }
+        // Servers that ignore Range send the whole file.
+        if (entry.path.fetch != ProbePath::kWholeBody && r.text.size() > entry.path.fetch) {
+            r.text.resize(entry.path.fetch);
+        }
+        std::string signature;
+        if (!entry.signature_ids.empty()) {
+            for (std::size_t id : compiled.matcher.find_all(r.text)) {
+                if (std::find(entry.signature_ids.begin(), entry.signature_ids.end(), id) !=
+                    entry.signature_ids.end()) {
+                    signature = compiled.signatures[id];
+                    break;
+                }
+            }
+            if (signature.empty()) {
+                requests("miss").inc();
+                continue;
+            }
+        }
+        requests("hit").inc();
+        ++hit_count;
+        result->hits[entry.owner].push_back(
+            {base + entry.path.path, entry.path.path, r.status_code, std::move(r.text), std::move(signature)});
+    }
+    logger.debug("probed well-known paths", {{"base", base}, {"paths", compiled.entries.size()}, {"hits", hit_count}});
+    return result;
+}
+
+} // namespace spectre
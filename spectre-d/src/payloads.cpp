@@ -0,0 +1,18 @@
+#include "spectre/payloads.h"
+#include <fstream>
+
+namespace spectre {
+
+std::vector<std::string> load_payload_file(const std::string& path) {
+    std::vector<std::string> payloads;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty()) {
+            payloads.push_back(line);
+        }
+    }
+    return payloads;
+}
+
+} // namespace spectre
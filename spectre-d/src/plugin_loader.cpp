@@ -1,64 +1,240 @@
 #include "spectre/plugin_loader.h"
+#include "spectre/log.h"
+#include "spectre/metrics.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
+#include <future>
 #include <dlfcn.h>
-#include <iostream>
-#include <cstdlib>
+#include <poll.h>
 #include <set>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
 namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("plugin_loader");
+
+Counter& reloads(const char* result) {
+    return MetricsRegistry::get_instance().counter("spectre_plugin_reloads_total",
+                                                   "Plugin libraries picked up by the directory watch.",
+                                                   {{"result", result}});
+}
+
+bool is_library(const fs::path& path) {
+    auto ext = path.extension();
+    return ext == ".so" || ext == ".dll" || ext == ".dylib";
+}
+
+// A fresh 0700 directory only this user can write to, under
+// XDG_RUNTIME_DIR when there is one. Empty on failure.
+std::string make_shadow_dir() {
+    std::error_code ec;
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    fs::path base = runtime && *runtime ? fs::path(runtime) : fs::temp_directory_path(ec);
+    if (base.empty()) base = "/tmp";
+    std::string templ = (base / "spectre-plugins-XXXXXX").string();
+    if (!::mkdtemp(templ.data())) {
+        logger.error("could not create plugin shadow directory", {{"base", base.string()}, {"error", std::strerror(errno)}});
+        return "";
+    }
+    struct stat st{};
+    if (::lstat(templ.c_str(), &st) != 0 || !S_ISDIR(st.st_mode) || st.st_uid != ::geteuid() ||
+        (st.st_mode & 077) != 0) {
+        logger.error("plugin shadow directory is not private", {{"path", templ}});
+        return "";
+    }
+    return templ;
+}
+} // namespace
+
 namespace {
 using create_fn = Plugin* (*)();
 }
-PluginLoader::PluginLoader(const std::string& directory) : dir(directory) {}
+PluginLoader::PluginLoader(const std::string& directory) : dir(directory) {
+    shadow_dir_ = make_shadow_dir();
+}
+
+PluginLoader::~PluginLoader() {
+    stop_watching();
+    if (!shadow_dir_.empty()) {
+        std::error_code ec;
+        fs::remove_all(shadow_dir_, ec);
+    }
+}
+
 std::vector<std::shared_ptr<Plugin>> PluginLoader::load_all() {
+    std::vector<std::string> paths;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (entry.is_regular_file() && is_library(entry.path())) paths.push_back(entry.path().string());
+    }
+    // Sorted so the first of two libraries claiming one name wins on every start.
+    std::sort(paths.begin(), paths.end());
+
+    // dlopen serialises on the loader lock, but copying the files and running
+    // the plugin constructors overlap.
+    std::vector<std::future<std::shared_ptr<Plugin>>> loading;
+    for (const auto& path : paths) {
+        loading.push_back(std::async(std::launch::async, [this, path] { return load(path); }));
+    }
+
     std::vector<std::shared_ptr<Plugin>> out;
     std::set<std::string> names;
-    bool debug = std::getenv("SPECTRE_DEBUG") != nullptr;
-    for (const auto& entry : fs::directory_iterator(dir)) {
-        if (!entry.is_regular_file()) continue;
-        auto ext = entry.path().extension();
-        if (ext != ".so" && ext != ".dll" && ext != ".dylib") continue;
-        if(debug) std::cout << "[plugin_loader] loading " << entry.path() << std::endl;
-        void* handle = dlopen(entry.path().c_str(), RTLD_NOW);
-        if (!handle) {
-            std::cerr << "[plugin_loader] dlopen failed for " << entry.path() << ": " << dlerror() << std::endl;
-            continue;
-        }
-        auto sym = reinterpret_cast<create_fn>(dlsym(handle, "spectre_create_plugin"));
-        if (!sym) {
-            std::cerr << "[plugin_loader] dlsym failed for " << entry.path() << ": " << dlerror() << std::endl;
-            dlclose(handle);
-            continue;
-        }
-        Plugin* raw = nullptr;
-        try {
-            raw = sym();
-        } catch (const std::exception& ex) {
-            std::cerr << "[plugin_loader] plugin ctor threw for " << entry.path() << ": " << ex.what() << std::endl;
-        } catch (...) {
-            std::cerr << "[plugin_loader] plugin ctor threw (unknown) for " << entry.path() << std::endl;
-        }
-        if (!raw) {
-            dlclose(handle);
-            continue;
-        }
+    for (auto& pending : loading) {
+        auto plugin = pending.get();
+        if (!plugin) continue;
         std::string pname;
-        try { pname = raw->name(); } catch (...) { pname = "<unknown>"; }
+        try { pname = plugin->name(); } catch (...) { pname = "<unknown>"; }
         if (!names.insert(pname).second) {
-            std::cerr << "[plugin_loader] duplicate plugin name: " << pname << " (skipping)" << std::endl;
-            delete raw;
-            dlclose(handle);
+            logger.warn("duplicate plugin name, skipping", {{"plugin", pname}});
             continue;
         }
-        auto deleter = [handle](Plugin* p) {
-            delete p;
-            dlclose(handle);
-        };
-        out.emplace_back(raw, deleter);
+        out.push_back(std::move(plugin));
     }
     return out;
 }
-} // namespace spectre 
\ No newline at end of file
+
+std::shared_ptr<Plugin> PluginLoader::load(const std::string& path) {
+    logger.debug("loading", {{"path", path}});
+    fs::path source(path);
+    if (isolator_ && (isolated_files_.count("all") || isolated_files_.count(source.filename().string()) ||
+                      isolated_files_.count(source.stem().string()))) {
+        auto plugin = isolator_(path);
+        if (!plugin) return nullptr;
+        std::string pname = plugin->name();
+        if (intern_task_type(pname) == kNoTaskType) {
+            logger.error("plugin name cannot be registered as a task type", {{"path", path}, {"plugin", pname}});
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(names_mutex_);
+        names_by_file_[source.filename().string()] = pname;
+        return plugin;
+    }
+    // dlopen hands back the already-loaded image for a path it has seen, so
+    // every load goes through a uniquely named copy. The copy is unlinked
+    // once mapped.
+    if (shadow_dir_.empty()) {
+        logger.error("no private directory to load plugins from", {{"path", path}});
+        return nullptr;
+    }
+    std::error_code ec;
+    fs::path shadow = fs::path(shadow_dir_) /
+                      (source.stem().string() + "." + std::to_string(generation_.fetch_add(1)) + source.extension().string());
+    // Names are unique per load, so an existing file means tampering.
+    if (!fs::copy_file(source, shadow, fs::copy_options::none, ec)) {
+        logger.error("could not copy plugin", {{"path", path}, {"error", ec.message()}});
+        return nullptr;
+    }
+    void* handle = dlopen(shadow.c_str(), RTLD_NOW);
+    fs::remove(shadow, ec);
+    if (!handle) {
+        logger.error("dlopen failed", {{"path", path}, {"error", dlerror()}});
+        return nullptr;
+    }
+    auto sym = reinterpret_cast<create_fn>(dlsym(handle, "spectre_create_plugin"));
+    if (!sym) {
+        logger.error("dlsym failed", {{"path", path}, {"error", dlerror()}});
+        dlclose(handle);
+        return nullptr;
+    }
+    Plugin* raw = nullptr;
+    try {
+        raw = sym();
+    } catch (const std::exception& ex) {
+        logger.error("plugin ctor threw", {{"path", path}, {"error", ex.what()}});
+    } catch (...) {
+        logger.error("plugin ctor threw unknown exception", {{"path", path}});
+    }
+    if (!raw) {
+        dlclose(handle);
+        return nullptr;
+    }
+    std::string pname;
+    try { pname = raw->name(); } catch (...) { pname = "<unknown>"; }
+    // Tasks are routed by interned type, so a plugin whose name cannot be
+    // interned (empty, or the table is full) would never receive one.
+    if (intern_task_type(pname) == kNoTaskType) {
+        logger.error("plugin name cannot be registered as a task type", {{"path", path}, {"plugin", pname}});
+        delete raw;
+        dlclose(handle);
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(names_mutex_);
+        names_by_file_[source.filename().string()] = pname;
+    }
+    auto deleter = [handle, pname](Plugin* p) {
+        delete p;
+        dlclose(handle);
+        logger.debug("unloaded", {{"plugin", pname}});
+    };
+    return std::shared_ptr<Plugin>(raw, deleter);
+}
+
+void PluginLoader::isolate(std::set<std::string> files, Isolator isolator) {
+    isolated_files_ = std::move(files);
+    isolator_ = std::move(isolator);
+}
+
+void PluginLoader::watch(LoadedHandler on_loaded, RemovedHandler on_removed) {
+    if (watching_.exchange(true)) return;
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) < 0) {
+        logger.error("cannot watch plugin directory", {{"dir", dir}});
+        if (fd >= 0) ::close(fd);
+        watching_ = false;
+        return;
+    }
+    watch_thread_ = std::thread(&PluginLoader::watch_loop, this, fd, std::move(on_loaded), std::move(on_removed));
+    logger.info("watching plugin directory", {{"dir", dir}});
+}
+
+void PluginLoader::stop_watching() {
+    watching_ = false;
+    if (watch_thread_.joinable()) watch_thread_.join();
+}
+
+void PluginLoader::watch_loop(int fd, LoadedHandler on_loaded, RemovedHandler on_removed) {
+    alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+    while (watching_) {
+        pollfd pfd{fd, POLLIN, 0};
+        if (::poll(&pfd, 1, 500) <= 0) continue;
+        ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        for (char* p = buffer; n > 0 && p < buffer + n;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            if (event->len == 0) continue;
+            fs::path file = fs::path(dir) / event->name;
+            if (!is_library(file)) continue;
+
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                auto plugin = load(file.string());
+                if (!plugin) {
+                    reloads("failed").inc();
+                    continue;
+                }
+                reloads("loaded").inc();
+                on_loaded(std::move(plugin));
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                std::string name;
+                {
+                    std::lock_guard<std::mutex> lock(names_mutex_);
+                    auto it = names_by_file_.find(file.filename().string());
+                    if (it == names_by_file_.end()) continue;
+                    name = std::move(it->second);
+                    names_by_file_.erase(it);
+                }
+                reloads("removed").inc();
+                on_removed(name);
+            }
+        }
+    }
+    ::close(fd);
+}
+} // namespace spectre
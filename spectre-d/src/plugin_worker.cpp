@@ -0,0 +1,876 @@
+#include "spectre/plugin_worker.h"
+#include "spectre/canary_monitor.h"
+#include "spectre/checkpoint.h"
+#include "spectre/log.h"
+#include "spectre/metrics.h"
+#include "spectre/plugin_loader.h"
+#include "spectre/proof_queue.h"
+#include "spectre/resource_usage.h"
+#include "spectre/scan_registry.h"
+#include "spectre/shm_ring.h"
+#include "spectre/task_memory.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("plugin_worker");
+
+// The shared mapping is handed to the child as this descriptor.
+constexpr int kShmFd = 3;
+constexpr auto kPollInterval = std::chrono::milliseconds(100);
+constexpr auto kSendTimeout = std::chrono::seconds(5);
+constexpr auto kProgressInterval = std::chrono::milliseconds(250);
+constexpr auto kReadyTimeout = std::chrono::seconds(30);
+
+enum class Msg : char {
+    task = 'T',      // daemon -> worker: id length, id, raw task JSON
+    quit = 'Q',      // daemon -> worker
+    ready = 'R',     // worker -> daemon: plugin loaded and warmed up
+    started = 'B',   // worker -> daemon: a task thread picked the task up
+    proof = 'P',     // worker -> daemon: proof JSON
+    progress = 'S',  // worker -> daemon: scan counters so far
+    done = 'D',      // worker -> daemon: '1' or '0', ResourceUsage, then the error text
+    canary = 'C',    // daemon -> worker: what the daemon's canary listener saw
+    output = 'O',    // worker -> daemon: {"scan", "kind", "value"} from scan_output()
+    interrupt = 'I', // daemon -> worker: shutting down, stop tasks at their next checkpoint
+};
+
+// Every message is a kind byte, the task's sequence number and a payload.
+std::string frame(Msg kind, std::uint64_t seq, std::string_view payload) {
+    std::string out(1 + sizeof(seq) + payload.size(), '\0');
+    out[0] = static_cast<char>(kind);
+    std::memcpy(out.data() + 1, &seq, sizeof(seq));
+    if (!payload.empty()) std::memcpy(out.data() + 1 + sizeof(seq), payload.data(), payload.size());
+    return out;
+}
+
+bool unframe(std::string_view msg, Msg& kind, std::uint64_t& seq, std::string_view& payload) {
+    if (msg.size() < 1 + sizeof(seq)) return false;
+    kind = static_cast<Msg>(msg[0]);
+    std::memcpy(&seq, msg.data() + 1, sizeof(seq));
+    payload = msg.substr(1 + sizeof(seq));
+    return true;
+}
+
+// requests_sent, payloads_total, payloads_done, findings.
+using Counters = std::array<std::uint64_t, 4>;
+
+std::string encode(const ScanProgress& progress) {
+    Counters c{progress.requests_sent.load(std::memory_order_relaxed),
+               progress.payloads_total.load(std::memory_order_relaxed),
+               progress.payloads_done.load(std::memory_order_relaxed),
+               progress.findings.load(std::memory_order_relaxed)};
+    return std::string(reinterpret_cast<const char*>(c.data()), sizeof(c));
+}
+
+std::size_t shm_bytes(std::size_t ring_bytes) {
+    return 2 * ShmRing::region_size(ring_bytes);
+}
+
+Counter& restarts(const std::string& plugin) {
+    return MetricsRegistry::get_instance().counter("spectre_plugin_worker_restarts_total",
+                                                   "Plugin worker processes restarted after exiting.",
+                                                   {{"plugin", plugin}});
+}
+
+std::atomic<std::size_t> next_cpu{0};
+
+// ---- daemon side ----
+
+struct Pending {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    bool ok = false;
+    std::string error;
+    std::shared_ptr<ScanProgress> progress;
+    // What the task cost inside the worker, from its done message.
+    ResourceUsage usage;
+    // Last counters the worker reported; only the reader thread touches it.
+    Counters reported{};
+    // When a worker thread began the task; unset while it waits in the
+    // worker's queue, which does not count against task_timeout.
+    std::chrono::steady_clock::time_point started{};
+
+    void finish(bool success, std::string why) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            ok = success;
+            error = std::move(why);
+        }
+        cv.notify_all();
+    }
+};
+
+// One incarnation of a worker process and the mapping holding its rings.
+struct Worker {
+    pid_t pid = -1;
+    void* shm = MAP_FAILED;
+    std::size_t shm_size = 0;
+    ShmRing to_worker;
+    ShmRing from_worker;
+    std::mutex send_mutex;
+    std::mutex pending_mutex;
+    std::unordered_map<std::uint64_t, std::shared_ptr<Pending>> pending;
+    std::atomic<bool> alive{true};
+    std::atomic<bool> ready{false};
+    bool killed = false;
+    std::thread reader;
+    std::chrono::steady_clock::time_point spawned = std::chrono::steady_clock::now();
+
+    ~Worker() {
+        if (shm != MAP_FAILED) ::munmap(shm, shm_size);
+    }
+};
+
+// Starts a worker process for `library` with empty rings; `label` names it
+// in logs until the plugin's own name is known. The caller starts its reader.
+std::shared_ptr<Worker> launch_worker(const std::string& library, const std::string& label,
+                                      const WorkerOptions& options, int cpu) {
+    int fd = ::memfd_create(("spectre-worker-" + label).c_str(), MFD_CLOEXEC);
+    if (fd < 0) {
+        logger.error("memfd_create failed", {{"plugin", label}, {"error", std::strerror(errno)}});
+        return nullptr;
+    }
+    if (fd == kShmFd) {
+        int moved = ::fcntl(fd, F_DUPFD_CLOEXEC, kShmFd + 1);
+        ::close(fd);
+        fd = moved;
+    }
+    auto w = std::make_shared<Worker>();
+    w->shm_size = shm_bytes(options.ring_bytes);
+    if (fd < 0 || ::ftruncate(fd, static_cast<off_t>(w->shm_size)) != 0 ||
+        (w->shm = ::mmap(nullptr, w->shm_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        logger.error("could not map worker rings", {{"plugin", label}, {"error", std::strerror(errno)}});
+        if (fd >= 0) ::close(fd);
+        return nullptr;
+    }
+    auto* base = static_cast<unsigned char*>(w->shm);
+    w->to_worker = ShmRing::create(base, options.ring_bytes);
+    w->from_worker = ShmRing::create(base + ShmRing::region_size(options.ring_bytes), options.ring_bytes);
+    // A worker started during shutdown (a restart, say) missed the
+    // broadcast; its first message tells it before any task arrives.
+    if (CheckpointStore::get_instance().interrupted()) w->to_worker.try_push(frame(Msg::interrupt, 0, {}));
+
+    std::vector<std::string> args{"spectre-d", "--worker", library,
+                                  "--ring-bytes", std::to_string(options.ring_bytes),
+                                  "--threads", std::to_string(options.threads),
+                                  "--cpu", std::to_string(cpu),
+                                  "--parent", std::to_string(::getpid())};
+    std::vector<char*> argv;
+    for (auto& a : args) argv.push_back(a.data());
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fd, kShmFd);
+    // Own process group, so a terminal's Ctrl-C reaches only the daemon,
+    // which then shuts the workers down in order.
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+    pid_t pid = -1;
+    int rc = ::posix_spawn(&pid, "/proc/self/exe", &actions, &attr, argv.data(), environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    ::close(fd);
+    if (rc != 0) {
+        logger.error("could not start worker", {{"plugin", label}, {"error", std::strerror(rc)}});
+        return nullptr;
+    }
+    w->pid = pid;
+    logger.info("worker started", {{"plugin", label}, {"pid", pid}, {"cpu", cpu}});
+    return w;
+}
+
+// Name of the plugin a freshly launched worker loaded, from its ready
+// message. Empty, with the process gone, if it exits or stays silent for
+// `timeout`. Only for a worker whose reader has not been started.
+std::string await_name(Worker& w, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::string msg;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (w.from_worker.pop(msg, kPollInterval)) {
+            Msg kind;
+            std::uint64_t seq;
+            std::string_view payload;
+            if (unframe(msg, kind, seq, payload) && kind == Msg::ready && !payload.empty()) {
+                w.ready = true;
+                return std::string(payload);
+            }
+            continue;
+        }
+        if (::waitpid(w.pid, nullptr, WNOHANG) == w.pid) return "";
+    }
+    ::kill(w.pid, SIGKILL);
+    ::waitpid(w.pid, nullptr, 0);
+    return "";
+}
+
+class IsolatedPlugin : public Plugin {
+public:
+    // `first` is the worker that reported `name`, already running on `first_cpu`.
+    IsolatedPlugin(std::string library, std::string name, WorkerOptions options, std::shared_ptr<Worker> first,
+                   int first_cpu)
+        : library_(std::move(library)), name_(std::move(name)), type_(intern_task_type(name_)),
+          options_(std::move(options)) {
+        // Registered before the other workers exist: spawn() and broadcast()
+        // both run under slots_mutex_, so every worker either is in the slots
+        // when the interrupt is broadcast or starts with it already queued.
+        interrupt_observer_ = CheckpointStore::get_instance().add_interrupt_observer(
+            [this] { broadcast(Msg::interrupt, {}, true); });
+        slots_.resize(std::max<std::size_t>(1, options_.processes));
+        {
+            std::lock_guard<std::mutex> lock(slots_mutex_);
+            slots_[0].cpu = first_cpu;
+            slots_[0].worker = std::move(first);
+            start_reader(*slots_[0].worker);
+            // The first worker was launched before the observer existed.
+            if (CheckpointStore::get_instance().interrupted()) {
+                slots_[0].worker->to_worker.try_push(frame(Msg::interrupt, 0, {}));
+            }
+            for (std::size_t i = 1; i < slots_.size(); ++i) {
+                auto& slot = slots_[i];
+                if (!options_.cpus.empty()) slot.cpu = options_.cpus[next_cpu.fetch_add(1) % options_.cpus.size()];
+                slot.worker = spawn(slot.cpu);
+            }
+        }
+        supervisor_ = std::thread(&IsolatedPlugin::supervise, this);
+        // Workers wait on canaries they issued themselves, but only the
+        // daemon's listener sees the callbacks.
+        canary_observer_ = CanaryMonitor::get_instance().add_callback_observer(
+            [this](const std::string& seen) { forward_canary(seen); });
+    }
+
+    ~IsolatedPlugin() override {
+        CanaryMonitor::get_instance().remove_callback_observer(canary_observer_);
+        CheckpointStore::get_instance().remove_interrupt_observer(interrupt_observer_);
+        {
+            std::lock_guard<std::mutex> lock(slots_mutex_);
+            running_ = false;
+        }
+        slots_cv_.notify_all();
+        if (supervisor_.joinable()) supervisor_.join();
+
+        std::vector<std::shared_ptr<Worker>> workers;
+        for (auto& slot : slots_) {
+            if (!slot.worker) continue;
+            std::lock_guard<std::mutex> lock(slot.worker->send_mutex);
+            slot.worker->to_worker.push(frame(Msg::quit, 0, {}), kPollInterval);
+            workers.push_back(std::move(slot.worker));
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        for (auto& w : workers) {
+            while (::waitpid(w->pid, nullptr, WNOHANG) == 0) {
+                if (std::chrono::steady_clock::now() >= deadline) {
+                    ::kill(w->pid, SIGKILL);
+                    ::waitpid(w->pid, nullptr, 0);
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            retire(w, "stopped");
+        }
+    }
+
+    std::string name() const override { return name_; }
+
+    // Waits for the workers started with the plugin to load it.
+    void warm_up() override {
+        std::unique_lock<std::mutex> lock(slots_mutex_);
+        bool ready = slots_cv_.wait_for(lock, kReadyTimeout, [this] {
+            return std::all_of(slots_.begin(), slots_.end(),
+                               [](const Slot& s) { return s.worker && s.worker->ready.load(); });
+        });
+        if (!ready) logger.warn("workers not ready after 30s", {{"plugin", name_}});
+    }
+
+    void handle_task(const Task& task) override {
+        if (task.type != type_) return;
+        auto worker = pick();
+        auto pending = std::make_shared<Pending>();
+        pending->progress = current_scan_progress();
+        std::uint64_t seq = next_seq_.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(worker->pending_mutex);
+            // retire() empties the map after clearing alive, so checking here
+            // means nobody can be left waiting on a dead worker.
+            if (!worker->alive) throw std::runtime_error("worker exited before the task was sent");
+            worker->pending.emplace(seq, pending);
+        }
+
+        auto id_len = static_cast<std::uint32_t>(task.id.size());
+        std::string payload(reinterpret_cast<const char*>(&id_len), sizeof(id_len));
+        payload += task.id;
+        payload += task.raw;
+        bool sent;
+        {
+            std::lock_guard<std::mutex> lock(worker->send_mutex);
+            sent = worker->to_worker.push(frame(Msg::task, seq, payload), kSendTimeout);
+        }
+        if (!sent) {
+            std::lock_guard<std::mutex> lock(worker->pending_mutex);
+            worker->pending.erase(seq);
+            throw std::runtime_error("could not queue task for worker");
+        }
+
+        std::unique_lock<std::mutex> lock(pending->mutex);
+        pending->cv.wait(lock, [&] { return pending->done; });
+        usage_record_remote(pending->usage);
+        if (!pending->ok && pending->error == ScanInterrupted::kMessage) throw ScanInterrupted();
+        if (!pending->ok) throw std::runtime_error(pending->error);
+    }
+
+private:
+    struct Slot {
+        std::shared_ptr<Worker> worker;
+        int cpu = -1;
+        int failures = 0;
+        std::chrono::steady_clock::time_point restart_at{};
+    };
+
+    std::shared_ptr<Worker> spawn(int cpu) {
+        auto w = launch_worker(library_, name_, options_, cpu);
+        if (w) start_reader(*w);
+        return w;
+    }
+
+    void start_reader(Worker& w) {
+        w.reader = std::thread(&IsolatedPlugin::read_loop, this, &w);
+    }
+
+    void read_loop(Worker* w) {
+        std::string msg;
+        while (w->alive.load()) {
+            if (w->from_worker.pop(msg, kPollInterval)) handle_message(*w, msg);
+        }
+        // Whatever the worker managed to publish before it went away.
+        while (w->from_worker.try_pop(msg)) handle_message(*w, msg);
+    }
+
+    void handle_message(Worker& w, std::string_view msg) {
+        Msg kind;
+        std::uint64_t seq;
+        std::string_view payload;
+        if (!unframe(msg, kind, seq, payload)) return;
+        switch (kind) {
+        case Msg::ready: {
+            {
+                std::lock_guard<std::mutex> lock(slots_mutex_);
+                w.ready = true;
+            }
+            slots_cv_.notify_all();
+            logger.debug("worker ready", {{"plugin", name_}, {"pid", w.pid}});
+            break;
+        }
+        case Msg::proof: {
+            try {
+                json j = json::parse(payload);
+                VulnProof proof{j.value("target", ""), j.value("vuln_type", ""), j.value("evidence", json::object()),
+                                j.value("timestamp", ""), j.value("id", "")};
+                enqueue_proof(proof);
+            } catch (const json::exception& ex) {
+                logger.warn("bad proof from worker", {{"plugin", name_}, {"error", ex.what()}});
+            }
+            break;
+        }
+        case Msg::output: {
+            try {
+                json j = json::parse(payload);
+                publish_scan_output(j.value("scan", ""), j.value("kind", ""), j.value("value", json()));
+            } catch (const json::exception& ex) {
+                logger.warn("bad scan output from worker", {{"plugin", name_}, {"error", ex.what()}});
+            }
+            break;
+        }
+        case Msg::started: {
+            std::lock_guard<std::mutex> lock(w.pending_mutex);
+            auto it = w.pending.find(seq);
+            if (it != w.pending.end()) it->second->started = std::chrono::steady_clock::now();
+            break;
+        }
+        case Msg::progress: {
+            if (payload.size() != sizeof(Counters)) break;
+            std::shared_ptr<Pending> p;
+            {
+                std::lock_guard<std::mutex> lock(w.pending_mutex);
+                auto it = w.pending.find(seq);
+                if (it != w.pending.end()) p = it->second;
+            }
+            if (!p || !p->progress) break;
+            Counters c;
+            std::memcpy(c.data(), payload.data(), sizeof(c));
+            std::atomic<std::uint64_t>* fields[] = {&p->progress->requests_sent, &p->progress->payloads_total,
+                                                    &p->progress->payloads_done, &p->progress->findings};
+            for (std::size_t i = 0; i < c.size(); ++i) {
+                if (c[i] > p->reported[i]) fields[i]->fetch_add(c[i] - p->reported[i], std::memory_order_relaxed);
+                p->reported[i] = std::max(p->reported[i], c[i]);
+            }
+            break;
+        }
+        case Msg::done: {
+            std::shared_ptr<Pending> p;
+            {
+                std::lock_guard<std::mutex> lock(w.pending_mutex);
+                auto it = w.pending.find(seq);
+                if (it == w.pending.end()) break;
+                p = std::move(it->second);
+                w.pending.erase(it);
+            }
+            if (payload.size() < 1 + sizeof(ResourceUsage)) {
+                p->finish(false, "malformed reply from worker");
+                break;
+            }
+            bool ok = payload[0] == '1';
+            std::memcpy(&p->usage, payload.data() + 1, sizeof(ResourceUsage));
+            p->finish(ok, std::string(payload.substr(1 + sizeof(ResourceUsage))));
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    // Stops the reader and fails whatever the worker still held. Never called
+    // from the reader itself.
+    void retire(const std::shared_ptr<Worker>& w, const std::string& reason) {
+        w->alive = false;
+        if (w->reader.joinable()) w->reader.join();
+        std::unordered_map<std::uint64_t, std::shared_ptr<Pending>> orphaned;
+        {
+            std::lock_guard<std::mutex> lock(w->pending_mutex);
+            orphaned.swap(w->pending);
+        }
+        for (auto& [seq, p] : orphaned) p->finish(false, "worker " + reason);
+    }
+
+    bool overdue(Worker& w) {
+        auto limit = std::chrono::steady_clock::now() - options_.task_timeout;
+        std::lock_guard<std::mutex> lock(w.pending_mutex);
+        return std::any_of(w.pending.begin(), w.pending.end(), [&](const auto& entry) {
+            auto started = entry.second->started;
+            return started != std::chrono::steady_clock::time_point{} && started < limit;
+        });
+    }
+
+    void supervise() {
+        std::unique_lock<std::mutex> lock(slots_mutex_);
+        while (running_) {
+            slots_cv_.wait_for(lock, kPollInterval, [this] { return !running_; });
+            if (!running_) break;
+            auto now = std::chrono::steady_clock::now();
+            std::vector<std::pair<std::shared_ptr<Worker>, std::string>> dead;
+            for (auto& slot : slots_) {
+                if (!slot.worker) {
+                    if (now < slot.restart_at) continue;
+                    slot.worker = spawn(slot.cpu);
+                    if (slot.worker) {
+                        restarts(name_).inc();
+                        slots_cv_.notify_all();
+                    } else {
+                        slot.restart_at = now + backoff(++slot.failures);
+                    }
+                    continue;
+                }
+                auto& w = *slot.worker;
+                int status = 0;
+                if (::waitpid(w.pid, &status, WNOHANG) == w.pid) {
+                    std::string reason = WIFSIGNALED(status)
+                                             ? "killed by signal " + std::to_string(WTERMSIG(status))
+                                             : "exited with status " + std::to_string(WEXITSTATUS(status));
+                    logger.error("worker died", {{"plugin", name_}, {"pid", w.pid}, {"reason", reason}});
+                    // A worker that keeps dying straight away backs off
+                    // instead of being respawned in a tight loop.
+                    slot.failures = now - w.spawned < std::chrono::seconds(5) ? slot.failures + 1 : 0;
+                    slot.restart_at = now + backoff(slot.failures);
+                    dead.emplace_back(std::move(slot.worker), std::move(reason));
+                    continue;
+                }
+                if (options_.task_timeout.count() > 0 && !w.killed && overdue(w)) {
+                    logger.warn("task timed out, killing worker", {{"plugin", name_}, {"pid", w.pid}});
+                    ::kill(w.pid, SIGKILL);
+                    w.killed = true;
+                }
+            }
+            if (dead.empty()) continue;
+            lock.unlock();
+            for (auto& [w, reason] : dead) retire(w, reason);
+            lock.lock();
+        }
+    }
+
+    static std::chrono::milliseconds backoff(int failures) {
+        return std::min(std::chrono::milliseconds(100 << std::min(failures, 6)), std::chrono::milliseconds(5000));
+    }
+
+    // The live worker with the fewest tasks in flight, waiting briefly if
+    // every worker is being restarted.
+    std::shared_ptr<Worker> pick() {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        std::unique_lock<std::mutex> lock(slots_mutex_);
+        while (true) {
+            std::shared_ptr<Worker> best;
+            std::size_t best_load = 0;
+            for (auto& slot : slots_) {
+                if (!slot.worker || !slot.worker->alive) continue;
+                std::size_t load;
+                {
+                    std::lock_guard<std::mutex> pending_lock(slot.worker->pending_mutex);
+                    load = slot.worker->pending.size();
+                }
+                if (!best || load < best_load) {
+                    best = slot.worker;
+                    best_load = load;
+                }
+            }
+            if (best) return best;
+            if (!running_ || slots_cv_.wait_until(lock, deadline) == std::cv_status::timeout) {
+                throw std::runtime_error("no worker available");
+            }
+        }
+    }
+
+    void forward_canary(const std::string& seen) { broadcast(Msg::canary, seen); }
+
+    // Best effort unless `wait`: a full ring then gets kSendTimeout to drain
+    // instead of the message being dropped.
+    void broadcast(Msg kind, std::string_view payload, bool wait = false) {
+        std::vector<std::shared_ptr<Worker>> workers;
+        {
+            std::lock_guard<std::mutex> lock(slots_mutex_);
+            for (auto& slot : slots_) {
+                if (slot.worker && slot.worker->alive) workers.push_back(slot.worker);
+            }
+        }
+        for (auto& w : workers) {
+            std::lock_guard<std::mutex> lock(w->send_mutex);
+            bool sent = wait ? w->to_worker.push(frame(kind, 0, payload), kSendTimeout)
+                             : w->to_worker.try_push(frame(kind, 0, payload));
+            if (!sent && wait) logger.warn("worker ring full, message not delivered", {{"plugin", name_}, {"pid", w->pid}});
+        }
+    }
+
+    std::string library_;
+    std::string name_;
+    TaskType type_;
+    WorkerOptions options_;
+    std::mutex slots_mutex_;
+    std::condition_variable slots_cv_;
+    std::vector<Slot> slots_;
+    std::atomic<std::uint64_t> next_seq_{1};
+    bool running_ = true;
+    std::thread supervisor_;
+    int canary_observer_ = -1;
+    int interrupt_observer_ = -1;
+};
+
+// ---- worker side ----
+
+thread_local std::uint64_t tls_task_seq = 0;
+
+class WorkerRuntime {
+public:
+    WorkerRuntime(ShmRing in, ShmRing out, pid_t parent) : in_(in), out_(out), parent_(parent) {}
+
+    int run(Plugin& plugin, std::size_t threads) {
+        set_proof_sink([this](const VulnProof& proof) {
+            json j = proof;
+            send(Msg::proof, tls_task_seq, j.dump());
+        });
+        set_scan_output_sink([this](const std::string& scan_id, const std::string& kind, const json& value) {
+            send(Msg::output, tls_task_seq, json{{"scan", scan_id}, {"kind", kind}, {"value", value}}.dump());
+        });
+        send(Msg::ready, 0, plugin.name());
+
+        std::vector<std::thread> pool;
+        for (std::size_t i = 0; i < std::max<std::size_t>(1, threads); ++i) {
+            pool.emplace_back([this, &plugin] { work(plugin); });
+        }
+        std::thread reporter(&WorkerRuntime::report_loop, this);
+
+        std::string msg;
+        while (true) {
+            if (::getppid() != parent_) {
+                logger.warn("daemon went away, exiting");
+                break;
+            }
+            if (!in_.pop(msg, kPollInterval)) continue;
+            Msg kind;
+            std::uint64_t seq;
+            std::string_view payload;
+            if (!unframe(msg, kind, seq, payload)) continue;
+            if (kind == Msg::quit) break;
+            if (kind == Msg::canary) {
+                CanaryMonitor::get_instance().record_hit(std::string(payload));
+                continue;
+            }
+            if (kind == Msg::interrupt) {
+                CheckpointStore::get_instance().interrupt();
+                continue;
+            }
+            if (kind != Msg::task) continue;
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                queue_.emplace_back(seq, std::string(payload));
+            }
+            queue_cv_.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            stop_ = true;
+        }
+        queue_cv_.notify_all();
+        report_cv_.notify_all();
+        for (auto& t : pool) t.join();
+        reporter.join();
+        set_proof_sink(nullptr);
+        set_scan_output_sink(nullptr);
+        return 0;
+    }
+
+private:
+    void finish(std::uint64_t seq, bool ok, const ResourceUsage& usage, std::string_view error) {
+        std::string payload(1, ok ? '1' : '0');
+        payload.append(reinterpret_cast<const char*>(&usage), sizeof(usage));
+        payload += error;
+        send(Msg::done, seq, payload);
+    }
+
+    void send(Msg kind, std::uint64_t seq, std::string_view payload) {
+        std::lock_guard<std::mutex> lock(send_mutex_);
+        if (!out_.push(frame(kind, seq, payload), kSendTimeout)) {
+            logger.warn("daemon is not draining the ring, dropping message", {{"size", payload.size()}});
+        }
+    }
+
+    void work(Plugin& plugin) {
+        while (true) {
+            std::unique_lock<std::mutex> lock(queue_mutex_);
+            queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+            if (stop_) return;
+            auto [seq, payload] = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+            send(Msg::started, seq, {});
+            execute(plugin, seq, payload);
+        }
+    }
+
+    void execute(Plugin& plugin, std::uint64_t seq, const std::string& payload) {
+        std::uint32_t id_len = 0;
+        if (payload.size() < sizeof(id_len)) return finish(seq, false, {}, "malformed task message");
+        std::memcpy(&id_len, payload.data(), sizeof(id_len));
+        if (payload.size() - sizeof(id_len) < id_len) return finish(seq, false, {}, "malformed task message");
+        Task task;
+        try {
+            task = parse_task(payload.substr(sizeof(id_len) + id_len));
+        } catch (const std::invalid_argument& ex) {
+            return finish(seq, false, {}, ex.what());
+        }
+        task.id = payload.substr(sizeof(id_len), id_len);
+
+        auto progress = std::make_shared<ScanProgress>();
+        {
+            std::lock_guard<std::mutex> lock(running_mutex_);
+            running_[seq] = progress;
+        }
+        bool ok = true;
+        std::string error;
+        ResourceUsage usage;
+        {
+            ScanScope scope(task.id, progress);
+            CheckpointScope checkpoint_scope(task);
+            LogScope log_scope(task.id, task.url.host);
+            TaskArenaScope arena;
+            tls_task_seq = seq;
+            UsageMeter meter;
+            try {
+                plugin.handle_task(task);
+            } catch (const std::exception& ex) {
+                ok = false;
+                error = ex.what();
+            } catch (...) {
+                ok = false;
+                error = "unknown exception";
+            }
+            usage = meter.elapsed();
+            tls_task_seq = 0;
+        }
+        {
+            std::lock_guard<std::mutex> lock(running_mutex_);
+            running_.erase(seq);
+        }
+        send(Msg::progress, seq, encode(*progress));
+        finish(seq, ok, usage, error);
+    }
+
+    void report_loop() {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        while (!stop_) {
+            report_cv_.wait_for(lock, kProgressInterval, [this] { return stop_; });
+            if (stop_) return;
+            lock.unlock();
+            std::vector<std::pair<std::uint64_t, std::shared_ptr<ScanProgress>>> running;
+            {
+                std::lock_guard<std::mutex> running_lock(running_mutex_);
+                running.assign(running_.begin(), running_.end());
+            }
+            for (const auto& [seq, progress] : running) send(Msg::progress, seq, encode(*progress));
+            lock.lock();
+        }
+    }
+
+    ShmRing in_;
+    ShmRing out_;
+    pid_t parent_;
+    std::mutex send_mutex_;
+    std::mutex queue_mutex_;
+    std::condition_variable queue_cv_;
+    // Separate from queue_cv_, whose notify_one() must reach a task thread.
+    std::condition_variable report_cv_;
+    std::deque<std::pair<std::uint64_t, std::string>> queue_;
+    bool stop_ = false;
+    std::mutex running_mutex_;
+    std::unordered_map<std::uint64_t, std::shared_ptr<ScanProgress>> running_;
+};
+
+std::vector<int> parse_cpu_list(const std::string& spec) {
+    std::vector<int> cpus;
+    std::size_t pos = 0;
+    while (pos < spec.size()) {
+        auto comma = spec.find(',', pos);
+        std::string part = spec.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        pos = comma == std::string::npos ? spec.size() : comma + 1;
+        if (part.empty()) continue;
+        auto dash = part.find('-');
+        int first = std::atoi(part.c_str());
+        int last = dash == std::string::npos ? first : std::atoi(part.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last && cpu >= 0; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+} // namespace
+
+WorkerOptions WorkerOptions::from_env() {
+    WorkerOptions options;
+    if (const char* v = std::getenv("SPECTRE_WORKER_PROCESSES")) options.processes = std::strtoul(v, nullptr, 10);
+    if (const char* v = std::getenv("SPECTRE_WORKER_THREADS")) options.threads = std::strtoul(v, nullptr, 10);
+    if (const char* v = std::getenv("SPECTRE_WORKER_CPUS")) options.cpus = parse_cpu_list(v);
+    if (const char* v = std::getenv("SPECTRE_WORKER_TASK_TIMEOUT_S")) {
+        options.task_timeout = std::chrono::seconds(std::strtoul(v, nullptr, 10));
+    }
+    if (const char* v = std::getenv("SPECTRE_WORKER_RING_KB")) {
+        options.ring_bytes = std::max<std::size_t>(64, std::strtoul(v, nullptr, 10)) * 1024;
+    }
+    return options;
+}
+
+std::shared_ptr<Plugin> make_isolated_plugin(const std::string& library, const WorkerOptions& options) {
+    std::string label = std::filesystem::path(library).stem().string();
+    int cpu = options.cpus.empty() ? -1 : options.cpus[next_cpu.fetch_add(1) % options.cpus.size()];
+    auto first = launch_worker(library, label, options, cpu);
+    if (!first) return nullptr;
+    std::string name = await_name(*first, kReadyTimeout);
+    if (name.empty()) {
+        logger.error("worker did not report a loaded plugin", {{"library", library}});
+        return nullptr;
+    }
+    return std::make_shared<IsolatedPlugin>(library, std::move(name), options, std::move(first), cpu);
+}
+
+bool is_worker_invocation(int argc, char* argv[]) {
+    return argc > 1 && std::strcmp(argv[1], "--worker") == 0;
+}
+
+int run_plugin_worker(int argc, char* argv[]) {
+    if (argc < 3) return 2;
+    std::string library = argv[2];
+    std::size_t ring_bytes = 0;
+    std::size_t threads = 1;
+    int cpu = -1;
+    pid_t parent = 0;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--ring-bytes") ring_bytes = std::strtoul(value, nullptr, 10);
+        else if (flag == "--threads") threads = std::strtoul(value, nullptr, 10);
+        else if (flag == "--cpu") cpu = std::atoi(value);
+        else if (flag == "--parent") parent = static_cast<pid_t>(std::atol(value));
+    }
+    if (ring_bytes == 0 || parent == 0) return 2;
+
+    auto& log = Logger::get_instance();
+    if (const char* spec = std::getenv("SPECTRE_LOG")) log.configure(spec);
+    else if (std::getenv("SPECTRE_DEBUG")) log.set_level(LogLevel::debug);
+    log.start(stderr);
+
+    // Dies with the daemon, and bails out if that already happened.
+    ::prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (::getppid() != parent) return 1;
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if (::sched_setaffinity(0, sizeof(set), &set) != 0) {
+            logger.warn("could not pin worker", {{"cpu", cpu}, {"error", std::strerror(errno)}});
+        }
+    }
+
+    std::size_t size = shm_bytes(ring_bytes);
+    void* shm = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, kShmFd, 0);
+    ::close(kShmFd);
+    if (shm == MAP_FAILED) {
+        logger.error("could not map rings", {{"error", std::strerror(errno)}});
+        log.stop();
+        return 1;
+    }
+    auto* base = static_cast<unsigned char*>(shm);
+    ShmRing in = ShmRing::attach(base);
+    ShmRing out = ShmRing::attach(base + ShmRing::region_size(ring_bytes));
+
+    int rc = 1;
+    {
+        PluginLoader loader(std::filesystem::path(library).parent_path().string());
+        auto plugin = loader.load(library);
+        if (plugin) {
+            try {
+                plugin->warm_up();
+            } catch (const std::exception& ex) {
+                logger.error("plugin warm-up threw", {{"error", ex.what()}});
+            }
+            start_canary_monitor(false);
+            rc = WorkerRuntime(in, out, parent).run(*plugin, threads);
+            stop_canary_monitor();
+        }
+    }
+    ::munmap(shm, size);
+    log.stop();
+    return rc;
+}
+
+} // namespace spectre
@@ -1,4 +1,8 @@
 #include "spectre/proof_queue.h"
+#include "spectre/metrics.h"
+#include "spectre/proof_store.h"
+#include "spectre/scan_registry.h"
+#include "spectre/trace.h"
 #include <iostream>
 #include <thread>
 
@@ -6,6 +10,15 @@ namespace spectre {
 
 ProofQueue* proof_queue_instance = nullptr;
 std::thread proof_processing_thread;
+std::function<void(const VulnProof&)> proof_sink;
+
+namespace {
+Gauge& queue_depth() {
+    static Gauge& gauge = MetricsRegistry::get_instance().gauge("spectre_proof_queue_depth",
+                                                               "Proofs waiting to be broadcast and submitted.");
+    return gauge;
+}
+} // namespace
 
 ProofQueue::ProofQueue(WebSocketServer& ws) : ws_(ws) {}
 
@@ -33,32 +46,61 @@ void ProofQueue::process_proofs() {
             return;
         }
 
-        VulnProof proof = proofs_.front();
-        proofs_.erase(proofs_.begin());
+        Pending pending = std::move(proofs_.front());
+        proofs_.pop_front();
         lock.unlock();
+        queue_depth().add(-1);
+        const VulnProof& proof = pending.proof;
+        if (pending.enqueued_ns) {
+            trace_complete("queued", "proof_queue", pending.enqueued_ns, trace_now(), proof.id);
+        }
 
-        json proof_json;
-        proof_json["target"] = proof.target;
-        proof_json["vuln_type"] = proof.vuln_type;
-        proof_json["evidence"] = proof.evidence;
-        proof_json["timestamp"] = proof.timestamp;
-        proof_json["id"] = proof.id;
-        ws_.broadcast(proof_json.dump());
-
-        arweave_client_.submit_proof(proof);
+        {
+            TraceSpan span("store", "proof_queue", proof.id);
+            ProofStore::get_instance().append(proof);
+        }
+        {
+            TraceSpan span("broadcast", "proof_queue", proof.id);
+            json proof_json = proof;
+            ws_.broadcast(proof_json.dump());
+        }
+        {
+            TraceSpan span("arweave_submit", "proof_queue", proof.id);
+            arweave_client_.submit_proof(proof);
+        }
     }
 }
 
 void ProofQueue::enqueue(const VulnProof& proof) {
     std::unique_lock<std::mutex> lock(mutex_);
-    proofs_.push_back(proof);
+    proofs_.push_back({proof, tracing_enabled() ? trace_now() : 0});
+    queue_depth().add(1);
     cv_.notify_one();
 }
 
 void enqueue_proof(const VulnProof& proof) {
-    if (proof_queue_instance) {
-        proof_queue_instance->enqueue(proof);
+    scan_finding();
+    if (!proof_queue_instance && !proof_sink) {
+        return;
+    }
+    const VulnProof* out = &proof;
+    VulnProof attributed;
+    if (proof.id.empty() && !current_scan_id().empty()) {
+        attributed = proof;
+        attributed.id = current_scan_id();
+        out = &attributed;
     }
+    if (proof_sink) {
+        proof_sink(*out);
+    } else {
+        // Worker processes publish through the daemon, which lands here.
+        publish_scan_output(out->id, "finding", *out);
+        proof_queue_instance->enqueue(*out);
+    }
+}
+
+void set_proof_sink(std::function<void(const VulnProof&)> sink) {
+    proof_sink = std::move(sink);
 }
 
 void init_proof_queue(WebSocketServer& ws) {
@@ -0,0 +1,188 @@
+#include "spectre/proof_store.h"
+#include "spectre/log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <mutex>
+#include <unistd.h>
+
+namespace spectre {
+
+namespace {
+const LogSource& logger = Logger::get_instance().source("proof_store");
+
+std::int64_t parse_timestamp(const std::string& ts) {
+    return std::strtoll(ts.c_str(), nullptr, 10);
+}
+
+bool write_all(int fd, const std::string& data) {
+    std::size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        written += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+} // namespace
+
+ProofStore& ProofStore::get_instance() {
+    static ProofStore instance;
+    return instance;
+}
+
+ProofStore::~ProofStore() {
+    if (write_fd_ >= 0) ::close(write_fd_);
+    if (read_fd_ >= 0) ::close(read_fd_);
+}
+
+bool ProofStore::open(const std::string& path) {
+    std::unique_lock lock(mutex_);
+    write_fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0640);
+    read_fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (write_fd_ < 0 || read_fd_ < 0) {
+        logger.error("could not open store", {{"path", path}});
+        return false;
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    std::uint64_t offset = 0;
+    while (std::getline(in, line)) {
+        std::uint64_t line_offset = offset;
+        offset += line.size() + 1;
+        try {
+            auto record = json::parse(line);
+            Entry entry{
+                record.value("seq", next_seq_),
+                line_offset,
+                static_cast<std::uint32_t>(line.size()),
+                parse_timestamp(record.value("timestamp", "")),
+                record.value("target", ""),
+                record.value("vuln_type", ""),
+                record.value("id", "")
+            };
+            next_seq_ = std::max(next_seq_, entry.seq + 1);
+            add_entry(std::move(entry));
+        } catch (const json::exception&) {
+            // A torn final line from a crash; skip it, later appends start on a fresh line.
+        }
+    }
+    off_t size = ::lseek(read_fd_, 0, SEEK_END);
+    char last = '\n';
+    if (size > 0 && ::pread(read_fd_, &last, 1, size - 1) == 1 && last != '\n' && write_all(write_fd_, "\n")) {
+        ++size;
+    }
+    end_offset_ = size > 0 ? static_cast<std::uint64_t>(size) : 0;
+    logger.info("proofs indexed", {{"count", index_.size()}, {"path", path}});
+    return true;
+}
+
+std::uint64_t ProofStore::append(const VulnProof& proof) {
+    json record = proof;
+    std::unique_lock lock(mutex_);
+    if (write_fd_ < 0) {
+        return 0;
+    }
+    std::uint64_t seq = next_seq_++;
+    record["seq"] = seq;
+    std::string line = record.dump();
+    if (!write_all(write_fd_, line + "\n")) {
+        logger.error("write failed", {{"seq", seq}});
+        return 0;
+    }
+    add_entry(Entry{seq, end_offset_, static_cast<std::uint32_t>(line.size()), parse_timestamp(proof.timestamp),
+                    proof.target, proof.vuln_type, proof.id});
+    end_offset_ += line.size() + 1;
+    return seq;
+}
+
+void ProofStore::add_entry(Entry entry) {
+    auto position = static_cast<std::uint32_t>(index_.size());
+    if (!entry.target.empty()) by_target_[entry.target].push_back(position);
+    if (!entry.vuln_type.empty()) by_vuln_type_[entry.vuln_type].push_back(position);
+    if (!entry.scan_id.empty()) by_scan_id_[entry.scan_id].push_back(position);
+    index_.push_back(std::move(entry));
+}
+
+ProofPage ProofStore::read_page(const ProofQuery& query, std::size_t max_records, std::string& out, bool continuation) {
+    struct Slice {
+        std::uint64_t seq;
+        std::uint64_t offset;
+        std::uint32_t length;
+    };
+    std::vector<Slice> slices;
+    ProofPage page;
+    {
+        std::shared_lock lock(mutex_);
+        auto matches = [&](const Entry& e) {
+            return (query.target.empty() || e.target == query.target) &&
+                   (query.vuln_type.empty() || e.vuln_type == query.vuln_type) &&
+                   (query.scan_id.empty() || e.scan_id == query.scan_id) && e.timestamp >= query.since &&
+                   e.timestamp <= query.until;
+        };
+        // Walk the shortest posting list among the filtered fields, or every
+        // record when none is filtered. A value with no list matches nothing.
+        const std::vector<std::uint32_t>* postings = nullptr;
+        bool none = false;
+        auto narrow = [&](const Postings& by_field, const std::string& value) {
+            if (value.empty() || none) return;
+            auto found = by_field.find(value);
+            if (found == by_field.end()) {
+                none = true;
+            } else if (!postings || found->second.size() < postings->size()) {
+                postings = &found->second;
+            }
+        };
+        narrow(by_target_, query.target);
+        narrow(by_vuln_type_, query.vuln_type);
+        narrow(by_scan_id_, query.scan_id);
+
+        if (none) {
+            page.exhausted = true;
+        } else if (postings) {
+            auto it = std::upper_bound(postings->begin(), postings->end(), query.cursor,
+                                       [&](std::uint64_t cursor, std::uint32_t p) { return cursor < index_[p].seq; });
+            for (; it != postings->end() && slices.size() < max_records; ++it) {
+                const Entry& e = index_[*it];
+                if (!matches(e)) continue;
+                slices.push_back({e.seq, e.offset, e.length});
+                page.last_seq = e.seq;
+            }
+            page.exhausted = it == postings->end();
+        } else {
+            auto it = std::upper_bound(index_.begin(), index_.end(), query.cursor,
+                                       [](std::uint64_t cursor, const Entry& e) { return cursor < e.seq; });
+            for (; it != index_.end() && slices.size() < max_records; ++it) {
+                if (!matches(*it)) continue;
+                slices.push_back({it->seq, it->offset, it->length});
+                page.last_seq = it->seq;
+            }
+            page.exhausted = it == index_.end();
+        }
+    }
+
+    for (const auto& slice : slices) {
+        std::size_t mark = out.size();
+        if (continuation || page.count > 0) out += ',';
+        std::size_t start = out.size();
+        out.resize(start + slice.length);
+        ssize_t n = ::pread(read_fd_, out.data() + start, slice.length, static_cast<off_t>(slice.offset));
+        if (n != static_cast<ssize_t>(slice.length)) {
+            out.resize(mark);
+            logger.error("could not read record", {{"seq", slice.seq},
+                                                   {"error", n < 0 ? std::strerror(errno) : "short read"}});
+            continue;
+        }
+        ++page.count;
+    }
+    return page;
+}
+
+} // namespace spectre
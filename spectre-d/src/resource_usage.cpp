@@ -0,0 +1,53 @@
+#include "spectre/resource_usage.h"
+#include <ctime>
+
+namespace spectre {
+
+constinit thread_local std::uint64_t tls_allocated_bytes = 0;
+
+namespace {
+// Requests and remote usage charged to this thread so far.
+thread_local ResourceUsage tls_usage;
+
+std::uint64_t thread_cpu_ns() {
+    timespec ts{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(ts.tv_nsec);
+}
+} // namespace
+
+ResourceUsage& ResourceUsage::operator+=(const ResourceUsage& other) {
+    cpu_ns += other.cpu_ns;
+    allocated_bytes += other.allocated_bytes;
+    requests += other.requests;
+    bytes_sent += other.bytes_sent;
+    bytes_received += other.bytes_received;
+    return *this;
+}
+
+void usage_record_request(std::uint64_t bytes_sent, std::uint64_t bytes_received) {
+    tls_usage.requests += 1;
+    tls_usage.bytes_sent += bytes_sent;
+    tls_usage.bytes_received += bytes_received;
+}
+
+void usage_record_remote(const ResourceUsage& usage) {
+    tls_usage += usage;
+}
+
+UsageMeter::UsageMeter() : start_(now()) {}
+
+ResourceUsage UsageMeter::now() {
+    ResourceUsage usage = tls_usage;
+    usage.cpu_ns += thread_cpu_ns();
+    usage.allocated_bytes += tls_allocated_bytes;
+    return usage;
+}
+
+ResourceUsage UsageMeter::elapsed() const {
+    ResourceUsage end = now();
+    return {end.cpu_ns - start_.cpu_ns, end.allocated_bytes - start_.allocated_bytes, end.requests - start_.requests,
+            end.bytes_sent - start_.bytes_sent, end.bytes_received - start_.bytes_received};
+}
+
+} // namespace spectre
@@ -0,0 +1,299 @@
+#include "spectre/scan_registry.h"
+#include <iostream>
+#include <random>
+
+namespace spectre {
+
+namespace {
+constexpr std::size_t kFinishedRetained = 10000;
+
+thread_local std::string tls_scan_id;
+thread_local std::shared_ptr<ScanProgress> tls_progress;
+ScanOutputSink output_sink;
+
+std::int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+const char* state_name(ScanState state) {
+    switch (state) {
+    case ScanState::queued: return "queued";
+    case ScanState::running: return "running";
+    case ScanState::done: return "done";
+    case ScanState::failed: return "failed";
+    }
+    return "unknown";
+}
+} // namespace
+
+struct ScanRegistry::Entry {
+    std::string id;
+    std::string type;
+    std::string target;
+    ScanState state = ScanState::queued;
+    std::string error;
+    std::int64_t created_at = 0;
+    std::int64_t started_at = 0;
+    std::int64_t finished_at = 0;
+    std::shared_ptr<ScanProgress> progress = std::make_shared<ScanProgress>();
+    std::uint64_t emitted_requests = 0;
+    std::uint64_t emitted_payloads = 0;
+    std::uint64_t emitted_findings = 0;
+    std::map<std::string, ResourceUsage> usage;
+};
+
+ScanRegistry& ScanRegistry::get_instance() {
+    static ScanRegistry instance;
+    return instance;
+}
+
+std::string ScanRegistry::new_id() {
+    thread_local std::mt19937_64 gen(std::random_device{}());
+    static const char* hex = "0123456789abcdef";
+    std::string id(32, '0');
+    std::uint64_t hi = gen(), lo = gen();
+    for (int i = 0; i < 16; ++i) {
+        id[i] = hex[(hi >> (i * 4)) & 0xf];
+        id[16 + i] = hex[(lo >> (i * 4)) & 0xf];
+    }
+    return id;
+}
+
+std::string ScanRegistry::create(const std::string& type, const std::string& target) {
+    std::string id = new_id();
+    ensure(id, type, target);
+    return id;
+}
+
+void ScanRegistry::ensure(const std::string& id, const std::string& type, const std::string& target) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& entry = scans_[id];
+    if (!entry) {
+        entry = std::make_shared<Entry>();
+        entry->id = id;
+        entry->type = type;
+        entry->target = target;
+        entry->created_at = unix_now();
+    }
+}
+
+std::shared_ptr<ScanProgress> ScanRegistry::mark_running(const std::string& id) {
+    json event;
+    std::shared_ptr<ScanProgress> progress;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = scans_.find(id);
+        if (it == scans_.end()) {
+            return nullptr;
+        }
+        auto& entry = *it->second;
+        entry.state = ScanState::running;
+        entry.started_at = unix_now();
+        progress = entry.progress;
+        event = to_json(entry);
+    }
+    event["event"] = "scan_started";
+    emit(event);
+    return progress;
+}
+
+void ScanRegistry::mark_finished(const std::string& id, bool ok, const std::string& error) {
+    json event;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = scans_.find(id);
+        if (it == scans_.end()) {
+            return;
+        }
+        auto& entry = *it->second;
+        entry.state = ok ? ScanState::done : ScanState::failed;
+        entry.error = error;
+        entry.finished_at = unix_now();
+        event = to_json(entry);
+        retire(id);
+    }
+    event["event"] = "scan_finished";
+    emit(event);
+}
+
+void ScanRegistry::add_usage(const std::string& id, const std::string& plugin, const ResourceUsage& usage) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = scans_.find(id);
+    if (it == scans_.end()) {
+        return;
+    }
+    it->second->usage[plugin] += usage;
+}
+
+void ScanRegistry::retire(const std::string& id) {
+    finished_.push_back(id);
+    while (finished_.size() > kFinishedRetained) {
+        scans_.erase(finished_.front());
+        finished_.pop_front();
+    }
+}
+
+json ScanRegistry::to_json(const Entry& entry) const {
+    const auto& p = *entry.progress;
+    std::uint64_t total = p.payloads_total.load(std::memory_order_relaxed);
+    std::uint64_t done = p.payloads_done.load(std::memory_order_relaxed);
+    json out = {
+        {"id", entry.id},
+        {"type", entry.type},
+        {"target", entry.target},
+        {"state", state_name(entry.state)},
+        {"created_at", entry.created_at},
+        {"started_at", entry.started_at},
+        {"finished_at", entry.finished_at},
+        {"requests_sent", p.requests_sent.load(std::memory_order_relaxed)},
+        {"payloads_total", total},
+        {"payloads_remaining", total > done ? total - done : 0},
+        {"findings", p.findings.load(std::memory_order_relaxed)}
+    };
+    if (!entry.error.empty()) {
+        out["error"] = entry.error;
+    }
+    if (!entry.usage.empty()) {
+        out["usage"] = entry.usage;
+    }
+    return out;
+}
+
+std::optional<json> ScanRegistry::status(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = scans_.find(id);
+    if (it == scans_.end()) {
+        return std::nullopt;
+    }
+    return to_json(*it->second);
+}
+
+json ScanRegistry::summary() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t queued = 0, running = 0;
+    for (const auto& [id, entry] : scans_) {
+        if (entry->state == ScanState::queued) ++queued;
+        if (entry->state == ScanState::running) ++running;
+    }
+    return {{"queued", queued}, {"running", running}, {"finished", finished_.size()}};
+}
+
+void ScanRegistry::emit(const json& event) {
+    EventSink sink;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        sink = sink_;
+    }
+    if (sink) {
+        sink(event.dump());
+    }
+}
+
+void ScanRegistry::start_events(EventSink sink, std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (events_running_) {
+        return;
+    }
+    sink_ = std::move(sink);
+    interval_ = interval;
+    events_running_ = true;
+    events_thread_ = std::thread(&ScanRegistry::event_loop, this);
+}
+
+void ScanRegistry::stop_events() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!events_running_) {
+            return;
+        }
+        events_running_ = false;
+        sink_ = nullptr;
+    }
+    events_cv_.notify_all();
+    if (events_thread_.joinable()) {
+        events_thread_.join();
+    }
+}
+
+void ScanRegistry::event_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (events_running_) {
+        events_cv_.wait_for(lock, interval_, [this] { return !events_running_; });
+        if (!events_running_) {
+            break;
+        }
+        std::vector<json> events;
+        for (auto& [id, entry] : scans_) {
+            if (entry->state != ScanState::running) continue;
+            const auto& p = *entry->progress;
+            std::uint64_t requests = p.requests_sent.load(std::memory_order_relaxed);
+            std::uint64_t payloads = p.payloads_done.load(std::memory_order_relaxed);
+            std::uint64_t findings = p.findings.load(std::memory_order_relaxed);
+            if (requests == entry->emitted_requests && payloads == entry->emitted_payloads &&
+                findings == entry->emitted_findings) {
+                continue;
+            }
+            entry->emitted_requests = requests;
+            entry->emitted_payloads = payloads;
+            entry->emitted_findings = findings;
+            json event = to_json(*entry);
+            event["event"] = "scan_progress";
+            events.push_back(std::move(event));
+        }
+        auto sink = sink_;
+        lock.unlock();
+        for (const auto& event : events) {
+            sink(event.dump());
+        }
+        lock.lock();
+    }
+}
+
+ScanScope::ScanScope(std::string id, std::shared_ptr<ScanProgress> progress) {
+    tls_scan_id = std::move(id);
+    tls_progress = std::move(progress);
+}
+
+ScanScope::~ScanScope() {
+    tls_scan_id.clear();
+    tls_progress.reset();
+}
+
+const std::string& current_scan_id() {
+    return tls_scan_id;
+}
+
+const std::shared_ptr<ScanProgress>& current_scan_progress() {
+    return tls_progress;
+}
+
+void scan_request_sent() {
+    if (tls_progress) tls_progress->requests_sent.fetch_add(1, std::memory_order_relaxed);
+}
+
+void scan_add_payloads(std::uint64_t count) {
+    if (tls_progress) tls_progress->payloads_total.fetch_add(count, std::memory_order_relaxed);
+}
+
+void scan_payload_done() {
+    if (tls_progress) tls_progress->payloads_done.fetch_add(1, std::memory_order_relaxed);
+}
+
+void scan_finding() {
+    if (tls_progress) tls_progress->findings.fetch_add(1, std::memory_order_relaxed);
+}
+
+void set_scan_output_sink(ScanOutputSink sink) {
+    output_sink = std::move(sink);
+}
+
+void publish_scan_output(const std::string& scan_id, const std::string& kind, const json& value) {
+    if (output_sink && !scan_id.empty()) output_sink(scan_id, kind, value);
+}
+
+void scan_output(const std::string& kind, const json& value) {
+    publish_scan_output(tls_scan_id, kind, value);
+}
+
+} // namespace spectre
@@ -0,0 +1,160 @@
+#include "spectre/shm_ring.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace spectre {
+
+struct ShmRing::Header {
+    std::uint64_t capacity;
+    // Producer side.
+    alignas(64) std::atomic<std::uint64_t> head;
+    std::atomic<std::uint32_t> pushed;
+    std::atomic<std::uint32_t> consumer_waiting;
+    // Consumer side.
+    alignas(64) std::atomic<std::uint64_t> tail;
+    std::atomic<std::uint32_t> popped;
+    std::atomic<std::uint32_t> producer_waiting;
+};
+
+namespace {
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "ring positions must be address-free");
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "futex words must be address-free");
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+
+constexpr std::size_t kHeaderBytes = 256;
+constexpr std::size_t kLengthBytes = sizeof(std::uint32_t);
+
+std::size_t round_up_pow2(std::size_t n) {
+    std::size_t p = 64;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// No FUTEX_PRIVATE_FLAG: the word lives in a mapping shared across processes.
+void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, std::chrono::milliseconds timeout) {
+    timespec ts{static_cast<time_t>(timeout.count() / 1000), static_cast<long>((timeout.count() % 1000) * 1000000)};
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+void futex_wake(std::atomic<std::uint32_t>& word) {
+    ::syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+template <typename Try>
+bool wait_until(Try attempt, std::atomic<std::uint32_t>& word, std::atomic<std::uint32_t>& waiting,
+                std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (true) {
+        if (attempt()) return true;
+        std::uint32_t seen = word.load(std::memory_order_acquire);
+        waiting.store(1, std::memory_order_relaxed);
+        // Pairs with the fence in notify(): either we see the other side's
+        // update below or it sees waiting and wakes us.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (attempt()) {
+            waiting.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            waiting.store(0, std::memory_order_relaxed);
+            return false;
+        }
+        futex_wait(word, seen,
+                   std::chrono::ceil<std::chrono::milliseconds>(deadline - now));
+        waiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+void notify(std::atomic<std::uint32_t>& word, std::atomic<std::uint32_t>& waiting) {
+    word.fetch_add(1, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed)) futex_wake(word);
+}
+} // namespace
+
+std::size_t ShmRing::region_size(std::size_t capacity) {
+    return kHeaderBytes + round_up_pow2(capacity);
+}
+
+ShmRing ShmRing::create(void* memory, std::size_t capacity) {
+    static_assert(sizeof(Header) <= kHeaderBytes);
+    auto* header = new (memory) Header{};
+    header->capacity = round_up_pow2(capacity);
+    return ShmRing(header, static_cast<unsigned char*>(memory) + kHeaderBytes, header->capacity);
+}
+
+ShmRing ShmRing::attach(void* memory) {
+    auto* header = static_cast<Header*>(memory);
+    return ShmRing(header, static_cast<unsigned char*>(memory) + kHeaderBytes, header->capacity);
+}
+
+std::size_t ShmRing::max_message() const {
+    return capacity_ - kLengthBytes;
+}
+
+void ShmRing::copy_in(std::uint64_t pos, const void* src, std::size_t len) {
+    std::size_t offset = pos & (capacity_ - 1);
+    std::size_t first = std::min<std::size_t>(len, capacity_ - offset);
+    std::memcpy(data_ + offset, src, first);
+    std::memcpy(data_, static_cast<const unsigned char*>(src) + first, len - first);
+}
+
+void ShmRing::copy_out(std::uint64_t pos, void* dst, std::size_t len) const {
+    std::size_t offset = pos & (capacity_ - 1);
+    std::size_t first = std::min<std::size_t>(len, capacity_ - offset);
+    std::memcpy(dst, data_ + offset, first);
+    std::memcpy(static_cast<unsigned char*>(dst) + first, data_, len - first);
+}
+
+bool ShmRing::try_push(std::string_view message) {
+    if (message.size() > max_message()) return false;
+    std::uint64_t head = header_->head.load(std::memory_order_relaxed);
+    std::uint64_t tail = header_->tail.load(std::memory_order_acquire);
+    std::size_t need = kLengthBytes + message.size();
+    if (capacity_ - (head - tail) < need) return false;
+    auto len = static_cast<std::uint32_t>(message.size());
+    copy_in(head, &len, kLengthBytes);
+    copy_in(head + kLengthBytes, message.data(), message.size());
+    header_->head.store(head + need, std::memory_order_release);
+    notify(header_->pushed, header_->consumer_waiting);
+    return true;
+}
+
+bool ShmRing::push(std::string_view message, std::chrono::milliseconds timeout) {
+    if (message.size() > max_message()) return false;
+    return wait_until([&] { return try_push(message); }, header_->popped, header_->producer_waiting, timeout);
+}
+
+bool ShmRing::try_pop(std::string& out) {
+    std::uint64_t tail = header_->tail.load(std::memory_order_relaxed);
+    std::uint64_t head = header_->head.load(std::memory_order_acquire);
+    if (head == tail) return false;
+    std::uint32_t len = 0;
+    copy_out(tail, &len, kLengthBytes);
+    // The producer may be a process that has scribbled over the mapping;
+    // drop everything rather than read past what it published.
+    if (head - tail > capacity_ || head - tail < kLengthBytes || len > head - tail - kLengthBytes) {
+        header_->tail.store(head, std::memory_order_release);
+        return false;
+    }
+    out.resize(len);
+    copy_out(tail + kLengthBytes, out.data(), len);
+    header_->tail.store(tail + kLengthBytes + len, std::memory_order_release);
+    notify(header_->popped, header_->producer_waiting);
+    return true;
+}
+
+bool ShmRing::pop(std::string& out, std::chrono::milliseconds timeout) {
+    return wait_until([&] { return try_pop(out); }, header_->pushed, header_->consumer_waiting, timeout);
+}
+
+} // namespace spectre
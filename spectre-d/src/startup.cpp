@@ -0,0 +1,88 @@
+#include "spectre/startup.h"
+#include "spectre/log.h"
+#include "spectre/metrics.h"
+
+namespace spectre {
+
+namespace {
+const LogSource& logger = Logger::get_instance().source("startup");
+
+Gauge& time_to_ready() {
+    static Gauge& gauge = MetricsRegistry::get_instance().gauge(
+        "spectre_startup_time_to_ready_milliseconds",
+        "Milliseconds from process start until every required component was ready.");
+    return gauge;
+}
+
+Gauge& time_to_first_task() {
+    static Gauge& gauge = MetricsRegistry::get_instance().gauge(
+        "spectre_startup_time_to_first_task_milliseconds",
+        "Milliseconds from process start until the first task was accepted.");
+    return gauge;
+}
+} // namespace
+
+Startup& Startup::get_instance() {
+    static Startup* instance = new Startup();
+    return *instance;
+}
+
+void Startup::begin() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    started_ = std::chrono::steady_clock::now();
+}
+
+std::int64_t Startup::elapsed_ms() const {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started_).count();
+}
+
+void Startup::pending(const std::string& component, bool required) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    components_[component] = Component{required, false, -1};
+}
+
+void Startup::ready(const std::string& component) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& c = components_[component];
+    if (c.ready) return;
+    c.ready = true;
+    c.ready_ms = elapsed_ms();
+    logger.debug("component ready", {{"component", component}, {"ms", c.ready_ms}});
+    if (ready_ms_ >= 0) return;
+    for (const auto& [name, other] : components_) {
+        if (other.required && !other.ready) return;
+    }
+    ready_ms_ = c.ready_ms;
+    time_to_ready().set(ready_ms_);
+    logger.info("ready", {{"ms", ready_ms_}});
+}
+
+bool Startup::is_ready() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ready_ms_ >= 0;
+}
+
+json Startup::status() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    json components = json::object();
+    json warming = json::array();
+    for (const auto& [name, c] : components_) {
+        components[name] = {{"ready", c.ready}, {"required", c.required}};
+        if (c.ready) components[name]["ready_ms"] = c.ready_ms;
+        else if (!c.required) warming.push_back(name);
+    }
+    json out{{"ready", ready_ms_ >= 0}, {"uptime_ms", elapsed_ms()}, {"components", components}, {"warming", warming}};
+    out["time_to_ready_ms"] = ready_ms_ >= 0 ? json(ready_ms_) : json(nullptr);
+    out["time_to_first_task_ms"] = first_task_ms_ >= 0 ? json(first_task_ms_) : json(nullptr);
+    return out;
+}
+
+void Startup::record_first_task() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (first_task_seen_.exchange(true)) return;
+    first_task_ms_ = elapsed_ms();
+    time_to_first_task().set(first_task_ms_);
+    logger.info("first task accepted", {{"ms", first_task_ms_}});
+}
+
+} // namespace spectre
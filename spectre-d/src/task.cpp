@@ -0,0 +1,258 @@
+#include "spectre/task.h"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace spectre {
+
+namespace {
+using json = nlohmann::json;
+
+// Names are written once and never freed, so readers index the slot array
+// without taking the lock.
+struct TypeTable {
+    std::mutex mutex;
+    std::unordered_map<std::string, TaskType> ids;
+    std::array<std::atomic<const std::string*>, kMaxTaskTypes> names{};
+    TaskType next = 1;
+};
+
+TypeTable& type_table() {
+    static TypeTable* table = new TypeTable();
+    return *table;
+}
+
+const std::string kEmptyName;
+
+// Fills a Task straight from nlohmann's SAX events. Only "type", "target",
+// "id" and "options" are looked at; nested option values are re-emitted as
+// compact JSON text as they stream past.
+class TaskSax : public json::json_sax_t {
+public:
+    explicit TaskSax(Task& task) : task_(task) {}
+
+    bool null() override { return scalar("null", false); }
+    bool boolean(bool v) override { return scalar(v ? "true" : "false", false); }
+    bool number_integer(number_integer_t v) override { return scalar(std::to_string(v), false); }
+    bool number_unsigned(number_unsigned_t v) override { return scalar(std::to_string(v), false); }
+    bool number_float(number_float_t, const string_t& lexeme) override { return scalar(lexeme, false); }
+    bool string(string_t& v) override { return scalar(std::move(v), true); }
+    bool binary(binary_t&) override { return fail("binary values are not supported"); }
+
+    bool start_object(std::size_t) override { return open('{'); }
+    bool end_object() override { return close('}'); }
+    bool start_array(std::size_t) override {
+        if (depth_ == 0) return fail("task must be a JSON object");
+        return open('[');
+    }
+    bool end_array() override { return close(']'); }
+
+    bool key(string_t& k) override {
+        if (depth_ == 1) {
+            field_ = k == "type" ? Field::type
+                   : k == "target" ? Field::target
+                   : k == "id" ? Field::id
+                   : k == "options" ? Field::options
+                   : Field::other;
+        } else if (depth_ == 2 && field_ == Field::options) {
+            option_key_ = std::move(k);
+        } else if (capturing()) {
+            comma();
+            capture_ += json(k).dump();
+            capture_ += ':';
+            after_key_ = true;
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t position, const std::string&, const nlohmann::detail::exception& ex) override {
+        error_ = "invalid task JSON at byte " + std::to_string(position) + ": " + ex.what();
+        return false;
+    }
+
+    const std::string& error() const { return error_; }
+
+private:
+    enum class Field { other, type, target, id, options };
+
+    bool capturing() const { return depth_ > 2 && field_ == Field::options; }
+    bool is_string_field() const { return field_ == Field::type || field_ == Field::target || field_ == Field::id; }
+    static const char* field_name(Field f) { return f == Field::type ? "type" : f == Field::target ? "target" : "id"; }
+
+    void comma() {
+        if (after_key_) {
+            after_key_ = false;
+        } else if (!first_.empty()) {
+            if (!first_.back()) capture_ += ',';
+            first_.back() = false;
+        }
+    }
+
+    bool open(char bracket) {
+        if (depth_ == 0 && bracket != '{') return fail("task must be a JSON object");
+        if (depth_ == 1 && is_string_field()) {
+            return fail(std::string("task ") + field_name(field_) + " must be a string");
+        }
+        if (depth_ == 1 && field_ == Field::options && bracket != '{') return fail("task options must be an object");
+        if (capturing() || (depth_ == 2 && field_ == Field::options)) {
+            comma();
+            capture_ += bracket;
+            first_.push_back(true);
+        }
+        ++depth_;
+        return true;
+    }
+
+    bool close(char bracket) {
+        --depth_;
+        if (capturing() || (depth_ == 2 && field_ == Field::options)) {
+            capture_ += bracket;
+            first_.pop_back();
+            if (depth_ == 2) {
+                task_.options[option_key_] = std::move(capture_);
+                capture_.clear();
+            }
+        }
+        return true;
+    }
+
+    bool scalar(std::string text, bool is_string) {
+        if (depth_ == 0) return fail("task must be a JSON object");
+        if (depth_ == 1) {
+            if (is_string_field()) {
+                if (!is_string) return fail(std::string("task ") + field_name(field_) + " must be a string");
+                if (field_ == Field::type) task_.type = find_task_type(text);
+                else if (field_ == Field::target) task_.target = std::move(text);
+                else task_.id = std::move(text);
+            } else if (field_ == Field::options) {
+                return fail("task options must be an object");
+            }
+        } else if (depth_ == 2 && field_ == Field::options) {
+            task_.options[option_key_] = std::move(text);
+        } else if (capturing()) {
+            comma();
+            capture_ += is_string ? json(text).dump() : text;
+        }
+        return true;
+    }
+
+    bool fail(std::string message) {
+        error_ = std::move(message);
+        return false;
+    }
+
+    Task& task_;
+    std::size_t depth_ = 0;
+    Field field_ = Field::other;
+    std::string option_key_;
+    std::string capture_;
+    std::vector<bool> first_;
+    bool after_key_ = false;
+    std::string error_;
+};
+} // namespace
+
+TaskType intern_task_type(std::string_view name) {
+    if (name.empty()) return kNoTaskType;
+    auto& table = type_table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.ids.find(std::string(name));
+    if (it != table.ids.end()) return it->second;
+    if (table.next >= kMaxTaskTypes) return kNoTaskType;
+    TaskType id = table.next++;
+    auto* stored = new std::string(name);
+    table.names[id].store(stored, std::memory_order_release);
+    table.ids.emplace(*stored, id);
+    return id;
+}
+
+TaskType find_task_type(std::string_view name) {
+    if (name.empty()) return kNoTaskType;
+    static const TaskType unknown = intern_task_type("unknown");
+    auto& table = type_table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.ids.find(std::string(name));
+    return it != table.ids.end() ? it->second : unknown;
+}
+
+const std::string& task_type_name(TaskType type) {
+    if (type == kNoTaskType || type >= kMaxTaskTypes) return kEmptyName;
+    const std::string* name = type_table().names[type].load(std::memory_order_acquire);
+    return name ? *name : kEmptyName;
+}
+
+TargetUrl parse_target_url(std::string_view url) {
+    TargetUrl out;
+    std::size_t start = 0;
+    auto scheme_end = url.find("://");
+    if (scheme_end != std::string_view::npos) {
+        out.scheme = std::string(url.substr(0, scheme_end));
+        start = scheme_end + 3;
+    }
+    auto authority_end = url.find_first_of("/?#", start);
+    std::string_view authority = url.substr(start, authority_end == std::string_view::npos
+                                                       ? std::string_view::npos
+                                                       : authority_end - start);
+    auto at = authority.rfind('@');
+    if (at != std::string_view::npos) authority.remove_prefix(at + 1);
+    // A trailing :digits is the port, except inside a bracketed IPv6 literal.
+    auto colon = authority.rfind(':');
+    if (colon != std::string_view::npos && authority.find(']', colon) == std::string_view::npos) {
+        unsigned long port = 0;
+        bool digits = colon + 1 < authority.size();
+        for (char c : authority.substr(colon + 1)) {
+            if (c < '0' || c > '9') {
+                digits = false;
+                break;
+            }
+            port = port * 10 + static_cast<unsigned long>(c - '0');
+            if (port > 65535) {
+                digits = false;
+                break;
+            }
+        }
+        if (digits) out.port = static_cast<unsigned short>(port);
+        authority = authority.substr(0, colon);
+    }
+    out.host = std::string(authority);
+    if (authority_end == std::string_view::npos) return out;
+
+    std::string_view rest = url.substr(authority_end);
+    rest = rest.substr(0, rest.find('#'));
+    auto qpos = rest.find('?');
+    out.path = std::string(rest.substr(0, qpos));
+    if (qpos != std::string_view::npos) out.query = std::string(rest.substr(qpos + 1));
+    return out;
+}
+
+Task parse_task(std::string raw) {
+    Task task;
+    TaskSax sax(task);
+    if (!json::sax_parse(raw, &sax)) {
+        throw std::invalid_argument(sax.error().empty() ? "invalid task" : sax.error());
+    }
+    task.url = parse_target_url(task.target);
+    task.raw = std::move(raw);
+    return task;
+}
+
+Task make_task(std::string_view type, std::string target, std::string id, std::map<std::string, std::string> options) {
+    Task task;
+    task.type = intern_task_type(type);
+    task.target = std::move(target);
+    task.url = parse_target_url(task.target);
+    task.id = std::move(id);
+    task.options = std::move(options);
+
+    json wire{{"type", type}, {"target", task.target}};
+    if (!task.id.empty()) wire["id"] = task.id;
+    if (!task.options.empty()) wire["options"] = task.options;
+    task.raw = wire.dump();
+    return task;
+}
+
+} // namespace spectre
@@ -0,0 +1,81 @@
+#include "spectre/task_memory.h"
+#include "spectre/metrics.h"
+#include <cstdint>
+#include <cstdlib>
+
+namespace spectre {
+
+namespace {
+std::size_t arena_capacity() {
+    static const std::size_t bytes = [] {
+        const char* kb = std::getenv("SPECTRE_TASK_ARENA_KB");
+        return (kb ? std::strtoul(kb, nullptr, 10) : 1024) * 1024;
+    }();
+    return bytes;
+}
+
+Counter& overflow_bytes() {
+    static Counter& counter = MetricsRegistry::get_instance().counter(
+        "spectre_task_arena_overflow_bytes_total",
+        "Task temporaries that did not fit in the per-task arena and went to the pool.");
+    return counter;
+}
+
+struct ThreadArena {
+    std::pmr::unsynchronized_pool_resource pool;
+    TaskArena arena{&pool, arena_capacity()};
+    int depth = 0;
+};
+
+thread_local std::unique_ptr<ThreadArena> tls_arena;
+} // namespace
+
+TaskArena::TaskArena(std::pmr::memory_resource* fallback, std::size_t capacity)
+    : fallback_(fallback), capacity_(capacity) {}
+
+void TaskArena::reset() {
+    cur_ = begin_;
+    overflow_ = 0;
+}
+
+void* TaskArena::do_allocate(std::size_t bytes, std::size_t align) {
+    // The block is only paid for by threads that use it.
+    if (!block_ && capacity_ > 0) {
+        block_ = std::make_unique<std::byte[]>(capacity_);
+        begin_ = cur_ = block_.get();
+        end_ = begin_ + capacity_;
+    }
+    auto addr = reinterpret_cast<std::uintptr_t>(cur_);
+    auto aligned = (addr + align - 1) & ~(static_cast<std::uintptr_t>(align) - 1);
+    if (cur_ && aligned + bytes <= reinterpret_cast<std::uintptr_t>(end_)) {
+        cur_ = reinterpret_cast<std::byte*>(aligned + bytes);
+        return reinterpret_cast<void*>(aligned);
+    }
+    overflow_ += bytes;
+    return fallback_->allocate(bytes, align);
+}
+
+void TaskArena::do_deallocate(void* p, std::size_t bytes, std::size_t align) {
+    auto* b = static_cast<std::byte*>(p);
+    if (b >= begin_ && b < end_) return;
+    fallback_->deallocate(p, bytes, align);
+}
+
+TaskArenaScope::TaskArenaScope() {
+    if (!tls_arena) tls_arena = std::make_unique<ThreadArena>();
+    ++tls_arena->depth;
+}
+
+TaskArenaScope::~TaskArenaScope() {
+    if (--tls_arena->depth > 0) return;
+    if (std::size_t overflow = tls_arena->arena.overflow_bytes()) overflow_bytes().inc(overflow);
+    tls_arena->arena.reset();
+    tls_arena->pool.release();
+}
+
+std::pmr::memory_resource* task_memory() {
+    if (tls_arena && tls_arena->depth > 0) return &tls_arena->arena;
+    return std::pmr::new_delete_resource();
+}
+
+} // namespace spectre
@@ -1,27 +1,55 @@
 #include "spectre/tor_proxy.h"
+#include "spectre/log.h"
+#include "spectre/startup.h"
 #include <boost/asio.hpp>
+#include <chrono>
+#include <cstdlib>
 
 namespace spectre { 
 
+namespace {
+const LogSource& logger = Logger::get_instance().source("tor");
+constexpr auto kConnectTimeout = std::chrono::seconds(2);
+} // namespace
+
 TorProxy& TorProxy::get_instance() {
     static TorProxy instance;
     return instance;
 }
 
-TorProxy::TorProxy() {
-    try {
-        boost::asio::io_context io_context;
-        boost::asio::ip::tcp::socket socket(io_context);
-        boost::asio::ip::tcp::resolver resolver(io_context);
-        boost::asio::connect(socket, resolver.resolve("127.0.0.1", "9050"));
-        available_ = true;
-    } catch (const std::exception&) {
-        available_ = false;
-    }
+void TorProxy::start_probe() {
+    std::call_once(started_, [this] {
+        Startup::get_instance().pending("tor", false);
+        available_ = std::async(std::launch::async, [] {
+            bool ok = probe();
+            if (ok) {
+                logger.info("Tor proxy available, anonymity is ON", {{"proxy", "127.0.0.1:9050"}});
+            } else {
+                logger.warn("Tor proxy NOT available, anonymity is OFF");
+            }
+            Startup::get_instance().ready("tor");
+            return ok;
+        }).share();
+    });
 }
 
 bool TorProxy::is_available() {
-    return available_;
+    start_probe();
+    return available_.get();
+}
+
+bool TorProxy::probe() {
+    if (std::getenv("SPECTRE_DISABLE_TOR")) {
+        return false;
+    }
+    // A filtered port would leave a blocking connect hanging for minutes.
+    boost::asio::io_context io_context;
+    boost::asio::ip::tcp::socket socket(io_context);
+    boost::system::error_code result = boost::asio::error::timed_out;
+    socket.async_connect({boost::asio::ip::make_address("127.0.0.1"), 9050},
+                         [&result](const boost::system::error_code& ec) { result = ec; });
+    io_context.run_for(kConnectTimeout);
+    return !result;
 }
 
-} 
\ No newline at end of file
+}
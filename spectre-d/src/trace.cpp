@@ -0,0 +1,205 @@
+#include "spectre/trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace spectre {
+
+namespace trace_detail {
+std::atomic<bool> enabled{false};
+} // namespace trace_detail
+
+namespace {
+constexpr std::size_t kEventsPerThread = 8192;
+// Spans of exited threads kept for export, oldest dropped first. A full
+// buffer is 1 MiB, so this is the last few threads' worth.
+constexpr std::size_t kMaxRetiredBytes = 8u << 20;
+
+struct Event {
+    std::uint64_t start_ns;
+    std::uint64_t dur_ns;
+    char name[32];
+    char category[16];
+    char detail[64];
+};
+
+template <std::size_t N>
+void copy_truncated(char (&dst)[N], std::string_view src) {
+    std::size_t n = std::min(src.size(), N - 1);
+    std::memcpy(dst, src.data(), n);
+    dst[n] = '\0';
+}
+
+struct ThreadBuffer {
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::size_t next = 0;
+    bool wrapped = false;
+    std::uint32_t tid = static_cast<std::uint32_t>(::syscall(SYS_gettid));
+    // Position in Impl::live_ while the thread runs; guarded by Impl::mutex_.
+    std::size_t slot = 0;
+};
+} // namespace
+
+class Tracer::Impl {
+public:
+    std::mutex mutex_;
+    // Buffers of running threads, in no particular order.
+    std::vector<std::shared_ptr<ThreadBuffer>> live_;
+    // Buffers of exited threads, oldest first.
+    std::deque<std::shared_ptr<ThreadBuffer>> retired_;
+    std::size_t retired_bytes_ = 0;
+
+    std::shared_ptr<ThreadBuffer> register_buffer() {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->events.resize(kEventsPerThread);
+        std::lock_guard<std::mutex> lock(mutex_);
+        buffer->slot = live_.size();
+        live_.push_back(buffer);
+        return buffer;
+    }
+
+    void retire(const std::shared_ptr<ThreadBuffer>& buffer) {
+        std::size_t bytes;
+        {
+            // A thread that never filled its buffer keeps only what it used.
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            if (!buffer->wrapped) {
+                buffer->events.resize(buffer->next);
+                buffer->events.shrink_to_fit();
+            }
+            bytes = buffer->events.capacity() * sizeof(Event);
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        live_.back()->slot = buffer->slot;
+        std::swap(live_[buffer->slot], live_.back());
+        live_.pop_back();
+        if (bytes == 0) return;
+        retired_.push_back(buffer);
+        retired_bytes_ += bytes;
+        while (retired_bytes_ > kMaxRetiredBytes) {
+            retired_bytes_ -= retired_.front()->events.capacity() * sizeof(Event);
+            retired_.pop_front();
+        }
+    }
+
+    std::vector<std::shared_ptr<ThreadBuffer>> snapshot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::shared_ptr<ThreadBuffer>> all(retired_.begin(), retired_.end());
+        all.insert(all.end(), live_.begin(), live_.end());
+        return all;
+    }
+};
+
+namespace trace_detail {
+struct ThreadBufferHolder {
+    std::shared_ptr<ThreadBuffer> buffer;
+    ~ThreadBufferHolder() {
+        if (buffer) Tracer::get_instance().impl_->retire(buffer);
+    }
+};
+} // namespace trace_detail
+
+namespace {
+thread_local trace_detail::ThreadBufferHolder tls_buffer;
+} // namespace
+
+std::uint64_t trace_now() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void trace_complete(std::string_view name, std::string_view category, std::uint64_t start_ns,
+                    std::uint64_t end_ns, std::string_view detail) {
+    if (!tracing_enabled()) return;
+    if (!tls_buffer.buffer) tls_buffer.buffer = Tracer::get_instance().impl_->register_buffer();
+    ThreadBuffer& b = *tls_buffer.buffer;
+    std::lock_guard<std::mutex> lock(b.mutex);
+    // Retired and trimmed: a span ending while the thread's locals unwind.
+    if (b.next == b.events.size()) return;
+    Event& e = b.events[b.next];
+    e.start_ns = start_ns;
+    e.dur_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+    copy_truncated(e.name, name);
+    copy_truncated(e.category, category);
+    copy_truncated(e.detail, detail);
+    if (++b.next == b.events.size()) {
+        b.next = 0;
+        b.wrapped = true;
+    }
+}
+
+Tracer::Tracer() : impl_(std::make_unique<Impl>()) {}
+Tracer::~Tracer() = default;
+
+Tracer& Tracer::get_instance() {
+    static Tracer* instance = new Tracer();
+    return *instance;
+}
+
+void Tracer::set_enabled(bool on) {
+    trace_detail::enabled.store(on, std::memory_order_relaxed);
+}
+
+void Tracer::clear() {
+    for (auto& b : impl_->snapshot()) {
+        std::lock_guard<std::mutex> buffer_lock(b->mutex);
+        b->next = 0;
+        b->wrapped = false;
+    }
+}
+
+void Tracer::write_chrome_trace(std::ostream& out) {
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers = impl_->snapshot();
+    const auto pid = static_cast<long>(::getpid());
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    std::vector<Event> events;
+    for (auto& b : buffers) {
+        std::uint32_t tid;
+        {
+            std::lock_guard<std::mutex> lock(b->mutex);
+            tid = b->tid;
+            if (b->wrapped) {
+                events.assign(b->events.begin() + b->next, b->events.end());
+                events.insert(events.end(), b->events.begin(), b->events.begin() + b->next);
+            } else {
+                events.assign(b->events.begin(), b->events.begin() + b->next);
+            }
+        }
+        for (const Event& e : events) {
+            nlohmann::json event = {
+                {"name", e.name},
+                {"cat", e.category},
+                {"ph", "X"},
+                {"ts", e.start_ns / 1000.0},
+                {"dur", e.dur_ns / 1000.0},
+                {"pid", pid},
+                {"tid", tid},
+            };
+            if (e.detail[0]) event["args"] = {{"detail", e.detail}};
+            out << (first ? "" : ",") << '\n' << event.dump(-1, ' ', false, nlohmann::json::error_handler_t::replace);
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+}
+
+std::string Tracer::dump_to_file(const std::string& dir) {
+    std::string path = dir + "/spectre-trace-" + std::to_string(::getpid()) + "-" +
+                       std::to_string(std::time(nullptr)) + ".json";
+    std::ofstream out(path);
+    if (!out) return "";
+    write_chrome_trace(out);
+    return out ? path : "";
+}
+
+} // namespace spectre
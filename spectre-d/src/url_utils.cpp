@@ -0,0 +1,119 @@
+#include "spectre/url_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <regex>
+
+namespace spectre {
+
+std::string percent_decode(std::string_view in) {
+    std::string out;
+    out.reserve(in.size());
+    for (std::size_t i = 0; i < in.size(); ++i) {
+        if (in[i] == '+') {
+            out += ' ';
+        } else if (in[i] == '%' && i + 2 < in.size() && std::isxdigit(static_cast<unsigned char>(in[i + 1])) &&
+                   std::isxdigit(static_cast<unsigned char>(in[i + 2]))) {
+            out += static_cast<char>(std::stoi(std::string(in.substr(i + 1, 2)), nullptr, 16));
+            i += 2;
+        } else {
+            out += in[i];
+        }
+    }
+    return out;
+}
+
+std::map<std::string, std::string> parse_query(std::string_view query) {
+    std::map<std::string, std::string> params;
+    while (!query.empty()) {
+        auto amp = query.find('&');
+        std::string_view pair = query.substr(0, amp);
+        auto eq = pair.find('=');
+        std::string key = percent_decode(pair.substr(0, eq));
+        std::string value = eq == std::string_view::npos ? std::string() : percent_decode(pair.substr(eq + 1));
+        if (!key.empty()) params[key] = value;
+        if (amp == std::string_view::npos) break;
+        query.remove_prefix(amp + 1);
+    }
+    return params;
+}
+
+namespace {
+void replace_query_param(std::string& out, std::string_view url, std::string_view param, std::string_view value) {
+    out.reserve(url.size() + value.size());
+    auto query = url.find('?');
+    auto fragment = url.find('#');
+    if (query == std::string_view::npos || (fragment != std::string_view::npos && fragment < query)) {
+        out.append(url);
+        return;
+    }
+    std::size_t end = fragment == std::string_view::npos ? url.size() : fragment;
+    out.append(url.substr(0, query + 1));
+    std::size_t pos = query + 1;
+    while (pos <= end) {
+        std::size_t amp = url.find('&', pos);
+        if (amp == std::string_view::npos || amp > end) amp = end;
+        std::string_view pair = url.substr(pos, amp - pos);
+        if (pair.size() > param.size() && pair[param.size()] == '=' && pair.substr(0, param.size()) == param) {
+            out.append(param);
+            out += '=';
+            out.append(value);
+        } else {
+            out.append(pair);
+        }
+        if (amp == end) break;
+        out += '&';
+        pos = amp + 1;
+    }
+    out.append(url.substr(end));
+}
+} // namespace
+
+std::pmr::string url_encode(std::string_view in, std::pmr::memory_resource* mr) {
+    static const char* hex = "0123456789ABCDEF";
+    std::pmr::string out(mr);
+    out.reserve(in.size() * 3);
+    for (unsigned char c : in) {
+        if (std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~') {
+            out += static_cast<char>(c);
+        } else {
+            out += '%';
+            out += hex[c >> 4];
+            out += hex[c & 0xf];
+        }
+    }
+    return out;
+}
+
+std::string with_query_param(std::string_view url, std::string_view param, std::string_view value) {
+    std::string out;
+    replace_query_param(out, url, param, value);
+    return out;
+}
+
+std::pmr::vector<std::pmr::string> query_param_names(std::string_view url, std::pmr::memory_resource* mr) {
+    std::pmr::vector<std::pmr::string> names(mr);
+    auto query = url.find('?');
+    if (query == std::string_view::npos) return names;
+    std::string_view rest = url.substr(query + 1);
+    rest = rest.substr(0, rest.find('#'));
+    while (!rest.empty()) {
+        auto amp = rest.find('&');
+        std::string_view key = rest.substr(0, amp);
+        key = key.substr(0, key.find('='));
+        if (!key.empty() && std::find(names.begin(), names.end(), key) == names.end()) names.emplace_back(key);
+        if (amp == std::string_view::npos) break;
+        rest.remove_prefix(amp + 1);
+    }
+    return names;
+}
+
+std::vector<std::string> extract_links(const std::string& html) {
+    static const std::regex link_regex(R"(<a\s+(?:[^>]*?\s+)?href=\"([^\"]+)\")");
+    std::vector<std::string> links;
+    for (std::sregex_iterator it(html.begin(), html.end(), link_regex), end; it != end; ++it) {
+        links.push_back((*it)[1].str());
+    }
+    return links;
+}
+
+} // namespace spectre
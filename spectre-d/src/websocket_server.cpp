@@ -1,24 +1,42 @@
 #include "spectre/websocket_server.h"
+#include "spectre/metrics.h"
+#include "spectre/log.h"
 #include <boost/asio.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
-#include <iostream>
 #include <thread>
 #include <vector>
+#include <deque>
 #include <mutex>
+#include <algorithm>
 
 using boost::asio::ip::tcp;
 namespace websocket = boost::beast::websocket;
 
 namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("websocket");
+} // namespace
+
 class WebSocketServer::Impl {
     boost::asio::io_context io_;
     tcp::acceptor acceptor_;
     std::thread worker_;
     MessageHandler handler_;
-    std::vector<std::shared_ptr<websocket::stream<tcp::socket>>> clients_;
+    struct Client {
+        explicit Client(tcp::socket socket) : ws(std::move(socket)) {}
+        websocket::stream<tcp::socket> ws;
+        std::deque<std::shared_ptr<const std::string>> outbox;
+        bool writing = false;
+    };
+
+    std::vector<std::shared_ptr<Client>> clients_;
     std::mutex clients_mutex_;
     bool running_ = false;
+    Gauge& connected_ = MetricsRegistry::get_instance().gauge("spectre_websocket_clients",
+                                                              "Connected websocket clients.");
+    Gauge& backlog_ = MetricsRegistry::get_instance().gauge("spectre_websocket_backlog_messages",
+                                                            "Messages queued for websocket clients but not yet written.");
 
 public:
     Impl(int port) : acceptor_(io_, tcp::endpoint(tcp::v4(), port)) {}
@@ -27,7 +45,7 @@ public:
         running_ = true;
         start_accept();
         worker_ = std::thread([this] { io_.run(); });
-        std::cout << "[websocket] server started on port 8889" << std::endl;
+        logger.info("server started", {{"port", 8889}});
     }
 
     void stop() {
@@ -35,31 +53,33 @@ public:
         io_.stop();
         {
             std::lock_guard<std::mutex> lock(clients_mutex_);
+            connected_.add(-static_cast<std::int64_t>(clients_.size()));
             clients_.clear();
         }
         if (worker_.joinable()) worker_.join();
-        std::cout << "[websocket] server stopped" << std::endl;
+        logger.info("server stopped");
     }
 
     void broadcast(const std::string &message) {
-        io_.post([this, message] {
+        auto payload = std::make_shared<const std::string>(message);
+        io_.post([this, payload] {
             std::lock_guard<std::mutex> lock(clients_mutex_);
             for (auto it = clients_.begin(); it != clients_.end();) {
-                auto ws = *it;
-                if (!ws->is_open()) {
+                auto client = *it;
+                if (!client->ws.is_open()) {
                     it = clients_.erase(it);
+                    connected_.add(-1);
                     continue;
                 }
-                try {
-                    ws->text(true);
-                    ws->async_write(boost::asio::buffer(message), [ws](boost::system::error_code, std::size_t) {});
-                } catch (...) {
-                    ws->next_layer().close();
+                client->outbox.push_back(payload);
+                backlog_.add(1);
+                if (!client->writing) {
+                    write_next(client);
                 }
                 ++it;
             }
         });
-        std::cout << "[websocket] broadcast: " << message << std::endl;
+        logger.trace("broadcast", {{"bytes", message.size()}});
     }
 
     void set_message_handler(MessageHandler h) { handler_ = h; }
@@ -75,39 +95,67 @@ private:
         });
     }
 
+    // Beast allows only one outstanding write per stream, so each client drains
+    // its own queue; the queue length is what the backlog gauge reports.
+    void write_next(std::shared_ptr<Client> client) {
+        client->writing = true;
+        client->ws.text(true);
+        client->ws.async_write(boost::asio::buffer(*client->outbox.front()),
+            [this, client](boost::system::error_code ec, std::size_t) {
+                client->outbox.pop_front();
+                backlog_.add(-1);
+                if (ec) {
+                    backlog_.add(-static_cast<std::int64_t>(client->outbox.size()));
+                    client->outbox.clear();
+                    client->writing = false;
+                    return;
+                }
+                if (client->outbox.empty()) {
+                    client->writing = false;
+                } else {
+                    write_next(client);
+                }
+            });
+    }
+
     void handle_connection(std::shared_ptr<tcp::socket> socket) {
-        auto ws = std::make_shared<websocket::stream<tcp::socket>>(std::move(*socket));
-        ws->set_option(websocket::stream_base::timeout::suggested(boost::beast::role_type::server));
-        ws->set_option(websocket::stream_base::decorator([](websocket::response_type &res) {
+        auto client = std::make_shared<Client>(std::move(*socket));
+        client->ws.set_option(websocket::stream_base::timeout::suggested(boost::beast::role_type::server));
+        client->ws.set_option(websocket::stream_base::decorator([](websocket::response_type &res) {
             res.set(boost::beast::http::field::server, std::string("spectre-d"));
         }));
 
-        ws->async_accept([this, ws](boost::system::error_code ec) {
+        client->ws.async_accept([this, client](boost::system::error_code ec) {
             if (ec) {
                 return;
             }
             {
                 std::lock_guard<std::mutex> lock(clients_mutex_);
-                clients_.push_back(ws);
+                clients_.push_back(client);
             }
-            std::cout << "[websocket] client connected" << std::endl;
-            read_loop(ws);
+            connected_.add(1);
+            logger.debug("client connected");
+            read_loop(client);
         });
     }
 
-    void read_loop(std::shared_ptr<websocket::stream<tcp::socket>> ws) {
+    void read_loop(std::shared_ptr<Client> client) {
         auto buffer = std::make_shared<boost::beast::flat_buffer>();
-        ws->async_read(*buffer, [this, ws, buffer](boost::system::error_code ec, std::size_t) {
+        client->ws.async_read(*buffer, [this, client, buffer](boost::system::error_code ec, std::size_t) {
             if (ec) {
                 std::lock_guard<std::mutex> lock(clients_mutex_);
-                clients_.erase(std::remove(clients_.begin(), clients_.end(), ws), clients_.end());
+                auto it = std::find(clients_.begin(), clients_.end(), client);
+                if (it != clients_.end()) {
+                    clients_.erase(it);
+                    connected_.add(-1);
+                }
                 return;
             }
             if (handler_) {
                 auto data = boost::beast::buffers_to_string(buffer->data());
                 handler_(data);
             }
-            read_loop(ws);
+            read_loop(client);
         });
     }
 };
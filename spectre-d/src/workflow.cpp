@@ -0,0 +1,374 @@
+#include "spectre/workflow.h"
+#include "spectre/log.h"
+#include "spectre/metrics.h"
+#include "spectre/scan_registry.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <set>
+#include <stdexcept>
+
+namespace spectre {
+namespace {
+const LogSource& logger = Logger::get_instance().source("workflow");
+
+constexpr std::size_t kMaxStages = 32;
+constexpr std::size_t kDefaultStageLimit = 1000;
+constexpr std::size_t kFinishedRetained = 1000;
+
+std::int64_t unix_now() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::size_t default_concurrency() {
+    static const std::size_t value = [] {
+        const char* env = std::getenv("SPECTRE_WORKFLOW_CONCURRENCY");
+        std::size_t n = env ? std::strtoul(env, nullptr, 10) : 8;
+        return n == 0 ? std::size_t{8} : n;
+    }();
+    return value;
+}
+
+Gauge& waiting_tasks() {
+    static Gauge& gauge = MetricsRegistry::get_instance().gauge(
+        "spectre_workflow_tasks_waiting", "Workflow tasks held back by their workflow's concurrency cap.");
+    return gauge;
+}
+
+std::size_t positive(const json& spec, const char* key, std::size_t fallback) {
+    auto it = spec.find(key);
+    if (it == spec.end()) return fallback;
+    if (!it->is_number_unsigned() || it->get<std::size_t>() == 0) {
+        throw std::invalid_argument(std::string(key) + " must be a positive integer");
+    }
+    return it->get<std::size_t>();
+}
+
+std::vector<std::string> strings(const json& spec, const char* key) {
+    std::vector<std::string> out;
+    auto it = spec.find(key);
+    if (it == spec.end()) return out;
+    if (it->is_string()) return {it->get<std::string>()};
+    if (!it->is_array()) throw std::invalid_argument(std::string(key) + " must be a string or an array of strings");
+    for (const auto& item : *it) {
+        if (!item.is_string()) throw std::invalid_argument(std::string(key) + " must contain only strings");
+        out.push_back(item.get<std::string>());
+    }
+    return out;
+}
+} // namespace
+
+struct WorkflowScheduler::Stage {
+    std::string name;
+    std::vector<std::string> types;
+    std::vector<std::size_t> after;
+    // Stages that take this one's outputs as items.
+    std::vector<std::size_t> downstream;
+    // "url", "finding", or empty for a stage that runs once.
+    std::string for_each;
+    std::set<std::string> vuln_types;
+    std::map<std::string, std::string> options;
+    std::size_t limit = kDefaultStageLimit;
+
+    std::set<std::string> items;
+    std::size_t dropped = 0;
+    std::size_t waiting = 0;
+    std::size_t running = 0;
+    std::size_t done = 0;
+    std::size_t failed = 0;
+    bool launched = false;
+    bool finished = false;
+    std::vector<std::string> scans;
+};
+
+struct WorkflowScheduler::Workflow {
+    std::string id;
+    std::string target;
+    std::size_t max_concurrency = 0;
+    // In dependency order: every stage comes after the ones it waits for.
+    std::vector<Stage> stages;
+    std::deque<Queued> waiting;
+    std::size_t running = 0;
+    std::int64_t created_at = 0;
+    std::int64_t finished_at = 0;
+    bool finished = false;
+};
+
+WorkflowScheduler::WorkflowScheduler(Dispatcher& dispatcher) : dispatcher_(dispatcher) {
+    set_scan_output_sink([this](const std::string& scan_id, const std::string& kind, const json& value) {
+        on_output(scan_id, kind, value);
+    });
+}
+
+WorkflowScheduler::~WorkflowScheduler() {
+    // Dispatcher threads call on_output and on_done until they are joined,
+    // even when an exception unwinds past the normal shutdown.
+    dispatcher_.stop();
+    set_scan_output_sink(nullptr);
+}
+
+std::string WorkflowScheduler::submit(const json& spec) {
+    if (!spec.is_object()) throw std::invalid_argument("workflow must be an object");
+    auto workflow = std::make_shared<Workflow>();
+    auto target = spec.find("target");
+    if (target == spec.end() || !target->is_string() || target->get<std::string>().empty()) {
+        throw std::invalid_argument("missing target");
+    }
+    workflow->target = target->get<std::string>();
+    workflow->max_concurrency = positive(spec, "max_concurrency", default_concurrency());
+
+    auto stages = spec.find("stages");
+    if (stages == spec.end() || !stages->is_array() || stages->empty()) {
+        throw std::invalid_argument("stages must be a non-empty array");
+    }
+    if (stages->size() > kMaxStages) throw std::invalid_argument("too many stages");
+
+    auto plugin_names = dispatcher_.plugin_names();
+    std::set<std::string> plugins(plugin_names.begin(), plugin_names.end());
+    std::vector<Stage> parsed;
+    std::map<std::string, std::size_t> by_name;
+    std::vector<std::vector<std::string>> after_names;
+    for (const auto& s : *stages) {
+        if (!s.is_object()) throw std::invalid_argument("each stage must be an object");
+        Stage stage;
+        stage.name = s.value("name", "");
+        if (stage.name.empty()) throw std::invalid_argument("stage without a name");
+        if (!by_name.emplace(stage.name, parsed.size()).second) {
+            throw std::invalid_argument("duplicate stage " + stage.name);
+        }
+        stage.types = strings(s, "types");
+        for (auto& type : strings(s, "type")) stage.types.push_back(std::move(type));
+        if (stage.types.empty()) throw std::invalid_argument("stage " + stage.name + " has no type");
+        for (const auto& type : stage.types) {
+            if (!plugins.count(type)) throw std::invalid_argument("stage " + stage.name + ": no plugin " + type);
+        }
+        stage.for_each = s.value("for_each", "");
+        if (!stage.for_each.empty() && stage.for_each != "url" && stage.for_each != "finding") {
+            throw std::invalid_argument("stage " + stage.name + ": for_each must be \"url\" or \"finding\"");
+        }
+        auto vuln_types = strings(s, "vuln_types");
+        stage.vuln_types.insert(vuln_types.begin(), vuln_types.end());
+        if (auto options = s.find("options"); options != s.end()) {
+            if (!options->is_object()) throw std::invalid_argument("stage " + stage.name + ": options must be an object");
+            for (const auto& [key, value] : options->items()) {
+                stage.options[key] = value.is_string() ? value.get<std::string>() : value.dump();
+            }
+        }
+        stage.limit = positive(s, "limit", kDefaultStageLimit);
+        after_names.push_back(strings(s, "after"));
+        if (!stage.for_each.empty() && after_names.back().empty()) {
+            throw std::invalid_argument("stage " + stage.name + ": for_each needs an upstream stage in after");
+        }
+        parsed.push_back(std::move(stage));
+    }
+
+    // Kahn's algorithm; whatever is left over sits on a cycle.
+    std::size_t n = parsed.size();
+    std::vector<std::vector<std::size_t>> deps(n);
+    std::vector<std::size_t> pending(n, 0);
+    std::vector<std::vector<std::size_t>> dependents(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (const auto& name : after_names[i]) {
+            auto it = by_name.find(name);
+            if (it == by_name.end()) throw std::invalid_argument("stage " + parsed[i].name + ": unknown stage " + name);
+            if (std::find(deps[i].begin(), deps[i].end(), it->second) != deps[i].end()) continue;
+            deps[i].push_back(it->second);
+            dependents[it->second].push_back(i);
+            ++pending[i];
+        }
+    }
+    std::vector<std::size_t> order;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (pending[i] == 0) order.push_back(i);
+    }
+    for (std::size_t head = 0; head < order.size(); ++head) {
+        for (std::size_t next : dependents[order[head]]) {
+            if (--pending[next] == 0) order.push_back(next);
+        }
+    }
+    if (order.size() != n) throw std::invalid_argument("stages form a cycle");
+
+    std::vector<std::size_t> position(n);
+    for (std::size_t i = 0; i < n; ++i) position[order[i]] = i;
+    for (std::size_t old : order) {
+        Stage stage = std::move(parsed[old]);
+        for (std::size_t dep : deps[old]) stage.after.push_back(position[dep]);
+        workflow->stages.push_back(std::move(stage));
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t dep : workflow->stages[i].after) workflow->stages[dep].downstream.push_back(i);
+    }
+
+    workflow->id = ScanRegistry::new_id();
+    workflow->created_at = unix_now();
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        workflows_[workflow->id] = workflow;
+        tasks = advance(workflow);
+    }
+    logger.info("workflow started",
+                {{"workflow", workflow->id}, {"target", workflow->target}, {"stages", n},
+                 {"max_concurrency", workflow->max_concurrency}});
+    dispatch(std::move(tasks));
+    return workflow->id;
+}
+
+void WorkflowScheduler::add_item(Workflow& workflow, std::size_t index, const std::string& key,
+                                 const std::string& target, std::map<std::string, std::string> options) {
+    Stage& stage = workflow.stages[index];
+    if (stage.finished || stage.items.count(key)) return;
+    if (stage.items.size() >= stage.limit) {
+        ++stage.dropped;
+        return;
+    }
+    stage.items.insert(key);
+    for (const auto& [name, value] : stage.options) options.emplace(name, value);
+    for (const auto& type : stage.types) {
+        workflow.waiting.push_back({index, type, target, options});
+        ++stage.waiting;
+        waiting_tasks().add(1);
+    }
+}
+
+std::vector<Task> WorkflowScheduler::advance(const std::shared_ptr<Workflow>& workflow) {
+    auto& stages = workflow->stages;
+    // One pass suffices: a stage's upstream stages come before it.
+    for (std::size_t i = 0; i < stages.size(); ++i) {
+        Stage& stage = stages[i];
+        if (stage.finished) continue;
+        bool upstream_done = std::all_of(stage.after.begin(), stage.after.end(),
+                                         [&](std::size_t dep) { return stages[dep].finished; });
+        if (!upstream_done) continue;
+        if (stage.for_each.empty() && !stage.launched) {
+            stage.launched = true;
+            add_item(*workflow, i, workflow->target, workflow->target, {});
+        }
+        if (stage.waiting == 0 && stage.running == 0) {
+            stage.finished = true;
+            logger.debug("stage finished", {{"workflow", workflow->id}, {"stage", stage.name},
+                                            {"done", stage.done}, {"failed", stage.failed}});
+        }
+    }
+
+    std::vector<Task> tasks;
+    auto& registry = ScanRegistry::get_instance();
+    while (workflow->running < workflow->max_concurrency && !workflow->waiting.empty()) {
+        Queued next = std::move(workflow->waiting.front());
+        workflow->waiting.pop_front();
+        waiting_tasks().add(-1);
+        Stage& stage = stages[next.stage];
+        --stage.waiting;
+        ++stage.running;
+        ++workflow->running;
+        std::string id = registry.create(next.type, next.target);
+        stage.scans.push_back(id);
+        scans_[id] = {workflow, next.stage};
+        tasks.push_back(make_task(next.type, std::move(next.target), id, std::move(next.options)));
+    }
+
+    if (!workflow->finished &&
+        std::all_of(stages.begin(), stages.end(), [](const Stage& s) { return s.finished; })) {
+        workflow->finished = true;
+        workflow->finished_at = unix_now();
+        logger.info("workflow finished", {{"workflow", workflow->id}, {"target", workflow->target}});
+        finished_.push_back(workflow->id);
+        while (finished_.size() > kFinishedRetained) {
+            workflows_.erase(finished_.front());
+            finished_.pop_front();
+        }
+    }
+    return tasks;
+}
+
+void WorkflowScheduler::dispatch(std::vector<Task> tasks) {
+    for (auto& task : tasks) {
+        dispatcher_.submit(std::move(task), [this](const Task& done, bool ok) { on_done(done.id, ok); });
+    }
+}
+
+void WorkflowScheduler::on_output(const std::string& scan_id, const std::string& kind, const json& value) {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = scans_.find(scan_id);
+        if (it == scans_.end()) return;
+        auto workflow = it->second.workflow;
+        std::size_t before = workflow->waiting.size();
+        for (std::size_t index : workflow->stages[it->second.stage].downstream) {
+            const Stage& next = workflow->stages[index];
+            if (next.for_each != kind) continue;
+            if (kind == "url" && value.is_string()) {
+                const auto& url = value.get_ref<const std::string&>();
+                add_item(*workflow, index, url, url, {});
+            } else if (kind == "finding" && value.is_object()) {
+                std::string target = value.value("target", "");
+                std::string vuln_type = value.value("vuln_type", "");
+                if (target.empty() || (!next.vuln_types.empty() && !next.vuln_types.count(vuln_type))) continue;
+                add_item(*workflow, index, vuln_type + " " + target, target,
+                         {{"vuln_type", vuln_type}, {"finding_scan", scan_id}});
+            }
+        }
+        if (workflow->waiting.size() == before) return;
+        tasks = advance(workflow);
+    }
+    dispatch(std::move(tasks));
+}
+
+void WorkflowScheduler::on_done(const std::string& scan_id, bool ok) {
+    std::vector<Task> tasks;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = scans_.find(scan_id);
+        if (it == scans_.end()) return;
+        auto workflow = std::move(it->second.workflow);
+        Stage& stage = workflow->stages[it->second.stage];
+        scans_.erase(it);
+        --stage.running;
+        ++(ok ? stage.done : stage.failed);
+        --workflow->running;
+        tasks = advance(workflow);
+    }
+    dispatch(std::move(tasks));
+}
+
+std::optional<json> WorkflowScheduler::status(const std::string& id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = workflows_.find(id);
+    if (it == workflows_.end()) return std::nullopt;
+    return to_json(*it->second);
+}
+
+json WorkflowScheduler::to_json(const Workflow& workflow) const {
+    json stages = json::array();
+    for (const auto& stage : workflow.stages) {
+        json after = json::array();
+        for (std::size_t dep : stage.after) after.push_back(workflow.stages[dep].name);
+        const char* state = stage.finished ? "done"
+                            : (stage.running || stage.waiting || stage.done || stage.failed) ? "running"
+                                                                                               : "waiting";
+        stages.push_back({{"name", stage.name},
+                          {"types", stage.types},
+                          {"after", after},
+                          {"for_each", stage.for_each.empty() ? json() : json(stage.for_each)},
+                          {"state", state},
+                          {"items", stage.items.size()},
+                          {"dropped", stage.dropped},
+                          {"tasks", {{"waiting", stage.waiting}, {"running", stage.running},
+                                     {"done", stage.done}, {"failed", stage.failed}}},
+                          {"scans", stage.scans}});
+    }
+    json out = {{"id", workflow.id},
+                {"target", workflow.target},
+                {"state", workflow.finished ? "done" : "running"},
+                {"max_concurrency", workflow.max_concurrency},
+                {"running", workflow.running},
+                {"waiting", workflow.waiting.size()},
+                {"created_at", workflow.created_at},
+                {"stages", stages}};
+    if (workflow.finished) out["finished_at"] = workflow.finished_at;
+    return out;
+}
+
+} // namespace spectre
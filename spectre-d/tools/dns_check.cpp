@@ -0,0 +1,178 @@
+#include "mock_target.h"
+#include "spectre/dns_resolver.h"
+#include "spectre/http_client.h"
+#include <boost/asio.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Checks DnsResolver and HttpClient pinning against a stub DNS server on
+// 127.0.0.1, reached through SPECTRE_DNS_SERVERS:
+//   spectre_dns_check
+// Exits non-zero if a cached answer goes back to the network, a nonexistent
+// name is looked up twice within the negative TTL, concurrent lookups of one
+// name send more than one query, or a pinned request misses the mock target.
+namespace net = boost::asio;
+using udp = net::ip::udp;
+
+namespace {
+
+// Answers A queries for pinned.test and slow.test (the latter after a delay)
+// with 127.0.0.1, AAAA queries for them with no data, and everything else
+// with NXDOMAIN. Counts queries by name.
+class StubDns {
+public:
+    StubDns() : socket_(io_, udp::endpoint(net::ip::make_address("127.0.0.1"), 0)) {
+        receive();
+        thread_ = std::thread([this] { io_.run(); });
+    }
+
+    ~StubDns() {
+        io_.stop();
+        thread_.join();
+    }
+
+    unsigned short port() const { return socket_.local_endpoint().port(); }
+
+    int queries(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = queries_.find(name);
+        return it == queries_.end() ? 0 : it->second;
+    }
+
+private:
+    void receive() {
+        socket_.async_receive_from(net::buffer(buffer_), sender_, [this](boost::system::error_code ec, std::size_t n) {
+            if (!ec) answer(std::string(buffer_.data(), n), sender_);
+            receive();
+        });
+    }
+
+    void answer(const std::string& query, udp::endpoint to) {
+        if (query.size() < 12) return;
+        std::string name;
+        std::size_t at = 12;
+        while (at < query.size() && query[at] != 0) {
+            std::size_t length = static_cast<unsigned char>(query[at]);
+            if (at + 1 + length > query.size()) return;
+            if (!name.empty()) name += '.';
+            name.append(query, at + 1, length);
+            at += 1 + length;
+        }
+        if (at + 5 > query.size()) return;
+        for (char& c : name) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        int type = (static_cast<unsigned char>(query[at + 1]) << 8) | static_cast<unsigned char>(query[at + 2]);
+        std::size_t question_end = at + 5;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++queries_[name];
+        }
+
+        bool known = name == "pinned.test" || name == "slow.test";
+        bool a_record = known && type == 1;
+        std::string reply = query.substr(0, question_end);
+        reply[2] = static_cast<char>(0x81);                // response, recursion desired
+        reply[3] = static_cast<char>(known ? 0x80 : 0x83); // recursion available, NOERROR/NXDOMAIN
+        reply.replace(4, 8, std::string("\0\x01\0\0\0\0\0\0", 8));
+        if (a_record) {
+            reply[7] = 1;
+            // Pointer to the question name, A, IN, TTL 300, 127.0.0.1.
+            reply += std::string("\xc0\x0c\0\x01\0\x01\0\0\x01\x2c\0\x04\x7f\0\0\x01", 16);
+        }
+        auto packet = std::make_shared<std::string>(std::move(reply));
+        auto send = [this, packet, to] { socket_.send_to(net::buffer(*packet), to); };
+        if (name != "slow.test") return send();
+        auto timer = std::make_shared<net::steady_timer>(io_, std::chrono::milliseconds(300));
+        timer->async_wait([timer, send](boost::system::error_code) { send(); });
+    }
+
+    net::io_context io_;
+    udp::socket socket_;
+    std::array<char, 512> buffer_{};
+    udp::endpoint sender_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::map<std::string, int> queries_;
+};
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "ok    " : "FAIL  ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+} // namespace
+
+int main() {
+    StubDns stub;
+    std::string servers = "127.0.0.1:" + std::to_string(stub.port());
+    ::setenv("SPECTRE_DNS_SERVERS", servers.c_str(), 1);
+    ::setenv("SPECTRE_DISABLE_TOR", "1", 1);
+    auto& resolver = spectre::DnsResolver::get_instance();
+
+    auto first = resolver.resolve("pinned.test");
+    int sent = stub.queries("pinned.test");
+    check(first.ok() && first.addresses == std::vector<std::string>{"127.0.0.1"}, "pinned.test resolves to 127.0.0.1");
+    auto again = resolver.resolve("pinned.test");
+    check(again.ok() && stub.queries("pinned.test") == sent, "second lookup is answered from the cache");
+
+    auto missing = resolver.resolve("missing.test");
+    int missing_sent = stub.queries("missing.test");
+    check(missing.not_found(), "missing.test is not found");
+    check(resolver.resolve("missing.test").not_found() && stub.queries("missing.test") == missing_sent,
+          "second lookup of a nonexistent name is answered from the negative cache");
+
+    constexpr int kConcurrent = 8;
+    std::atomic<int> answered{0}, resolved{0};
+    for (int i = 0; i < kConcurrent; ++i) {
+        resolver.resolve_async("slow.test", [&](const spectre::DnsResolver::Result& result) {
+            if (result.ok()) ++resolved;
+            ++answered;
+        });
+    }
+    auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (answered < kConcurrent && std::chrono::steady_clock::now() < give_up) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    check(resolved == kConcurrent, "every concurrent lookup of slow.test is answered");
+    check(stub.queries("slow.test") == sent, "concurrent lookups share one query");
+
+    spectre::MockTarget target(spectre::MockTargetOptions{});
+    target.start();
+    std::string port = std::to_string(target.port());
+    auto& client = spectre::HttpClient::get_instance();
+
+    cpr::Session pinned;
+    client.set_url(pinned, "http://pinned.test:" + port + "/");
+    pinned.SetTimeout(cpr::Timeout{5000});
+    cpr::Session unresolvable;
+    client.set_url(unresolvable, "http://missing.test:" + port + "/");
+    auto responses = client.get_all({&pinned, &unresolvable});
+    check(responses[0].status_code == 200, "a pinned request reaches the address the resolver returned");
+    check(responses[1].error.code == cpr::ErrorCode::HOST_RESOLUTION_FAILURE && target.requests_served() == 1,
+          "a request to a nonexistent name fails without being sent");
+
+    // The pin applies to one request on one handle and is never left in the
+    // DNS cache the multiplexer's handles share.
+    cpr::Session direct;
+    direct.SetUrl(cpr::Url{"http://pinned.test:" + port + "/"});
+    direct.SetTimeout(cpr::Timeout{5000});
+    auto unpinned = client.get(direct);
+    check(unpinned.status_code != 200, "a session without a pin does not reuse another session's");
+
+    target.stop();
+    std::cout << (failures ? std::to_string(failures) + " check(s) failed" : std::string("all checks passed"))
+              << std::endl;
+    return failures ? 1 : 0;
+}
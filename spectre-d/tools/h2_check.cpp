@@ -0,0 +1,176 @@
+#include "spectre/curl_multiplexer.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Checks that a batch of concurrent requests to an h2 server runs as streams
+// on a single connection of the shared CurlMultiplexer:
+//   spectre_h2_check [--url https://HOST:PORT/] [--streams N]
+// Without --url it starts nghttpd on a free loopback port with a throwaway
+// certificate from openssl, and exits 77 (skipped) if either is missing.
+extern char** environ;
+
+namespace {
+
+pid_t spawn(const std::vector<std::string>& args, bool quiet) {
+    std::vector<char*> argv;
+    for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (quiet) {
+        posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+    pid_t pid = -1;
+    if (posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ) != 0) pid = -1;
+    posix_spawn_file_actions_destroy(&actions);
+    return pid;
+}
+
+bool run(const std::vector<std::string>& args) {
+    pid_t pid = spawn(args, true);
+    int status = 0;
+    return pid > 0 && ::waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+bool on_path(const char* program) {
+    const char* path = std::getenv("PATH");
+    std::string dirs = path ? path : "";
+    std::size_t start = 0;
+    while (start <= dirs.size()) {
+        std::size_t end = dirs.find(':', start);
+        if (end == std::string::npos) end = dirs.size();
+        auto candidate = std::filesystem::path(dirs.substr(start, end - start)) / program;
+        if (::access(candidate.c_str(), X_OK) == 0) return true;
+        start = end + 1;
+    }
+    return false;
+}
+
+unsigned short free_port() {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &length);
+    ::close(fd);
+    return ntohs(addr.sin_port);
+}
+
+bool accepting(unsigned short port) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    bool ok = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0;
+    ::close(fd);
+    return ok;
+}
+
+std::size_t discard(char*, std::size_t size, std::size_t count, void*) {
+    return size * count;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string url;
+    int streams = 16;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--url") == 0 && i + 1 < argc) {
+            url = argv[++i];
+        } else if (std::strcmp(argv[i], "--streams") == 0 && i + 1 < argc) {
+            streams = static_cast<int>(std::strtol(argv[++i], nullptr, 10));
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--url https://HOST:PORT/] [--streams N]" << std::endl;
+            return 2;
+        }
+    }
+
+    pid_t server = -1;
+    std::filesystem::path dir;
+    if (url.empty()) {
+        if (!on_path("nghttpd") || !on_path("openssl")) {
+            std::cout << "skipped: nghttpd and openssl are needed to start a local h2 server" << std::endl;
+            return 77;
+        }
+        char dir_template[] = "/tmp/spectre-h2-XXXXXX";
+        dir = ::mkdtemp(dir_template);
+        std::string key = dir / "key.pem", cert = dir / "cert.pem";
+        std::ofstream(dir / "index.html") << "ok\n";
+        if (!run({"openssl", "req", "-x509", "-newkey", "rsa:2048", "-nodes", "-days", "1", "-subj", "/CN=127.0.0.1",
+                  "-keyout", key, "-out", cert})) {
+            std::cerr << "openssl could not create a certificate" << std::endl;
+            std::filesystem::remove_all(dir);
+            return 1;
+        }
+        unsigned short port = free_port();
+        server = spawn({"nghttpd", "-d", dir.string(), "--address", "127.0.0.1", std::to_string(port), key, cert}, true);
+        if (server <= 0) {
+            std::cerr << "cannot start nghttpd" << std::endl;
+            std::filesystem::remove_all(dir);
+            return 1;
+        }
+        auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!accepting(port) && std::chrono::steady_clock::now() < give_up) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        url = "https://127.0.0.1:" + std::to_string(port) + "/";
+    }
+
+    std::vector<CURL*> handles;
+    for (int i = 0; i < streams; ++i) {
+        CURL* handle = curl_easy_init();
+        curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 0L);
+        curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, 10000L);
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, discard);
+        handles.push_back(handle);
+    }
+    auto results = spectre::CurlMultiplexer::get_instance().perform(handles);
+
+    int failed = 0, h2 = 0;
+    long connections = 0;
+    for (std::size_t i = 0; i < handles.size(); ++i) {
+        long version = 0, connects = 0;
+        curl_easy_getinfo(handles[i], CURLINFO_HTTP_VERSION, &version);
+        curl_easy_getinfo(handles[i], CURLINFO_NUM_CONNECTS, &connects);
+        if (results[i] != CURLE_OK) {
+            std::cout << "request " << i << ": " << curl_easy_strerror(results[i]) << std::endl;
+            ++failed;
+        }
+        if (version == CURL_HTTP_VERSION_2_0) ++h2;
+        connections += connects;
+        curl_easy_cleanup(handles[i]);
+    }
+
+    if (server > 0) {
+        ::kill(server, SIGTERM);
+        ::waitpid(server, nullptr, 0);
+        std::filesystem::remove_all(dir);
+    }
+
+    std::cout << streams << " requests, " << failed << " failed, " << h2 << " over h2, " << connections
+              << " connection(s) opened" << std::endl;
+    bool ok = failed == 0 && h2 == streams && connections == 1;
+    std::cout << (ok ? "ok" : "FAIL: expected every request as an h2 stream on one connection") << std::endl;
+    return ok ? 0 : 1;
+}
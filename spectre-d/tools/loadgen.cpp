@@ -0,0 +1,296 @@
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Drives a running spectre-d through POST /scan and its websocket and
+// reports ingest rate, dispatch latency, proof delivery latency and RSS
+// growth. Meant to be pointed at a daemon loaded with only the noop plugin:
+//   spectre_loadgen [--host 127.0.0.1] [--port 8081] [--ws-port 8889] [--rate N] [--duration-s N]
+//                   [--connections N] [--proof-ratio F] [--type noop] [--drain-s N]
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace websocket = beast::websocket;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    std::string port = "8081";
+    std::string ws_port = "8889";
+    double rate = 0;  // tasks per second across all connections; 0 = unthrottled
+    int duration_s = 10;
+    int connections = 4;
+    double proof_ratio = 0;
+    std::string type = "noop";
+    int drain_s = 10;
+};
+
+// Timestamps of one scan as seen by the load generator; zero means not seen.
+struct ScanTimes {
+    Clock::time_point sent{};
+    Clock::time_point accepted{};
+    Clock::time_point started{};
+    Clock::time_point finished{};
+};
+
+class Recorder {
+public:
+    void sent(const std::string& id, Clock::time_point sent, Clock::time_point accepted) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& t = scans_[id];
+        t.sent = sent;
+        t.accepted = accepted;
+    }
+    void event(const std::string& id, const std::string& kind, Clock::time_point at) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto& t = scans_[id];
+        if (kind == "scan_started") t.started = at;
+        else if (kind == "scan_finished") t.finished = at;
+    }
+    void proof(double delivery_ms) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        proof_ms_.push_back(delivery_ms);
+    }
+    std::size_t finished() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return static_cast<std::size_t>(std::count_if(scans_.begin(), scans_.end(), [](const auto& kv) {
+            return kv.second.sent != Clock::time_point{} && kv.second.finished != Clock::time_point{};
+        }));
+    }
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, ScanTimes> scans_;
+    std::vector<double> proof_ms_;
+};
+
+double ms_between(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+void print_latency(const char* label, std::vector<double> samples) {
+    if (samples.empty()) {
+        std::printf("%-22s n=0\n", label);
+        return;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double q) { return samples[std::min(samples.size() - 1, static_cast<std::size_t>(q * samples.size()))]; };
+    std::printf("%-22s n=%zu p50=%.2fms p90=%.2fms p99=%.2fms max=%.2fms\n", label, samples.size(), at(0.50),
+                at(0.90), at(0.99), samples.back());
+}
+
+std::string http_request(const Options& opts, http::verb verb, const std::string& target, const std::string& body,
+                         http::status& status) {
+    net::io_context io;
+    tcp::resolver resolver(io);
+    beast::tcp_stream stream(io);
+    stream.connect(resolver.resolve(opts.host, opts.port));
+    http::request<http::string_body> req{verb, target, 11};
+    req.set(http::field::host, opts.host);
+    if (!body.empty()) {
+        req.set(http::field::content_type, "application/json");
+        req.body() = body;
+        req.prepare_payload();
+    }
+    http::write(stream, req);
+    beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+    http::read(stream, buffer, res);
+    beast::error_code ec;
+    stream.socket().shutdown(tcp::socket::shutdown_both, ec);
+    status = res.result();
+    return res.body();
+}
+
+std::optional<std::int64_t> scrape_rss(const Options& opts) {
+    try {
+        http::status status;
+        std::string body = http_request(opts, http::verb::get, "/metrics", "", status);
+        const std::string key = "\nspectre_process_resident_memory_bytes ";
+        auto pos = body.find(key);
+        if (status != http::status::ok || pos == std::string::npos) return std::nullopt;
+        return std::strtoll(body.c_str() + pos + key.size(), nullptr, 10);
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+int usage(const char* argv0) {
+    std::cerr << "usage: " << argv0
+              << " [--host H] [--port P] [--ws-port P] [--rate N] [--duration-s N] [--connections N]"
+                 " [--proof-ratio F] [--type T] [--drain-s N]"
+              << std::endl;
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) return usage(argv[0]);
+        std::string flag = argv[i];
+        std::string value = argv[++i];
+        if (flag == "--host") opts.host = value;
+        else if (flag == "--port") opts.port = value;
+        else if (flag == "--ws-port") opts.ws_port = value;
+        else if (flag == "--rate") opts.rate = std::atof(value.c_str());
+        else if (flag == "--duration-s") opts.duration_s = std::atoi(value.c_str());
+        else if (flag == "--connections") opts.connections = std::max(1, std::atoi(value.c_str()));
+        else if (flag == "--proof-ratio") opts.proof_ratio = std::clamp(std::atof(value.c_str()), 0.0, 1.0);
+        else if (flag == "--type") opts.type = value;
+        else if (flag == "--drain-s") opts.drain_s = std::atoi(value.c_str());
+        else return usage(argv[0]);
+    }
+
+    Recorder recorder;
+    std::atomic<bool> ws_running{true};
+
+    // Websocket listener: scan lifecycle events and proofs.
+    net::io_context ws_io;
+    websocket::stream<tcp::socket> ws(ws_io);
+    try {
+        tcp::resolver resolver(ws_io);
+        net::connect(ws.next_layer(), resolver.resolve(opts.host, opts.ws_port));
+        ws.handshake(opts.host + ":" + opts.ws_port, "/");
+    } catch (const std::exception& e) {
+        std::cerr << "websocket connect failed: " << e.what() << std::endl;
+        return 1;
+    }
+    std::thread ws_thread([&] {
+        beast::flat_buffer buffer;
+        while (ws_running) {
+            beast::error_code ec;
+            ws.read(buffer, ec);
+            if (ec) break;
+            auto now = Clock::now();
+            auto message = nlohmann::json::parse(beast::buffers_to_string(buffer.data()), nullptr, false);
+            buffer.consume(buffer.size());
+            if (!message.is_object()) continue;
+            if (message.contains("event")) {
+                recorder.event(message.value("id", ""), message.value("event", ""), now);
+            } else if (message.contains("vuln_type") && message.contains("evidence") &&
+                       message["evidence"].contains("emitted_at_us")) {
+                auto wall_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::system_clock::now().time_since_epoch())
+                                   .count();
+                recorder.proof((wall_us - message["evidence"]["emitted_at_us"].get<std::int64_t>()) / 1000.0);
+            }
+        }
+    });
+
+    auto rss_start = scrape_rss(opts);
+    std::int64_t rss_peak = rss_start.value_or(0);
+    std::atomic<bool> sampling{true};
+    std::thread sampler([&] {
+        while (sampling) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+            if (auto rss = scrape_rss(opts)) rss_peak = std::max(rss_peak, *rss);
+        }
+    });
+
+    std::atomic<std::uint64_t> next_seq{0};
+    std::atomic<std::uint64_t> accepted{0};
+    std::atomic<std::uint64_t> failed{0};
+    const auto start = Clock::now();
+    const auto deadline = start + std::chrono::seconds(opts.duration_s);
+    const std::uint64_t proof_every = opts.proof_ratio > 0 ? static_cast<std::uint64_t>(1.0 / opts.proof_ratio) : 0;
+
+    std::vector<std::thread> senders;
+    for (int c = 0; c < opts.connections; ++c) {
+        senders.emplace_back([&] {
+            while (true) {
+                std::uint64_t seq = next_seq.fetch_add(1);
+                if (opts.rate > 0) {
+                    std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                                                              std::chrono::duration<double>(seq / opts.rate)));
+                }
+                auto sent = Clock::now();
+                if (sent >= deadline) break;
+                std::string target = "http://loadgen.invalid/task/" + std::to_string(seq);
+                if (proof_every && seq % proof_every == 0) target += "?proof=1";
+                try {
+                    http::status status;
+                    auto body = http_request(opts, http::verb::post, "/scan",
+                                             nlohmann::json{{"type", opts.type}, {"target", target}}.dump(), status);
+                    auto reply = nlohmann::json::parse(body, nullptr, false);
+                    if (status != http::status::ok || !reply.contains("id")) {
+                        failed++;
+                        continue;
+                    }
+                    recorder.sent(reply["id"].get<std::string>(), sent, Clock::now());
+                    accepted++;
+                } catch (const std::exception&) {
+                    failed++;
+                }
+            }
+        });
+    }
+    for (auto& t : senders) t.join();
+    const double send_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    // Give the daemon time to dispatch what it accepted.
+    const auto drain_deadline = Clock::now() + std::chrono::seconds(opts.drain_s);
+    while (recorder.finished() < accepted && Clock::now() < drain_deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    sampling = false;
+    sampler.join();
+    auto rss_end = scrape_rss(opts);
+    ws_running = false;
+    beast::error_code ec;
+    ws.next_layer().shutdown(tcp::socket::shutdown_both, ec);
+    ws.next_layer().close(ec);
+    ws_thread.join();
+
+    std::vector<double> accept_ms, dispatch_ms, complete_ms;
+    std::size_t started = 0, finished = 0;
+    {
+        std::lock_guard<std::mutex> lock(recorder.mutex_);
+        for (const auto& [id, t] : recorder.scans_) {
+            if (t.sent == Clock::time_point{}) continue;
+            accept_ms.push_back(ms_between(t.sent, t.accepted));
+            if (t.started != Clock::time_point{}) {
+                started++;
+                dispatch_ms.push_back(ms_between(t.sent, t.started));
+            }
+            if (t.finished != Clock::time_point{}) {
+                finished++;
+                complete_ms.push_back(ms_between(t.sent, t.finished));
+            }
+        }
+    }
+
+    std::printf("sent %llu accepted, %llu failed in %.2fs: %.1f tasks/s ingest\n",
+                static_cast<unsigned long long>(accepted.load()), static_cast<unsigned long long>(failed.load()),
+                send_s, accepted / send_s);
+    std::printf("dispatched %zu, finished %zu\n", started, finished);
+    print_latency("accept (POST /scan)", accept_ms);
+    print_latency("dispatch (->started)", dispatch_ms);
+    print_latency("complete (->finished)", complete_ms);
+    print_latency("proof -> websocket", recorder.proof_ms_);
+    if (rss_start && rss_end) {
+        std::printf("rss start=%.1fMiB peak=%.1fMiB end=%.1fMiB growth=%.1fMiB\n", *rss_start / 1048576.0,
+                    rss_peak / 1048576.0, *rss_end / 1048576.0, (*rss_end - *rss_start) / 1048576.0);
+    } else {
+        std::printf("rss unavailable (spectre_process_resident_memory_bytes not exported)\n");
+    }
+    return 0;
+}
@@ -0,0 +1,264 @@
+#include "mock_target.h"
+#include "spectre/url_utils.h"
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <regex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+namespace spectre {
+
+namespace {
+const char* const kPasswd =
+    "root:x:0:0:root:/root:/bin/bash\n"
+    "daemon:x:1:1:daemon:/usr/sbin:/usr/sbin/nologin\n"
+    "www-data:x:33:33:www-data:/var/www:/usr/sbin/nologin\n";
+
+const char* const kSqlError =
+    "<b>Warning</b>: You have an error in your SQL syntax; check the manual that corresponds to your MySQL "
+    "server version for the right syntax to use near ''' at line 1";
+
+const char* const kGitConfig =
+    "[core]\n\trepositoryformatversion = 0\n\tfilemode = true\n\tbare = false\n"
+    "[remote \"origin\"]\n\turl = git@example.internal:shop/storefront.git\n"
+    "\tfetch = +refs/heads/*:refs/remotes/origin/*\n";
+
+const char* const kPackageJson =
+    R"({"name":"storefront","version":"1.4.2","dependencies":{"express":"^4.18.2","storefront-internal-auth":"^2.0.0"},)"
+    R"("devDependencies":{"jest":"^29.0.0"}})";
+
+const char* const kRequirements = "flask==2.3.2\nstorefront-billing-client==0.9.1\n";
+
+// Seconds requested by SLEEP(n), pg_sleep(n) or WAITFOR DELAY '00:00:n'.
+int requested_sleep_seconds(const std::string& value) {
+    static const std::regex sleep_regex(R"((?:sleep|pg_sleep)\s*\(\s*(\d+)|waitfor\s+delay\s+'\d+:\d+:(\d+)')",
+                                        std::regex_constants::icase);
+    std::smatch match;
+    if (!std::regex_search(value, match, sleep_regex)) return 0;
+    return std::stoi(match[1].matched ? match[1].str() : match[2].str());
+}
+
+bool is_loopback(const std::string& address) {
+    boost::system::error_code ec;
+    auto ip = net::ip::make_address(address, ec);
+    return !ec && ip.is_loopback();
+}
+} // namespace
+
+class MockTarget::Impl {
+public:
+    explicit Impl(MockTargetOptions options) : options_(std::move(options)), acceptor_(io_) {
+        if (!is_loopback(options_.address)) {
+            throw std::invalid_argument("mock target only binds loopback addresses, got " + options_.address);
+        }
+    }
+
+    void start() {
+        tcp::endpoint endpoint(net::ip::make_address(options_.address), options_.port);
+        acceptor_.open(endpoint.protocol());
+        acceptor_.set_option(net::socket_base::reuse_address(true));
+        acceptor_.bind(endpoint);
+        acceptor_.listen();
+        do_accept();
+        for (std::size_t i = 0; i < std::max<std::size_t>(1, options_.threads); ++i) {
+            threads_.emplace_back([this] { io_.run(); });
+        }
+    }
+
+    void stop() {
+        io_.stop();
+        for (auto& t : threads_) {
+            if (t.joinable()) t.join();
+        }
+        threads_.clear();
+    }
+
+    unsigned short port() const { return acceptor_.local_endpoint().port(); }
+    std::string base_url() const {
+        auto endpoint = acceptor_.local_endpoint();
+        std::string host = endpoint.address().is_v6() ? "[" + endpoint.address().to_string() + "]"
+                                                      : endpoint.address().to_string();
+        return "http://" + host + ":" + std::to_string(endpoint.port());
+    }
+    std::uint64_t requests_served() const { return served_.load(std::memory_order_relaxed); }
+
+private:
+    struct Session : std::enable_shared_from_this<Session> {
+        Session(Impl& owner, tcp::socket socket)
+            : owner(owner), stream(std::move(socket)), timer(stream.get_executor()) {}
+
+        Impl& owner;
+        beast::tcp_stream stream;
+        net::steady_timer timer;
+        beast::flat_buffer buffer;
+        http::request<http::string_body> req;
+        http::response<http::string_body> res;
+
+        void read() {
+            req = {};
+            http::async_read(stream, buffer, req, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                if (ec) return self->close();
+                self->owner.respond(*self);
+            });
+        }
+
+        void write() {
+            http::async_write(stream, res, [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                if (ec || !self->res.keep_alive()) return self->close();
+                self->read();
+            });
+        }
+
+        void close() {
+            beast::error_code ec;
+            stream.socket().shutdown(tcp::socket::shutdown_send, ec);
+        }
+    };
+
+    void do_accept() {
+        acceptor_.async_accept(net::make_strand(io_), [this](beast::error_code ec, tcp::socket socket) {
+            if (!ec) std::make_shared<Session>(*this, std::move(socket))->read();
+            if (acceptor_.is_open()) do_accept();
+        });
+    }
+
+    std::chrono::milliseconds base_delay() {
+        auto delay = options_.latency;
+        if (options_.jitter.count() > 0) {
+            thread_local std::mt19937 rng{std::random_device{}()};
+            std::uniform_int_distribution<long> dist(0, options_.jitter.count());
+            delay += std::chrono::milliseconds(dist(rng));
+        }
+        return delay;
+    }
+
+    void respond(Session& s) {
+        served_.fetch_add(1, std::memory_order_relaxed);
+        std::string_view target(s.req.target().data(), s.req.target().size());
+        auto qpos = target.find('?');
+        std::string path(target.substr(0, qpos));
+        auto params = qpos == std::string_view::npos ? std::map<std::string, std::string>{}
+                                                     : parse_query(target.substr(qpos + 1));
+
+        s.res = {};
+        s.res.version(s.req.version());
+        s.res.keep_alive(s.req.keep_alive());
+        s.res.set(http::field::server, "spectre-mock-target");
+        s.res.set(http::field::content_type, "text/html");
+        s.res.result(http::status::ok);
+
+        auto delay = base_delay();
+        std::string host(s.req[http::field::host]);
+        if (host.empty()) host = base_url().substr(7);
+
+        if (path == "/") {
+            s.res.body() =
+                "<html><body><h1>Storefront</h1><ul>"
+                "<li><a href=\"/search?q=shoes&page=1\">Search</a></li>"
+                "<li><a href=\"/file?path=readme.txt\">Docs</a></li>"
+                "<li><a href=\"/item?id=1\">Item</a></li>"
+                "<li><a href=\"/login\">Login</a></li>"
+                "</ul></body></html>";
+        } else if (path == "/search") {
+            std::string body = "<html><body><h1>Results</h1>";
+            for (const auto& [key, value] : params) body += "<p>" + key + ": " + value + "</p>";
+            s.res.body() = body + "</body></html>";
+        } else if (path == "/file") {
+            bool traversal = std::any_of(params.begin(), params.end(), [](const auto& kv) {
+                return kv.second.find("passwd") != std::string::npos;
+            });
+            s.res.set(http::field::content_type, "text/plain");
+            s.res.body() = traversal ? kPasswd : "Storefront documentation.\n";
+        } else if (path == "/item") {
+            std::string body = "<html><body><p>Item details</p></body></html>";
+            for (const auto& [key, value] : params) {
+                int sleep_s = requested_sleep_seconds(value);
+                if (sleep_s > 0) {
+                    delay += std::min<std::chrono::milliseconds>(std::chrono::seconds(sleep_s), options_.max_sleep);
+                } else if (value.find('\'') != std::string::npos) {
+                    body = std::string("<html><body>") + kSqlError + "</body></html>";
+                }
+            }
+            s.res.body() = body;
+        } else if (path == "/login") {
+            std::string form = "<form method=\"post\" action=\"http://" + host +
+                               "/login\"><input name=\"username\"><input name=\"password\" type=\"password\"></form>";
+            auto creds = parse_query(s.req.body());
+            if (s.req.method() == http::verb::post && creds["username"] == "admin" && creds["password"] == "admin") {
+                s.res.body() = "<html><body>Welcome back, admin</body></html>";
+            } else {
+                s.res.body() = "<html><body>" + form + "</body></html>";
+            }
+        } else if (path == "/api") {
+            s.res.set(http::field::content_type, "application/json");
+            if (s.req.method() != http::verb::post) {
+                s.res.result(http::status::method_not_allowed);
+                s.res.body() = R"({"error":"POST only"})";
+            } else if (!nlohmann::json::accept(s.req.body())) {
+                s.res.result(http::status::internal_server_error);
+                s.res.body() = R"({"error":"SyntaxError: Unexpected end of JSON input"})";
+            } else {
+                s.res.body() = R"({"ok":true})";
+            }
+        } else if (path == "/.git/config") {
+            s.res.set(http::field::content_type, "text/plain");
+            s.res.body() = kGitConfig;
+        } else if (path == "/package.json") {
+            s.res.set(http::field::content_type, "application/json");
+            s.res.body() = kPackageJson;
+        } else if (path == "/requirements.txt") {
+            s.res.set(http::field::content_type, "text/plain");
+            s.res.body() = kRequirements;
+        } else {
+            s.res.result(http::status::not_found);
+            s.res.body() = "<h1>404 Not Found</h1>";
+        }
+        s.res.prepare_payload();
+
+        if (delay.count() <= 0) return s.write();
+        s.timer.expires_after(delay);
+        s.timer.async_wait([self = s.shared_from_this()](beast::error_code) { self->write(); });
+    }
+
+    MockTargetOptions options_;
+    net::io_context io_;
+    tcp::acceptor acceptor_;
+    std::vector<std::thread> threads_;
+    std::atomic<std::uint64_t> served_{0};
+};
+
+MockTarget::MockTarget(MockTargetOptions options) : impl_(std::make_unique<Impl>(std::move(options))) {}
+MockTarget::~MockTarget() { impl_->stop(); }
+
+void MockTarget::start() {
+    impl_->start();
+}
+
+void MockTarget::stop() {
+    impl_->stop();
+}
+
+unsigned short MockTarget::port() const {
+    return impl_->port();
+}
+
+std::string MockTarget::base_url() const {
+    return impl_->base_url();
+}
+
+std::uint64_t MockTarget::requests_served() const {
+    return impl_->requests_served();
+}
+
+} // namespace spectre
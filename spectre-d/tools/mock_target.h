@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace spectre {
+
+struct MockTargetOptions {
+    std::string address = "127.0.0.1";
+    unsigned short port = 0;
+    std::chrono::milliseconds latency{0};
+    std::chrono::milliseconds jitter{0};
+    // Upper bound for delays requested by SLEEP()/pg_sleep()/WAITFOR payloads.
+    std::chrono::milliseconds max_sleep{10000};
+    std::size_t threads = 2;
+};
+
+// Deliberately vulnerable HTTP target for end-to-end plugin benchmarks:
+//   /                index linking every route below (crawler)
+//   /search          reflects all query values unescaped (xss_hunter)
+//   /file            serves an /etc/passwd body for traversal payloads (lfi_scanner)
+//   /item            MySQL error for quoted input, honours sleep payloads (sql_injector)
+//   /login           form that accepts admin/admin (cred_stuffer)
+//   /api             500 on malformed JSON (api_fuzzer)
+//   /.git/config, /package.json, /requirements.txt
+// Refuses to bind anything but a loopback address.
+class MockTarget {
+public:
+    explicit MockTarget(MockTargetOptions options);
+    ~MockTarget();
+
+    void start();
+    void stop();
+
+    unsigned short port() const;
+    std::string base_url() const;
+    std::uint64_t requests_served() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace spectre
@@ -0,0 +1,51 @@
+#include "mock_target.h"
+#include <boost/asio/signal_set.hpp>
+#include <boost/asio/io_context.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+// Standalone mock target, for pointing a full spectre-d at something local:
+//   spectre_mock_target [--port N] [--latency-ms N] [--jitter-ms N] [--threads N] [--max-sleep-ms N]
+int main(int argc, char* argv[]) {
+    spectre::MockTargetOptions options;
+    options.port = 8090;
+    for (int i = 1; i < argc; ++i) {
+        auto next = [&]() -> long {
+            if (i + 1 >= argc) {
+                std::cerr << "missing value for " << argv[i] << std::endl;
+                std::exit(2);
+            }
+            return std::strtol(argv[++i], nullptr, 10);
+        };
+        if (std::strcmp(argv[i], "--port") == 0) {
+            options.port = static_cast<unsigned short>(next());
+        } else if (std::strcmp(argv[i], "--latency-ms") == 0) {
+            options.latency = std::chrono::milliseconds(next());
+        } else if (std::strcmp(argv[i], "--jitter-ms") == 0) {
+            options.jitter = std::chrono::milliseconds(next());
+        } else if (std::strcmp(argv[i], "--threads") == 0) {
+            options.threads = static_cast<std::size_t>(next());
+        } else if (std::strcmp(argv[i], "--max-sleep-ms") == 0) {
+            options.max_sleep = std::chrono::milliseconds(next());
+        } else {
+            std::cerr << "usage: " << argv[0]
+                      << " [--port N] [--latency-ms N] [--jitter-ms N] [--threads N] [--max-sleep-ms N]" << std::endl;
+            return 2;
+        }
+    }
+
+    spectre::MockTarget target(options);
+    target.start();
+    std::cout << "mock target listening on " << target.base_url() << std::endl;
+
+    boost::asio::io_context io;
+    boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+    signals.async_wait([](const boost::system::error_code&, int) {});
+    io.run();
+
+    target.stop();
+    std::cout << "served " << target.requests_served() << " requests" << std::endl;
+    return 0;
+}
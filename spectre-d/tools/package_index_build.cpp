@@ -0,0 +1,54 @@
+#include "spectre/package_index.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Builds a package name snapshot for RegistryLookup from name lists, one name
+// per line (stdin when no files are given):
+//   spectre_package_index npm|pypi OUT.idx [names.txt ...]
+// e.g. for PyPI, from the simple index:
+//   curl -s https://pypi.org/simple/ | sed -n 's/.*>\(.*\)<\/a>.*/\1/p' |
+//       spectre_package_index pypi package-index/pypi.idx
+namespace {
+
+void read_names(std::istream& in, spectre::Ecosystem ecosystem, std::vector<std::string>& names) {
+    std::string line;
+    while (std::getline(in, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) line.pop_back();
+        std::size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos) continue;
+        names.push_back(spectre::normalize_package_name(ecosystem, std::string_view(line).substr(start)));
+    }
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || (std::string(argv[1]) != "npm" && std::string(argv[1]) != "pypi")) {
+        std::cerr << "usage: " << argv[0] << " npm|pypi OUT.idx [names.txt ...]\n";
+        return 2;
+    }
+    auto ecosystem = std::string(argv[1]) == "npm" ? spectre::Ecosystem::npm : spectre::Ecosystem::pypi;
+    std::vector<std::string> names;
+    if (argc == 3) {
+        read_names(std::cin, ecosystem, names);
+    }
+    for (int i = 3; i < argc; ++i) {
+        std::ifstream in(argv[i]);
+        if (!in) {
+            std::cerr << argv[i] << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        read_names(in, ecosystem, names);
+    }
+    std::size_t read = names.size();
+    if (!spectre::PackageIndex::build(std::move(names), argv[2])) {
+        std::cerr << argv[2] << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    auto index = spectre::PackageIndex::open(argv[2]);
+    std::cout << "wrote " << argv[2] << ": " << (index ? index->size() : 0) << " names from " << read << " lines\n";
+    return index ? 0 : 1;
+}
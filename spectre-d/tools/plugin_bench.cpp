@@ -0,0 +1,156 @@
+#include "mock_target.h"
+#include "spectre/metrics.h"
+#include "spectre/plugin_loader.h"
+#include "spectre/scan_registry.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// End-to-end plugin throughput against the localhost mock target:
+//   spectre_plugin_bench <plugin_dir> [--iterations N] [--latency-ms N] [--jitter-ms N]
+//                        [--target http://127.0.0.1:PORT] [--plugins a,b]
+// Each selected plugin runs its real handle_task() N times; requests, latency
+// percentiles and findings come from the same counters the daemon exports.
+namespace {
+
+// Plugin name -> path on the mock target that exercises it.
+const std::map<std::string, std::string> kPluginPaths = {
+    {"xss_hunter", "/search?q=shoes&page=1"},
+    {"sql_injector", "/item?id=1"},
+    {"lfi_scanner", "/file?path=readme.txt"},
+    {"api_fuzzer", "/api"},
+    {"git_leak", ""},
+    {"crawler", "/"},
+    {"cred_stuffer", "/login"},
+};
+
+// Never run: they talk to third-party services (AWS, npm/PyPI) or wait on
+// an external canary no matter what target they are given.
+const std::set<std::string> kExcluded = {"s3_scan", "dependency_confusion", "ssrf_scan"};
+
+bool is_loopback_url(const std::string& url) {
+    for (const char* prefix : {"http://127.0.0.1", "http://localhost", "http://[::1]"}) {
+        if (url.rfind(prefix, 0) == 0) {
+            char next = url.size() > std::strlen(prefix) ? url[std::strlen(prefix)] : '\0';
+            if (next == '\0' || next == ':' || next == '/') return true;
+        }
+    }
+    return false;
+}
+
+std::set<std::string> split_list(const std::string& list) {
+    std::set<std::string> out;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) out.insert(item);
+    }
+    return out;
+}
+
+int usage(const char* argv0) {
+    std::cerr << "usage: " << argv0
+              << " <plugin_dir> [--iterations N] [--latency-ms N] [--jitter-ms N] [--target URL] [--plugins a,b]"
+              << std::endl;
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) return usage(argv[0]);
+    std::string plugin_dir = argv[1];
+    int iterations = 10;
+    spectre::MockTargetOptions mock_options;
+    std::string target;
+    std::set<std::string> selected;
+    for (int i = 2; i < argc; ++i) {
+        if (i + 1 >= argc) return usage(argv[0]);
+        std::string flag = argv[i];
+        std::string value = argv[++i];
+        if (flag == "--iterations") {
+            iterations = std::max(1, std::atoi(value.c_str()));
+        } else if (flag == "--latency-ms") {
+            mock_options.latency = std::chrono::milliseconds(std::atol(value.c_str()));
+        } else if (flag == "--jitter-ms") {
+            mock_options.jitter = std::chrono::milliseconds(std::atol(value.c_str()));
+        } else if (flag == "--target") {
+            target = value;
+        } else if (flag == "--plugins") {
+            selected = split_list(value);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    // Plugins must never leave the machine while benchmarking.
+    setenv("SPECTRE_DISABLE_TOR", "1", 1);
+    setenv("SPECTRE_DISABLE_ARWEAVE", "1", 1);
+
+    std::optional<spectre::MockTarget> mock;
+    if (target.empty()) {
+        mock.emplace(mock_options);
+        mock->start();
+        target = mock->base_url();
+    } else if (!is_loopback_url(target)) {
+        std::cerr << "refusing non-loopback target " << target << std::endl;
+        return 2;
+    }
+    while (!target.empty() && target.back() == '/') target.pop_back();
+
+    auto plugins = spectre::PluginLoader(plugin_dir).load_all();
+    auto& latency = spectre::MetricsRegistry::get_instance().histogram(
+        "spectre_outbound_request_duration_seconds", "Wall time of outbound probe requests.");
+
+    std::printf("%-14s %6s %10s %10s %10s %10s %10s %9s\n", "plugin", "iters", "wall_ms", "requests", "req/s",
+                "p50_ms", "p99_ms", "findings");
+    for (auto& plugin : plugins) {
+        std::string name = plugin->name();
+        auto path = kPluginPaths.find(name);
+        if (kExcluded.count(name) || path == kPluginPaths.end()) continue;
+        if (!selected.empty() && !selected.count(name)) continue;
+
+        auto progress = std::make_shared<spectre::ScanProgress>();
+        auto before = latency.snapshot();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            std::string id = spectre::ScanRegistry::new_id();
+            spectre::ScanScope scope(id, progress);
+            spectre::Task task = spectre::make_task(name, target + path->second, id);
+            try {
+                plugin->handle_task(task);
+            } catch (const std::exception& e) {
+                std::cerr << name << " threw: " << e.what() << std::endl;
+            }
+        }
+        double wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        auto after = latency.snapshot();
+
+        spectre::Histogram::Snapshot delta;
+        for (std::size_t b = 0; b < delta.buckets.size(); ++b) delta.buckets[b] = after.buckets[b] - before.buckets[b];
+        delta.count = after.count - before.count;
+        delta.sum = after.sum - before.sum;
+
+        auto requests = progress->requests_sent.load();
+        std::printf("%-14s %6d %10.1f %10llu %10.1f %10.2f %10.2f %9llu\n", name.c_str(), iterations, wall_ms,
+                    static_cast<unsigned long long>(requests), wall_ms > 0 ? requests * 1000.0 / wall_ms : 0.0,
+                    delta.count ? delta.quantile(0.50) / 1000.0 : 0.0,
+                    delta.count ? delta.quantile(0.99) / 1000.0 : 0.0,
+                    static_cast<unsigned long long>(progress->findings.load()));
+    }
+
+    if (mock) {
+        mock->stop();
+        std::printf("mock target served %llu requests\n", static_cast<unsigned long long>(mock->requests_served()));
+    }
+    return 0;
+}
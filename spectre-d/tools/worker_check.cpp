@@ -0,0 +1,148 @@
+#include "spectre/plugin_loader.h"
+#include "spectre/plugin_worker.h"
+#include "spectre/shm_ring.h"
+#include "spectre/task.h"
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Checks plugin worker processes end to end:
+//   spectre_worker_check <path to worker_check_plugin.so>
+// A ring shared with a forked child must deliver every message intact and in
+// order through many wraparounds; an isolated plugin must take its name from
+// its worker without its library ever being mapped into this process,
+// survive a crashing task and a task overrunning the timeout by restarting
+// the worker, and keep serving tasks afterwards.
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string& what) {
+    std::cout << (ok ? "ok    " : "FAIL  ") << what << std::endl;
+    if (!ok) ++failures;
+}
+
+std::string message(int i) {
+    return std::string(static_cast<std::size_t>(i % 700), static_cast<char>('a' + i % 26)) + std::to_string(i);
+}
+
+void check_ring() {
+    constexpr std::size_t kCapacity = 4096;
+    constexpr int kMessages = 20000;
+    std::size_t size = spectre::ShmRing::region_size(kCapacity);
+    void* memory = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        check(false, "map a shared ring");
+        return;
+    }
+    auto ring = spectre::ShmRing::create(memory, kCapacity);
+    check(!ring.try_push(std::string(ring.max_message() + 1, 'x')), "a message larger than the ring is refused");
+
+    pid_t child = ::fork();
+    if (child == 0) {
+        auto producer = spectre::ShmRing::attach(memory);
+        for (int i = 0; i < kMessages; ++i) {
+            if (!producer.push(message(i), std::chrono::seconds(5))) ::_exit(1);
+        }
+        ::_exit(0);
+    }
+    int received = 0;
+    std::string out;
+    while (received < kMessages && ring.pop(out, std::chrono::seconds(5))) {
+        if (out != message(received)) break;
+        ++received;
+    }
+    int status = 0;
+    ::waitpid(child, &status, 0);
+    check(received == kMessages && WIFEXITED(status) && WEXITSTATUS(status) == 0,
+          "every message from another process arrives intact and in order (" + std::to_string(received) + "/" +
+              std::to_string(kMessages) + ")");
+    ::munmap(memory, size);
+}
+
+// Whether the task fails, and how.
+std::string run(spectre::Plugin& plugin, const std::string& target) {
+    try {
+        plugin.handle_task(spectre::make_task("worker_check", target));
+        return "";
+    } catch (const std::exception& ex) {
+        return ex.what();
+    }
+}
+
+// Retries until the supervisor has a worker up again.
+bool recovers(spectre::Plugin& plugin) {
+    auto give_up = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (std::chrono::steady_clock::now() < give_up) {
+        if (run(plugin, "http://ok.test/").empty()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return false;
+}
+
+// The loader maps a library as <stem>.<n>.so; the worker rings' memfd, also
+// named after the stem, has no extension.
+bool mapped_here(const std::string& library) {
+    std::string stem = std::filesystem::path(library).stem().string() + ".";
+    std::ifstream maps("/proc/self/maps");
+    for (std::string line; std::getline(maps, line);) {
+        if (line.find(stem) != std::string::npos) return true;
+    }
+    return false;
+}
+
+void check_supervisor(const std::string& library) {
+    spectre::WorkerOptions options;
+    options.processes = 1;
+    options.threads = 1;
+    options.task_timeout = std::chrono::seconds(2);
+    spectre::PluginLoader loader(std::filesystem::path(library).parent_path().string());
+    loader.isolate({std::filesystem::path(library).filename().string()},
+                   [&options](const std::string& path) { return spectre::make_isolated_plugin(path, options); });
+    auto plugin = loader.load(library);
+    check(plugin && plugin->name() == "worker_check", "the isolated plugin is named by its worker");
+    check(!mapped_here(library), "the isolated library is not loaded into this process");
+    if (!plugin) return;
+
+    check(run(*plugin, "http://ok.test/").empty(), "a task runs in the worker");
+    std::string crashed = run(*plugin, "http://crash.test/");
+    check(crashed.find("killed by signal " + std::to_string(SIGABRT)) != std::string::npos,
+          "a crashing task fails: " + crashed);
+    check(recovers(*plugin), "the worker is restarted after a crash");
+
+    // With one task thread the second waits 1.2s in the worker's queue and
+    // finishes 2.4s after it was sent, but ran for only 1.2s of the 2s limit.
+    auto queued = std::async(std::launch::async, [&] { return run(*plugin, "http://sleep.test/?sleep=1200"); });
+    std::string first = run(*plugin, "http://sleep.test/?sleep=1200");
+    std::string second = queued.get();
+    check(first.empty() && second.empty(), "time spent queued in the worker does not count against the timeout");
+
+    std::string overran = run(*plugin, "http://sleep.test/?sleep=10000");
+    check(!overran.empty(), "a task overrunning the timeout fails: " + overran);
+    check(recovers(*plugin), "the worker is restarted after a timeout");
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (spectre::is_worker_invocation(argc, argv)) return spectre::run_plugin_worker(argc, argv);
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <path to worker_check_plugin.so>" << std::endl;
+        return 2;
+    }
+    check_ring();
+    check_supervisor(argv[1]);
+    std::cout << (failures ? std::to_string(failures) + " check(s) failed" : std::string("all checks passed"))
+              << std::endl;
+    return failures ? 1 : 0;
+}
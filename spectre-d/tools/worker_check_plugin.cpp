@@ -0,0 +1,29 @@
+#include "spectre/plugin.h"
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+namespace {
+
+const spectre::TaskType task_type = spectre::intern_task_type("worker_check");
+
+// Misbehaves on request for spectre_worker_check: a target containing
+// "crash" aborts the process, "sleep=N" holds the task for N milliseconds.
+class WorkerCheckPlugin : public spectre::Plugin {
+public:
+    void handle_task(const spectre::Task& task) override {
+        if (task.type != task_type) return;
+        if (task.target.find("crash") != std::string::npos) std::abort();
+        auto sleep = task.target.find("sleep=");
+        if (sleep != std::string::npos) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::atol(task.target.c_str() + sleep + 6)));
+        }
+    }
+    std::string name() const override { return "worker_check"; }
+};
+} // namespace
+
+extern "C" spectre::Plugin* spectre_create_plugin() {
+    return new WorkerCheckPlugin();
+}